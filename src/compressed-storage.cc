@@ -0,0 +1,323 @@
+#include "compressed-storage.hh"
+#include "parallel.hh"
+
+#if defined(NNVIEW_WITH_ZLIB)
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#include <zlib.h>
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace nnview {
+
+constexpr size_t CompressedStorage::kBlockSize;
+
+static std::atomic<uint64_t> g_next_storage_id(1);
+
+namespace {
+
+// 64 blocks = 16 MB
+constexpr size_t kDefaultCacheBlocks = 64;
+
+//
+// LRU cache of decompressed blocks shared by all storages.
+//
+class BlockCache {
+ public:
+  using Key = std::pair<uint64_t, size_t>;  // <storage id, block index>
+  using Value = std::shared_ptr<const std::vector<uint8_t>>;
+
+  static BlockCache &instance() {
+    static BlockCache cache;
+    return cache;
+  }
+
+  Value find(const Key &key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _map.find(key);
+    if (it == _map.end()) {
+      return Value();
+    }
+    // Move to the front(most recently used).
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return it->second->second;
+  }
+
+  void insert(const Key &key, const Value &value) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_map.count(key)) {
+      return;
+    }
+    _lru.emplace_front(key, value);
+    _map[key] = _lru.begin();
+    evict();
+  }
+
+  // Remove all blocks of the storage.
+  void erase(uint64_t storage_id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _lru.begin(); it != _lru.end();) {
+      if (it->first.first == storage_id) {
+        _map.erase(it->first);
+        it = _lru.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void set_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _capacity = std::max(size_t(1), capacity);
+    evict();
+  }
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return std::hash<uint64_t>()(key.first * 1000003u + key.second);
+    }
+  };
+
+  void evict() {
+    while (_lru.size() > _capacity) {
+      _map.erase(_lru.back().first);
+      _lru.pop_back();
+    }
+  }
+
+  std::mutex _mutex;
+  size_t _capacity = kDefaultCacheBlocks;
+  std::list<std::pair<Key, Value>> _lru;
+  std::unordered_map<Key, std::list<std::pair<Key, Value>>::iterator, KeyHash>
+      _map;
+};
+
+// Byte k of element i goes to `dst[k * n + i]`.
+void Shuffle(const uint8_t *src, size_t size, size_t element_size,
+             uint8_t *dst) {
+  const size_t n = size / element_size;
+  for (size_t i = 0; i < n; i++) {
+    for (size_t k = 0; k < element_size; k++) {
+      dst[k * n + i] = src[i * element_size + k];
+    }
+  }
+}
+
+void Unshuffle(const uint8_t *src, size_t size, size_t element_size,
+               uint8_t *dst) {
+  const size_t n = size / element_size;
+  for (size_t k = 0; k < element_size; k++) {
+    for (size_t i = 0; i < n; i++) {
+      dst[i * element_size + k] = src[k * n + i];
+    }
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<CompressedStorage> CompressedStorage::compress(
+    const uint8_t *data, size_t size, size_t element_size) {
+#if defined(NNVIEW_WITH_ZLIB)
+  // Block size must be a multiple of the element size.
+  if ((element_size == 0) || (kBlockSize % element_size) != 0) {
+    return nullptr;
+  }
+
+  auto storage = std::make_shared<CompressedStorage>();
+  storage->_size = size;
+  storage->_element_size = element_size;
+
+  std::vector<uint8_t> shuffled(kBlockSize);
+  for (size_t offset = 0; offset < size; offset += kBlockSize) {
+    const size_t raw_size = std::min(kBlockSize, size - offset);
+
+    Block block;
+    block.raw_size = raw_size;
+
+    const uint8_t *src = data + offset;
+    if ((element_size > 1) && (raw_size % element_size == 0)) {
+      Shuffle(src, raw_size, element_size, shuffled.data());
+      src = shuffled.data();
+    }
+
+    uLongf compressed_size = compressBound(uLong(raw_size));
+    block.bytes.resize(compressed_size);
+    const int ret = compress2(block.bytes.data(), &compressed_size, src,
+                              uLong(raw_size), Z_BEST_SPEED);
+    if ((ret != Z_OK) || (compressed_size >= raw_size)) {
+      // Incompressible. Keep the original bytes.
+      block.bytes.assign(data + offset, data + offset + raw_size);
+      block.stored = true;
+    } else {
+      block.bytes.resize(compressed_size);
+      block.bytes.shrink_to_fit();
+    }
+
+    storage->_blocks.push_back(std::move(block));
+  }
+
+  return storage;
+#else
+  (void)data;
+  (void)size;
+  (void)element_size;
+  return nullptr;
+#endif
+}
+
+CompressedStorage::CompressedStorage() : _id(g_next_storage_id++) {}
+
+CompressedStorage::~CompressedStorage() { BlockCache::instance().erase(_id); }
+
+size_t CompressedStorage::compressed_size() const {
+  size_t n = 0;
+  for (const auto &block : _blocks) {
+    n += block.bytes.size();
+  }
+  return n;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> CompressedStorage::block(
+    size_t index) const {
+  if (index >= _blocks.size()) {
+    return nullptr;
+  }
+
+  const BlockCache::Key key(_id, index);
+  BlockCache::Value value = BlockCache::instance().find(key);
+  if (value) {
+    return value;
+  }
+
+  const Block &block = _blocks[index];
+  auto decoded = std::make_shared<std::vector<uint8_t>>(block.raw_size);
+  if (!decode(index, decoded->data())) {
+    return nullptr;
+  }
+
+  value = std::move(decoded);
+  BlockCache::instance().insert(key, value);
+  return value;
+}
+
+bool CompressedStorage::decode(size_t index, uint8_t *dst) const {
+  const Block &block = _blocks[index];
+  if (block.stored) {
+    memcpy(dst, block.bytes.data(), block.raw_size);
+    return true;
+  }
+
+#if defined(NNVIEW_WITH_ZLIB)
+  const bool shuffled =
+      (_element_size > 1) && (block.raw_size % _element_size == 0);
+  std::vector<uint8_t> buf(shuffled ? block.raw_size : 0);
+  uint8_t *out = shuffled ? buf.data() : dst;
+
+  uLongf len = uLongf(block.raw_size);
+  if ((uncompress(out, &len, block.bytes.data(), uLong(block.bytes.size())) !=
+       Z_OK) ||
+      (len != block.raw_size)) {
+    std::cerr << "Failed to decompress tensor block.\n";
+    return false;
+  }
+  if (shuffled) {
+    Unshuffle(buf.data(), block.raw_size, _element_size, dst);
+  }
+  return true;
+#else
+  (void)dst;
+  return false;
+#endif
+}
+
+bool CompressedStorage::decompress(uint8_t *dst) const {
+  for (size_t i = 0; i < _blocks.size(); i++) {
+    if (!decode(i, dst + i * kBlockSize)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CompressedStorage::read(size_t offset, size_t len, uint8_t *dst) const {
+  if ((offset > _size) || (_size - offset < len)) {
+    return false;
+  }
+
+  while (len > 0) {
+    const size_t index = offset / kBlockSize;
+    const size_t block_offset = offset % kBlockSize;
+    const size_t n = std::min(len, kBlockSize - block_offset);
+
+    auto b = block(index);
+    if (!b) {
+      return false;
+    }
+    memcpy(dst, b->data() + block_offset, n);
+
+    dst += n;
+    offset += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+CompressStats compress_tensors(std::vector<Tensor> *tensors,
+                               int num_threads) {
+  CompressStats stats;
+
+#if !defined(NNVIEW_WITH_ZLIB)
+  (void)tensors;
+  (void)num_threads;
+  std::cerr << "Tensor compression requires zlib. Tensors are kept "
+               "uncompressed.\n";
+#else
+  std::vector<std::shared_ptr<CompressedStorage>> results(tensors->size());
+  parallel_for(tensors->size(), num_threads, [&](size_t i) {
+    const Tensor &tensor = (*tensors)[i];
+    if (!tensor.loaded || tensor.data.empty()) {
+      return;
+    }
+    results[i] = CompressedStorage::compress(
+        tensor.data.data(), tensor.data.size(), get_dtype_size(tensor.dtype));
+  });
+
+  for (size_t i = 0; i < tensors->size(); i++) {
+    if (!results[i]) {
+      continue;
+    }
+    Tensor &tensor = (*tensors)[i];
+    stats.num_tensors++;
+    stats.raw_bytes += tensor.data.size();
+    stats.compressed_bytes += results[i]->compressed_size();
+
+    tensor.compressed = std::move(results[i]);
+    tensor.data = std::vector<uint8_t>();
+  }
+#endif
+
+  return stats;
+}
+
+void set_decompressed_block_cache_size(size_t num_blocks) {
+  BlockCache::instance().set_capacity(num_blocks);
+}
+
+}  // namespace nnview
@@ -0,0 +1,92 @@
+#ifndef NNVIEW_COMPRESSED_STORAGE_HH_
+#define NNVIEW_COMPRESSED_STORAGE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "datatypes.h"
+
+//
+// Block-compressed in-memory storage of a tensor payload.
+//
+// The payload is split into fixed size blocks. Each block is byte-shuffled
+// (byte k of every element is stored together, which makes float data much
+// more compressible) and compressed with zlib at the fastest level. Blocks
+// which do not shrink are stored as is.
+//
+// Blocks are decompressed on demand. Recently used decompressed blocks are
+// kept in a small process-wide LRU cache, so repeated access from the GUI
+// (colormap, statistics, value overlay) does not decompress again.
+//
+// Requires zlib(`NNVIEW_WITH_ZLIB`).
+//
+namespace nnview {
+
+class CompressedStorage {
+ public:
+  CompressedStorage();
+  ~CompressedStorage();
+
+  CompressedStorage(const CompressedStorage &) = delete;
+  CompressedStorage &operator=(const CompressedStorage &) = delete;
+
+  // Size of a decompressed block in bytes. Multiple of every element size.
+  static constexpr size_t kBlockSize = 256 * 1024;
+
+  // Returns nullptr when compression is not available.
+  static std::shared_ptr<CompressedStorage> compress(const uint8_t *data,
+                                                     size_t size,
+                                                     size_t element_size);
+
+  size_t size() const { return _size; }
+  size_t compressed_size() const;
+  size_t num_blocks() const { return _blocks.size(); }
+
+  // Get the decompressed `index`-th block. Returns nullptr on a decode error.
+  // The block stays valid while the returned pointer is held, even if it is
+  // evicted from the cache.
+  std::shared_ptr<const std::vector<uint8_t>> block(size_t index) const;
+
+  // Copy `len` bytes starting at `offset` into `dst`.
+  bool read(size_t offset, size_t len, uint8_t *dst) const;
+
+  // Decompress the whole payload(`size()` bytes) into `dst` without going
+  // through the block cache.
+  bool decompress(uint8_t *dst) const;
+
+ private:
+  struct Block {
+    std::vector<uint8_t> bytes;
+    size_t raw_size = 0;
+    bool stored = false;  // true : `bytes` is the raw(unshuffled) block.
+  };
+
+  // Decode the `index`-th block into `dst`(`raw_size` bytes).
+  bool decode(size_t index, uint8_t *dst) const;
+
+  uint64_t _id;  // Key of the block cache.
+  size_t _size = 0;
+  size_t _element_size = 1;
+  std::vector<Block> _blocks;
+};
+
+struct CompressStats {
+  size_t num_tensors = 0;
+  size_t raw_bytes = 0;
+  size_t compressed_bytes = 0;
+};
+
+// Replace `Tensor::data` of loaded tensors with `Tensor::compressed`.
+// Memory-mapped and shared(deduplicated) payloads are left as is.
+// Compression runs on `num_threads` threads(<= 0 : use all hardware threads).
+CompressStats compress_tensors(std::vector<Tensor> *tensors,
+                               int num_threads = 0);
+
+// Set the number of decompressed blocks kept in the LRU cache.
+void set_decompressed_block_cache_size(size_t num_blocks);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_COMPRESSED_STORAGE_HH_
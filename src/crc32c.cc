@@ -0,0 +1,261 @@
+#include "crc32c.hh"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NNVIEW_CRC32C_SSE42
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define NNVIEW_CRC32C_ARMV8
+#include <arm_acle.h>
+#endif
+
+namespace nnview {
+
+namespace {
+
+// Reflected Castagnoli polynomial.
+constexpr uint32_t kPoly = 0x82F63B78u;
+
+// Block sizes of the three-stream loop. Must be powers of two.
+constexpr size_t kLongBlock = 8192;
+constexpr size_t kShortBlock = 256;
+
+inline uint64_t Load64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Multiply a 32x32 GF(2) matrix by a vector.
+uint32_t Gf2MatrixTimes(const uint32_t *mat, uint32_t vec) {
+  uint32_t sum = 0;
+  while (vec) {
+    if (vec & 1) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+void Gf2MatrixSquare(uint32_t *square, const uint32_t *mat) {
+  for (int n = 0; n < 32; n++) {
+    square[n] = Gf2MatrixTimes(mat, mat[n]);
+  }
+}
+
+// Operator for a single zero bit.
+void OneZeroBitOp(uint32_t *odd) {
+  odd[0] = kPoly;
+  uint32_t row = 1;
+  for (int n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+}
+
+struct Tables {
+  Tables() {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = n;
+      for (int k = 0; k < 8; k++) {
+        crc = (crc & 1) ? ((crc >> 1) ^ kPoly) : (crc >> 1);
+      }
+      slice[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = slice[0][n];
+      for (size_t k = 1; k < 8; k++) {
+        crc = slice[0][crc & 0xff] ^ (crc >> 8);
+        slice[k][n] = crc;
+      }
+    }
+
+    BuildShift(kLongBlock, long_shift);
+    BuildShift(kShortBlock, short_shift);
+  }
+
+  // Tables to apply `len`(power of two) zero bytes to a CRC.
+  static void BuildShift(size_t len, uint32_t shift[4][256]) {
+    uint32_t even[32];
+    uint32_t odd[32];
+    OneZeroBitOp(odd);
+    Gf2MatrixSquare(even, odd);  // 2 zero bits
+    Gf2MatrixSquare(odd, even);  // 4 zero bits
+
+    // The first square gives the operator for one zero byte.
+    const uint32_t *op = even;
+    for (;;) {
+      Gf2MatrixSquare(even, odd);
+      len >>= 1;
+      if (len == 0) {
+        op = even;
+        break;
+      }
+      Gf2MatrixSquare(odd, even);
+      len >>= 1;
+      if (len == 0) {
+        op = odd;
+        break;
+      }
+    }
+
+    for (uint32_t n = 0; n < 256; n++) {
+      shift[0][n] = Gf2MatrixTimes(op, n);
+      shift[1][n] = Gf2MatrixTimes(op, n << 8);
+      shift[2][n] = Gf2MatrixTimes(op, n << 16);
+      shift[3][n] = Gf2MatrixTimes(op, n << 24);
+    }
+  }
+
+  uint32_t slice[8][256];
+  uint32_t long_shift[4][256];
+  uint32_t short_shift[4][256];
+};
+
+const Tables &GetTables() {
+  static const Tables tables;
+  return tables;
+}
+
+inline uint32_t Shift(const uint32_t shift[4][256], uint32_t crc) {
+  return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^
+         shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+}
+
+}  // namespace
+
+// `crc` is the internal(non-inverted) register value.
+static uint32_t Crc32cSoftware(const Tables &t, uint32_t crc, const uint8_t *p,
+                               size_t len) {
+  while (len >= 8) {
+    const uint64_t v = Load64(p) ^ crc;
+    crc = t.slice[7][v & 0xff] ^ t.slice[6][(v >> 8) & 0xff] ^
+          t.slice[5][(v >> 16) & 0xff] ^ t.slice[4][(v >> 24) & 0xff] ^
+          t.slice[3][(v >> 32) & 0xff] ^ t.slice[2][(v >> 40) & 0xff] ^
+          t.slice[1][(v >> 48) & 0xff] ^ t.slice[0][v >> 56];
+    p += 8;
+    len -= 8;
+  }
+  while (len--) {
+    crc = t.slice[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(NNVIEW_CRC32C_SSE42) || defined(NNVIEW_CRC32C_ARMV8)
+
+#if defined(NNVIEW_CRC32C_SSE42)
+#define NNVIEW_CRC32C_TARGET __attribute__((target("sse4.2")))
+#define NNVIEW_CRC32C_U64(crc, v) uint32_t(_mm_crc32_u64((crc), (v)))
+#define NNVIEW_CRC32C_U8(crc, v) _mm_crc32_u8((crc), (v))
+#else
+#define NNVIEW_CRC32C_TARGET
+#define NNVIEW_CRC32C_U64(crc, v) __crc32cd((crc), (v))
+#define NNVIEW_CRC32C_U8(crc, v) __crc32cb((crc), (v))
+#endif
+
+// Three streams of `block` bytes are checked at once and merged by shifting
+// the CRC of the earlier stream over the later one.
+NNVIEW_CRC32C_TARGET static void Crc32cStreams(const uint32_t shift[4][256],
+                                               size_t block, uint32_t *crc,
+                                               const uint8_t **p,
+                                               size_t *len) {
+  while (*len >= 3 * block) {
+    uint32_t crc0 = *crc;
+    uint32_t crc1 = 0;
+    uint32_t crc2 = 0;
+    const uint8_t *s = *p;
+    const uint8_t *end = s + block;
+    do {
+      crc0 = NNVIEW_CRC32C_U64(crc0, Load64(s));
+      crc1 = NNVIEW_CRC32C_U64(crc1, Load64(s + block));
+      crc2 = NNVIEW_CRC32C_U64(crc2, Load64(s + 2 * block));
+      s += 8;
+    } while (s < end);
+    crc0 = Shift(shift, crc0) ^ crc1;
+    *crc = Shift(shift, crc0) ^ crc2;
+    *p += 3 * block;
+    *len -= 3 * block;
+  }
+}
+
+NNVIEW_CRC32C_TARGET static uint32_t Crc32cHardware(const Tables &t,
+                                                    uint32_t crc,
+                                                    const uint8_t *p,
+                                                    size_t len) {
+  Crc32cStreams(t.long_shift, kLongBlock, &crc, &p, &len);
+  Crc32cStreams(t.short_shift, kShortBlock, &crc, &p, &len);
+
+  while (len >= 8) {
+    crc = NNVIEW_CRC32C_U64(crc, Load64(p));
+    p += 8;
+    len -= 8;
+  }
+  while (len--) {
+    crc = NNVIEW_CRC32C_U8(crc, *p++);
+  }
+  return crc;
+}
+
+static bool HasHardwareCrc() {
+#if defined(NNVIEW_CRC32C_SSE42)
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+#else
+  return true;
+#endif
+}
+
+#endif
+
+uint32_t crc32c(const void *data, size_t len, uint32_t crc) {
+  const Tables &t = GetTables();
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+
+  crc = ~crc;
+#if defined(NNVIEW_CRC32C_SSE42) || defined(NNVIEW_CRC32C_ARMV8)
+  if (HasHardwareCrc()) {
+    return ~Crc32cHardware(t, crc, p, len);
+  }
+#endif
+  return ~Crc32cSoftware(t, crc, p, len);
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+  if (len2 == 0) {
+    return crc1;
+  }
+
+  uint32_t even[32];
+  uint32_t odd[32];
+  OneZeroBitOp(odd);
+  Gf2MatrixSquare(even, odd);  // 2 zero bits
+  Gf2MatrixSquare(odd, even);  // 4 zero bits
+
+  // Apply `len2` zero bytes to `crc1`.
+  for (;;) {
+    Gf2MatrixSquare(even, odd);
+    if (len2 & 1) {
+      crc1 = Gf2MatrixTimes(even, crc1);
+    }
+    len2 >>= 1;
+    if (len2 == 0) {
+      break;
+    }
+    Gf2MatrixSquare(odd, even);
+    if (len2 & 1) {
+      crc1 = Gf2MatrixTimes(odd, crc1);
+    }
+    len2 >>= 1;
+    if (len2 == 0) {
+      break;
+    }
+  }
+
+  return crc1 ^ crc2;
+}
+
+}  // namespace nnview
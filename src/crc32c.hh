@@ -0,0 +1,28 @@
+#ifndef NNVIEW_CRC32C_HH_
+#define NNVIEW_CRC32C_HH_
+
+#include <cstddef>
+#include <cstdint>
+
+//
+// CRC-32C(Castagnoli) checksum.
+//
+// Uses the SSE4.2 `crc32` instruction on x86-64(detected at runtime) or the
+// ARMv8 CRC32 extension(when enabled at compile time), processing three
+// independent streams to hide the latency of the instruction. Falls back to a
+// slicing-by-8 table implementation otherwise.
+//
+namespace nnview {
+
+// Update `crc` with `len` bytes at `data`. Pass the CRC of the preceding bytes
+// as `crc`(0 for the first call).
+uint32_t crc32c(const void *data, size_t len, uint32_t crc = 0);
+
+// CRC of the concatenation of two blocks, where `crc1` is the CRC of the first
+// block and `crc2` is the CRC of the second block of `len2` bytes. Used to
+// compute the CRC of a large file from chunks checked in parallel.
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_CRC32C_HH_
@@ -1,18 +1,28 @@
 #ifndef NNVIEW_DATATYPES_H_
 #define NNVIEW_DATATYPES_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 
+#include "symbol-table.hh"
+
 namespace nnview {
 
+class MappedFile;
+class CompressedStorage;
+class SparseStorage;
+
+// Names are symbols in `Graph::symbols`.
 struct Slot
 {
-  std::string name;       // name of tensor/weight
-  std::string slot_name;  // Appear in connection name on GUI node
+  Symbol name;       // name of tensor/weight
+  Symbol slot_name;  // Appear in connection name on GUI node
   int id; // tensor id
 
-  Slot(const std::string &_name, const std::string &_slot_name, int _id) : name(_name), slot_name(_slot_name), id(_id) {}
+  Slot(Symbol _name, Symbol _slot_name, int _id) : name(_name), slot_name(_slot_name), id(_id) {}
 };
 
 enum LayerType
@@ -22,12 +32,13 @@ enum LayerType
   LAYER_LINEAR_FUNCTION,
   LAYER_RELU,
   LAYER_TENSOR,
+  LAYER_UNKNOWN, // Layer type which nnview does not know. Only `name` is shown.
 };
 
 class Node
 {
  public:
-  LayerType type;
+  LayerType type = LAYER_UNKNOWN;
   int id = 0; // Unique node id
   int depth = 0; // Depth from the input node. Use this value for initial node layout.
   std::string name;
@@ -36,15 +47,105 @@ class Node
   std::vector<Slot> outputs;
 };
 
+enum DataType
+{
+  DTYPE_FLOAT32,
+  DTYPE_FLOAT16,
+  DTYPE_BFLOAT16,
+  DTYPE_FLOAT64,
+  DTYPE_INT8,
+  DTYPE_UINT8,
+  DTYPE_INT32,
+};
+
+// Size of an element in bytes.
+inline size_t get_dtype_size(DataType dtype) {
+  switch (dtype) {
+    case DTYPE_FLOAT32:
+      return 4;
+    case DTYPE_FLOAT16:
+      return 2;
+    case DTYPE_BFLOAT16:
+      return 2;
+    case DTYPE_FLOAT64:
+      return 8;
+    case DTYPE_INT8:
+      return 1;
+    case DTYPE_UINT8:
+      return 1;
+    case DTYPE_INT32:
+      return 4;
+  }
+  return 0;
+}
+
+inline const char *get_dtype_name(DataType dtype) {
+  switch (dtype) {
+    case DTYPE_FLOAT32:
+      return "float32";
+    case DTYPE_FLOAT16:
+      return "float16";
+    case DTYPE_BFLOAT16:
+      return "bfloat16";
+    case DTYPE_FLOAT64:
+      return "float64";
+    case DTYPE_INT8:
+      return "int8";
+    case DTYPE_UINT8:
+      return "uint8";
+    case DTYPE_INT32:
+      return "int32";
+  }
+  return "unknown";
+}
+
 class Tensor
 {
  public:
   Tensor() {}
 
   std::string name;
-  std::string datatype = "float32"; // TODO(LTE): Support more data types.
+  DataType dtype = DTYPE_FLOAT32; // Element type of the payload.
   std::vector<int> shape;
-  std::vector<float> data;
+
+  // Payload in its native element type(`dtype`). Use `tensor_to_float` in
+  // tensor-convert.hh to get float values.
+  std::vector<uint8_t> data;
+
+  // Zero-copy storage. When `mapping` is set, the payload is not copied into
+  // `data`(left empty) and `mapped_data` points into the mapped file.
+  // NOTE: `mapped_data` may not be aligned to the element size.
+  std::shared_ptr<MappedFile> mapping;
+  const uint8_t *mapped_data = nullptr;
+
+  // Immutable payload shared with other tensors having the identical
+  // content(see io/tensor-dedup.hh). `mapped_data` points into it.
+  std::shared_ptr<const std::vector<uint8_t>> shared_data;
+
+  // Block-compressed payload(see compressed-storage.hh). When set, `data` is
+  // empty and `raw_data()` returns nullptr. Use `tensor_to_float` to read
+  // values.
+  std::shared_ptr<const CompressedStorage> compressed;
+
+  // Sparse(CSR) payload of a mostly-zero tensor(see sparse-storage.hh). When
+  // set, `data` is empty and `raw_data()` returns nullptr. Use
+  // `tensor_to_float` or iterate the nonzeros.
+  std::shared_ptr<const SparseStorage> sparse;
+
+  size_t num_items = 0;
+
+  // Location of the payload. Used to read the payload on demand when the
+  // tensor was loaded lazily(`loaded` = false).
+  std::string source_filename;
+  uint64_t source_offset = 0;  // in bytes
+  bool loaded = true;
+
+  // nullptr for compressed and sparse tensors.
+  const uint8_t *raw_data() const {
+    return mapped_data ? mapped_data : (data.empty() ? nullptr : data.data());
+  }
+
+  size_t byte_size() const { return num_items * get_dtype_size(dtype); }
 };
 
 class Graph
@@ -55,6 +156,9 @@ class Graph
 
   std::vector<Node> nodes;
   std::vector<Tensor> tensors;
+
+  // Interned names of slots.
+  SymbolTable symbols;
 };
 
 
@@ -24,10 +24,16 @@
 
 #include "colormap.hh"
 #include "gui_component.hh"
+#include "io/checkpoint-series.hh"
+#include "io/tensor-prefetcher.hh"
+#include "io/tensor-reloader.hh"
+#include "sparse-storage.hh"
+#include "tensor-convert.hh"
 
 #include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
 
@@ -43,33 +49,80 @@ inline uint8_t ftoc(const float x) {
   return uint8_t(i);
 }
 
+static void set_color(const float x, uint8_t *rgba) {
+  nnview::vec3 rgb = nnview::viridis(x);
+  rgba[0] = ftoc(rgb[0]);
+  rgba[1] = ftoc(rgb[1]);
+  rgba[2] = ftoc(rgb[2]);
+  rgba[3] = 255;
+}
+
+// Colormap only the nonzeros of a sparse tensor. Other pixels get the color
+// of zero.
+static std::vector<uint8_t> sparse_tensor_to_color(
+    const nnview::Tensor &tensor) {
+  const size_t num_pixels = size_t(tensor.shape[0]) * size_t(tensor.shape[1]);
+  std::vector<uint8_t> img(num_pixels * 4);
+
+  float min_value = 0.0f;
+  float max_value = 0.0f;
+  tensor_min_max(tensor, &min_value, &max_value);
+
+  std::cout << "tensor min/max = " << min_value << ", " << max_value
+            << " nnz = " << tensor.sparse->nnz() << std::endl;
+
+  uint8_t zero_color[4];
+  set_color((0.0f - min_value) / (max_value - min_value), zero_color);
+  for (size_t i = 0; i < num_pixels; i++) {
+    memcpy(&img[4 * i], zero_color, 4);
+  }
+
+  const SparseStorage &sparse = *tensor.sparse;
+  for (size_t r = 0; r < sparse.rows(); r++) {
+    for (size_t k = size_t(sparse.row_ptr()[r]);
+         k < size_t(sparse.row_ptr()[r + 1]); k++) {
+      const size_t i = r * sparse.cols() + sparse.col_indices()[k];
+      if (i >= num_pixels) {
+        break;
+      }
+      float value;
+      convert_to_float(tensor.dtype,
+                       sparse.values() + k * sparse.element_size(), 1, &value);
+      set_color((value - min_value) / (max_value - min_value), &img[4 * i]);
+    }
+  }
+
+  return img;
+}
+
 static std::vector<uint8_t> tensor_to_color(const nnview::Tensor &tensor) {
+  if (tensor.sparse) {
+    return sparse_tensor_to_color(tensor);
+  }
+
   std::vector<uint8_t> img;
-  img.resize(size_t(tensor.shape[0] * tensor.shape[1] * 4));
+  img.resize(size_t(tensor.shape[0]) * size_t(tensor.shape[1]) * 4);
 
   // find max/min value
   float min_value = std::numeric_limits<float>::max();
   float max_value = -std::numeric_limits<float>::max();
 
-  for (size_t i = 0; i < size_t(tensor.shape[0] * tensor.shape[1]); i++) {
-    min_value = std::min(min_value, tensor.data[i]);
-    max_value = std::max(max_value, tensor.data[i]);
+  // Convert the 2D slice into float regardless of the tensor's dtype.
+  std::vector<float> values(size_t(tensor.shape[0]) * size_t(tensor.shape[1]));
+  tensor_to_float(tensor, 0, values.size(), values.data());
+
+  for (size_t i = 0; i < values.size(); i++) {
+    min_value = std::min(min_value, values[i]);
+    max_value = std::max(max_value, values[i]);
   }
 
   std::cout << "tensor min/max = " << min_value << ", " << max_value
             << std::endl;
 
-  for (size_t i = 0; i < size_t(tensor.shape[0] * tensor.shape[1]); i++) {
+  for (size_t i = 0; i < values.size(); i++) {
     // normalize.
-    const float x = (tensor.data[i] - min_value) / (max_value - min_value);
-    nnview::vec3 rgb = nnview::viridis(x);
-
-    // std::cout << rgb[0] << ", " << rgb[1] << ", " << rgb[2] << std::endl;
-
-    img[4 * i + 0] = ftoc(rgb[0]);
-    img[4 * i + 1] = ftoc(rgb[1]);
-    img[4 * i + 2] = ftoc(rgb[2]);
-    img[4 * i + 3] = 255;
+    const float x = (values[i] - min_value) / (max_value - min_value);
+    set_color(x, &img[4 * i]);
   }
 
   return img;
@@ -121,6 +174,46 @@ static void show_tensor_value(
 
   size_t num_rect_draws = 0;
 
+  auto draw_value = [&](size_t x, size_t y, float value) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%4.3f", double(value));
+
+    ImVec2 bmin = ImVec2(window_pos.x + tensor_image_widget_offset.x +
+                             step * x + left_margin + cell_left_margin,
+                         window_pos.y + tensor_image_widget_offset.y +
+                             step * y + top_margin + cell_top_margin);
+
+    // Prevent too many AddRectFilled call for safety.
+    // ImGui's default uses 16bit indices, so drawing too many rects will
+    // cause the assertion failure inside imgui.
+    // 1024 = heuristic value.
+    if (num_rect_draws < 1024) {
+      ImVec2 text_size = ImGui::CalcTextSize(buf);
+
+      ImVec2 fill_bmin = ImVec2(bmin.x - 4, bmin.y - 4);
+      ImVec2 fill_bmax =
+          ImVec2(bmin.x + text_size.x + 4, bmin.y + text_size.y + 4);
+
+      // Draw quad for background color
+      ImGui::GetWindowDrawList()->AddRectFilled(
+          fill_bmin, fill_bmax,
+          ImGui::GetColorU32(ImVec4(0.2f, 0.2f, 0.2f, 0.4f * alpha)),
+          /* rounding */ 4.0f);
+
+      // HACK
+      // num_rect_draws++;
+    }
+
+    ImGui::SetCursorScreenPos(bmin);
+
+    ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, alpha), "%s", buf);
+  };
+
+  auto is_visible_x = [&](size_t x) {
+    return ((step + 1) * x >= -tensor_image_widget_offset.x) &&
+           ((step * x) <= (-tensor_image_widget_offset.x + window_size.x));
+  };
+
   // Draw values for only visible area
   for (size_t y = 0; y < height; y++) {
     // Assume offset of image item from window corner(upper-left) is rather
@@ -133,50 +226,33 @@ static void show_tensor_value(
       continue;
     }
 
-    for (size_t x = 0; x < width; x++) {
-      // TODO(LTE): Compute bound outside of for loop.
-      if ((step + 1) * x < -tensor_image_widget_offset.x) {
+    if (tensor.sparse) {
+      // Only nonzeros are shown.
+      const SparseStorage &sparse = *tensor.sparse;
+      if ((y >= sparse.rows()) || (sparse.cols() != width)) {
         continue;
       }
-
-      if ((step * x) > (-tensor_image_widget_offset.x + window_size.x)) {
-        continue;
+      for (size_t k = size_t(sparse.row_ptr()[y]);
+           k < size_t(sparse.row_ptr()[y + 1]); k++) {
+        const size_t x = sparse.col_indices()[k];
+        if (is_visible_x(x)) {
+          float value;
+          convert_to_float(tensor.dtype,
+                           sparse.values() + k * sparse.element_size(), 1,
+                           &value);
+          draw_value(x, y, value);
+        }
       }
+      continue;
+    }
 
-      const float value = tensor.data[y * width + x];
-
-      char buf[64];
-      snprintf(buf, sizeof(buf), "%4.3f", double(value));
-
-      ImVec2 bmin = ImVec2(window_pos.x + tensor_image_widget_offset.x +
-                               step * x + left_margin + cell_left_margin,
-                           window_pos.y + tensor_image_widget_offset.y +
-                               step * y + top_margin + cell_top_margin);
-
-      // Prevent too many AddRectFilled call for safety.
-      // ImGui's default uses 16bit indices, so drawing too many rects will
-      // cause the assertion failure inside imgui.
-      // 1024 = heuristic value.
-      if (num_rect_draws < 1024) {
-        ImVec2 text_size = ImGui::CalcTextSize(buf);
-
-        ImVec2 fill_bmin = ImVec2(bmin.x - 4, bmin.y - 4);
-        ImVec2 fill_bmax =
-            ImVec2(bmin.x + text_size.x + 4, bmin.y + text_size.y + 4);
-
-        // Draw quad for background color
-        ImGui::GetWindowDrawList()->AddRectFilled(
-            fill_bmin, fill_bmax,
-            ImGui::GetColorU32(ImVec4(0.2f, 0.2f, 0.2f, 0.4f * alpha)),
-            /* rounding */ 4.0f);
-
-        // HACK
-        // num_rect_draws++;
+    for (size_t x = 0; x < width; x++) {
+      // TODO(LTE): Compute bound outside of for loop.
+      if (!is_visible_x(x)) {
+        continue;
       }
 
-      ImGui::SetCursorScreenPos(bmin);
-
-      ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, alpha), "%s", buf);
+      draw_value(x, y, tensor_value(tensor, y * width + x));
     }
   }
 }
@@ -407,14 +483,26 @@ void GUIContext::draw_imnodes() {
 
           // std::cout << "selected tensor idx = " << std::to_string(tensor_idx)
           // << "\n";
-          if (tensor_idx != -1) {
-            _active_tensor_idx = tensor_idx;
+          if ((tensor_idx != -1) && (tensor_idx != _active_tensor_idx)) {
+            if (prepare_tensor(size_t(tensor_idx))) {
+              _active_tensor_idx = tensor_idx;
+            }
           }
         }
       }
     }
   }
 
+  // Warm up the neighbours of the newly selected tensor.
+  if (_prefetcher && (_active_tensor_idx > -1) &&
+      (_active_tensor_idx != _prefetch_center_idx)) {
+    _prefetch_center_idx = _active_tensor_idx;
+    for (const size_t idx :
+         _prefetcher->request(_graph, size_t(_active_tensor_idx))) {
+      evict_tensor(idx);
+    }
+  }
+
 #if 0
     if (ImGui::Button("Flow")) {
       ed::Flow(/*link_id */ 1);
@@ -425,6 +513,114 @@ void GUIContext::draw_imnodes() {
   ImGui::End();
 }
 
+bool GUIContext::prepare_tensor(size_t tensor_idx) {
+  if (tensor_idx >= _graph.tensors.size()) {
+    return false;
+  }
+
+  Tensor &tensor = _graph.tensors[tensor_idx];
+
+  if (!tensor.loaded) {
+    std::cout << "Load tensor data : " << tensor.name << "\n";
+    if (!load_tensor_payload(&tensor, _weights_load_option)) {
+      std::cerr << "Failed to load tensor data : " << tensor.source_filename
+                << "\n";
+      return false;
+    }
+  }
+
+  if (tensor_idx < _tensor_texture_ids.size()) {
+    if (_tensor_texture_ids[tensor_idx] == 0) {
+      _tensor_texture_ids[tensor_idx] = gen_gl_texture(tensor);
+    }
+  }
+
+  return true;
+}
+
+void GUIContext::select_snapshot(size_t index) {
+  if (!_series || (index == _series->current())) {
+    return;
+  }
+
+  if (!_series->select(index, &_graph)) {
+    return;
+  }
+
+  // Textures are recreated with the new payload when the tensor is shown.
+  for (auto &texid : _tensor_texture_ids) {
+    if (texid != 0) {
+      glDeleteTextures(1, &texid);
+      texid = 0;
+    }
+  }
+  if (_active_tensor_idx > -1) {
+    prepare_tensor(size_t(_active_tensor_idx));
+  }
+}
+
+void GUIContext::update_reloaded_tensors() {
+  if (!_reloader) {
+    return;
+  }
+
+  for (auto &item : _reloader->fetch()) {
+    const size_t idx = item.first;
+    if (idx >= _graph.tensors.size()) {
+      continue;
+    }
+    _graph.tensors[idx] = std::move(item.second);
+
+    // Only the texture of the reloaded tensor is regenerated. Tensors not
+    // shown yet get their texture in `prepare_tensor` as usual.
+    bool shown = (int(idx) == _active_tensor_idx);
+    if ((idx < _tensor_texture_ids.size()) && (_tensor_texture_ids[idx] != 0)) {
+      glDeleteTextures(1, &_tensor_texture_ids[idx]);
+      _tensor_texture_ids[idx] = 0;
+      shown = true;
+    }
+    if (shown) {
+      prepare_tensor(idx);
+    }
+  }
+}
+
+void GUIContext::update_prefetched_tensors() {
+  if (!_prefetcher) {
+    return;
+  }
+
+  for (auto &item : _prefetcher->fetch(_graph)) {
+    const size_t idx = item.first;
+    _graph.tensors[idx] = std::move(item.second);
+    prepare_tensor(idx);
+  }
+}
+
+void GUIContext::evict_tensor(size_t tensor_idx) {
+  if ((tensor_idx >= _graph.tensors.size()) ||
+      (int(tensor_idx) == _active_tensor_idx)) {
+    return;
+  }
+
+  Tensor &tensor = _graph.tensors[tensor_idx];
+  if (tensor.source_filename.empty()) {
+    // Cannot be loaded again.
+    return;
+  }
+
+  std::vector<uint8_t>().swap(tensor.data);
+  tensor.mapping.reset();
+  tensor.mapped_data = nullptr;
+  tensor.loaded = false;
+
+  if ((tensor_idx < _tensor_texture_ids.size()) &&
+      (_tensor_texture_ids[tensor_idx] != 0)) {
+    glDeleteTextures(1, &_tensor_texture_ids[tensor_idx]);
+    _tensor_texture_ids[tensor_idx] = 0;
+  }
+}
+
 void GUIContext::init() {
   if (_editor_context != nullptr) {
     // ???
@@ -441,7 +637,12 @@ void GUIContext::init() {
 
     // std::cout << "tensor "  << _graph.tensors[i].shape[0] << ", " <<
     // _graph.tensors[i].shape[1] << std::endl;
-    GLuint texid = gen_gl_texture(_graph.tensors[i]);
+
+    // Texture for lazily loaded tensor is created in `prepare_tensor`.
+    GLuint texid = 0;
+    if (_graph.tensors[i].loaded) {
+      texid = gen_gl_texture(_graph.tensors[i]);
+    }
 
     _tensor_texture_ids.push_back(texid);
   }
@@ -481,7 +682,7 @@ void GUIContext::init_imnode_graph() {
       // Create pin id
       for (size_t p = 0; p < node.inputs.size(); p++) {
         const Slot &slot = node.inputs[p];
-        std::string name = slot.slot_name;
+        std::string name = _graph.symbols.str(slot.slot_name);
 
         Pin pin(uint32_t(GetNextId()), name, PinType::Flow);
 
@@ -490,7 +691,7 @@ void GUIContext::init_imnode_graph() {
 
       for (size_t p = 0; p < node.outputs.size(); p++) {
         const Slot &slot = node.outputs[p];
-        std::string name = slot.slot_name;
+        std::string name = _graph.symbols.str(slot.slot_name);
 
         Pin pin(uint32_t(GetNextId()), name, PinType::Flow);
 
@@ -649,9 +850,23 @@ void GUIContext::draw_tensor() {
                            ? _graph.tensors[size_t(_active_tensor_idx)].name
                            : "no selection";
     ImGui::Text("Tensor : %s", name.c_str());
+    if (_active_tensor_idx > -1) {
+      ImGui::Text(
+          "dtype : %s",
+          get_dtype_name(_graph.tensors[size_t(_active_tensor_idx)].dtype));
+    }
 
     ImGui::SliderFloat("scale", &scale, 0.0f, 100.0f);
 
+    if (_series && (_series->size() > 1)) {
+      int snapshot = int(_series->current());
+      if (ImGui::SliderInt("snapshot", &snapshot, 0,
+                           int(_series->size()) - 1)) {
+        select_snapshot(size_t(snapshot));
+      }
+      ImGui::Text("%s", _series->name(_series->current()).c_str());
+    }
+
     ImVec2 pos = ImGui::GetCursorScreenPos();
     ImVec2 win_pos = ImGui::GetWindowPos();
 
@@ -679,6 +894,10 @@ void GUIContext::draw_tensor() {
   GLuint texid = _tensor_texture_ids[size_t(_active_tensor_idx)];
   const Tensor &tensor = _graph.tensors[size_t(_active_tensor_idx)];
 
+  if ((texid == 0) || !tensor.loaded) {
+    return;
+  }
+
   // Create child so that scroll bar only effective to the image region.
   ImGui::Begin("Tensor Image", /* p_open */ nullptr,
                ImGuiWindowFlags_HorizontalScrollbar);
@@ -13,6 +13,7 @@
 #endif
 
 #include "datatypes.h"
+#include "io/weights-loader.hh"
 
 #include <string>
 #include <vector>
@@ -23,6 +24,9 @@ namespace ed = ax::NodeEditor;
 namespace nnview {
 
 struct ImNode;
+class CheckpointSeries;
+class TensorReloader;
+class TensorPrefetcher;
 
 enum class PinType {
   Flow,
@@ -92,8 +96,26 @@ class GUIContext {
   std::map<int, int> _node_id_to_imnode_idx_map; // <NodeId, index to _imnodes>
 
   // OpenGL texture id for displaying Tensor as Texture(Image)
+  // 0 = not created yet(tensor is not loaded).
   std::vector<GLuint> _tensor_texture_ids;
 
+  // Used to load the payload of lazily loaded tensors.
+  WeightsLoadOption _weights_load_option;
+
+  // Set when a checkpoint series is opened. `_graph` holds the tensors of
+  // the selected snapshot.
+  CheckpointSeries *_series = nullptr;
+
+  // Set in the file-watch mode. Tensors reloaded in the background are
+  // applied to `_graph` by `update_reloaded_tensors`.
+  TensorReloader *_reloader = nullptr;
+
+  // Set when lazily loaded tensors are prefetched. Neighbours of the active
+  // tensor are loaded in the background and applied by
+  // `update_prefetched_tensors`.
+  TensorPrefetcher *_prefetcher = nullptr;
+  int _prefetch_center_idx = -1;  // `_active_tensor_idx` of the last request
+
   GLuint _background_texture_id = 0;
 
   ed::EditorContext *_editor_context = nullptr;
@@ -109,6 +131,25 @@ class GUIContext {
 
   void draw_imnodes();
 
+  // Load the payload of the tensor and create its texture if not yet done.
+  // Returns false when the payload cannot be loaded.
+  bool prepare_tensor(size_t tensor_idx);
+
+  // Show the `index`-th snapshot of `_series`.
+  void select_snapshot(size_t index);
+
+  // Replace tensors reloaded by `_reloader` and regenerate their textures.
+  // Call once per frame.
+  void update_reloaded_tensors();
+
+  // Apply tensors loaded by `_prefetcher` and create their textures.
+  // Call once per frame.
+  void update_prefetched_tensors();
+
+  // Drop the payload and texture of a lazily loaded tensor. It is loaded
+  // again by `prepare_tensor`.
+  void evict_tensor(size_t tensor_idx);
+
   // Draw Tensor in active section.
   void draw_tensor();
 
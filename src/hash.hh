@@ -0,0 +1,18 @@
+#ifndef NNVIEW_HASH_HH_
+#define NNVIEW_HASH_HH_
+
+#include <cstddef>
+#include <cstdint>
+
+//
+// Fast non-cryptographic hash functions.
+//
+namespace nnview {
+
+// 64-bit hash of `len` bytes at `data`(XXH64 algorithm). `data` does not need
+// to be aligned.
+uint64_t hash64(const void *data, size_t len, uint64_t seed = 0);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_HASH_HH_
@@ -0,0 +1,638 @@
+#include "io/archive.hh"
+#include "io/path-util.hh"
+
+#if defined(NNVIEW_WITH_ZLIB)
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#include <zlib.h>
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace nnview {
+
+namespace {
+
+constexpr size_t kTarBlockSize = 512;
+
+inline uint16_t ReadU16(const uint8_t *p) {
+  return uint16_t(p[0] | (p[1] << 8));
+}
+
+inline uint32_t ReadU32(const uint8_t *p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+         (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t ReadU64(const uint8_t *p) {
+  return uint64_t(ReadU32(p)) | (uint64_t(ReadU32(p + 4)) << 32);
+}
+
+inline bool EndsWith(const std::string &s, const std::string &suffix) {
+  return (s.size() >= suffix.size()) &&
+         (s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+}  // namespace
+
+// Resolve `.`, `..` and empty components. e.g. "./a//b/../c" -> "a/c"
+static std::string NormalizePath(const std::string &path) {
+  std::vector<std::string> components;
+  size_t begin = 0;
+  while (begin <= path.size()) {
+    size_t end = path.find_first_of("/\\", begin);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    const std::string c = path.substr(begin, end - begin);
+    if (c.compare("..") == 0) {
+      if (!components.empty()) {
+        components.pop_back();
+      }
+    } else if (!c.empty() && (c.compare(".") != 0)) {
+      components.push_back(c);
+    }
+    begin = end + 1;
+  }
+
+  std::string normalized;
+  for (const auto &c : components) {
+    if (!normalized.empty()) {
+      normalized += '/';
+    }
+    normalized += c;
+  }
+  return normalized;
+}
+
+// Parse a numeric field of tar header. Octal text or base-256(GNU extension
+// for values >= 8 GB).
+static bool ParseTarNumber(const uint8_t *p, size_t len, uint64_t *value) {
+  uint64_t v = 0;
+  if (p[0] & 0x80) {
+    for (size_t i = 0; i < len; i++) {
+      const uint8_t c = (i == 0) ? (p[0] & 0x7f) : p[i];
+      if (v >> 56) {
+        return false;
+      }
+      v = (v << 8) | c;
+    }
+  } else {
+    size_t i = 0;
+    while ((i < len) && (p[i] == ' ')) {
+      i++;
+    }
+    for (; (i < len) && (p[i] >= '0') && (p[i] <= '7'); i++) {
+      if (v >> 61) {
+        return false;
+      }
+      v = (v << 3) | uint64_t(p[i] - '0');
+    }
+    if ((i < len) && (p[i] != ' ') && (p[i] != '\0')) {
+      return false;
+    }
+  }
+  (*value) = v;
+  return true;
+}
+
+static bool IsZeroBlock(const uint8_t *p) {
+  for (size_t i = 0; i < kTarBlockSize; i++) {
+    if (p[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Verify the header checksum. The checksum field is counted as spaces.
+static bool IsTarHeader(const uint8_t *p) {
+  uint64_t expected = 0;
+  if (!ParseTarNumber(p + 148, 8, &expected)) {
+    return false;
+  }
+
+  uint64_t unsigned_sum = 0;
+  int64_t signed_sum = 0;  // Some old tar implementations use signed char.
+  for (size_t i = 0; i < kTarBlockSize; i++) {
+    const uint8_t c = ((i >= 148) && (i < 156)) ? uint8_t(' ') : p[i];
+    unsigned_sum += c;
+    signed_sum += int8_t(c);
+  }
+
+  return (expected == unsigned_sum) || (int64_t(expected) == signed_sum);
+}
+
+// NUL-terminated(or full length) string field.
+static std::string TarString(const uint8_t *p, size_t len) {
+  const uint8_t *end = std::find(p, p + len, uint8_t(0));
+  return std::string(reinterpret_cast<const char *>(p), size_t(end - p));
+}
+
+// Parse pax extended header records("<len> <key>=<value>\n").
+static void ParsePaxRecords(const uint8_t *p, size_t len, std::string *path,
+                            uint64_t *size, bool *has_size) {
+  size_t pos = 0;
+  while (pos < len) {
+    size_t record_len = 0;
+    size_t i = pos;
+    while ((i < len) && (p[i] >= '0') && (p[i] <= '9')) {
+      record_len = record_len * 10 + size_t(p[i] - '0');
+      i++;
+    }
+    // The record includes the length field, the space and the trailing LF.
+    if ((i == pos) || (i >= len) || (p[i] != ' ') ||
+        (record_len < i - pos + 2) || (record_len > len - pos)) {
+      return;
+    }
+
+    // Strip the trailing LF.
+    const std::string record(reinterpret_cast<const char *>(p + i + 1),
+                             pos + record_len - i - 2);
+    const size_t eq = record.find('=');
+    if (eq != std::string::npos) {
+      const std::string key = record.substr(0, eq);
+      const std::string value = record.substr(eq + 1);
+      if (key.compare("path") == 0) {
+        (*path) = value;
+      } else if (key.compare("size") == 0) {
+        (*size) = std::strtoull(value.c_str(), nullptr, 10);
+        (*has_size) = true;
+      }
+    }
+
+    pos += record_len;
+  }
+}
+
+#if defined(NNVIEW_WITH_ZLIB)
+// Inflate exactly `len` bytes into `dst`.
+static bool InflateTo(z_stream *zs, const uint8_t **src, size_t *src_remain,
+                      uint8_t *dst, size_t len) {
+  // zlib uses 32bit lengths, so feed large buffers in chunks.
+  const size_t kMaxChunk = size_t(1) << 30;
+
+  while (len > 0) {
+    if ((zs->avail_in == 0) && (*src_remain > 0)) {
+      const size_t n = std::min(*src_remain, kMaxChunk);
+      zs->next_in = const_cast<Bytef *>(*src);
+      zs->avail_in = uInt(n);
+      (*src) += n;
+      (*src_remain) -= n;
+    }
+
+    const size_t n = std::min(len, kMaxChunk);
+    zs->next_out = dst;
+    zs->avail_out = uInt(n);
+
+    int ret = inflate(zs, Z_NO_FLUSH);
+    if ((ret != Z_OK) && (ret != Z_STREAM_END)) {
+      return false;
+    }
+
+    const size_t produced = n - size_t(zs->avail_out);
+    dst += produced;
+    len -= produced;
+
+    if ((ret == Z_STREAM_END) && (len > 0)) {
+      // Stream is shorter than expected.
+      return false;
+    }
+
+    if ((produced == 0) && (zs->avail_in == 0) && (*src_remain == 0)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Decompress whole gzip data.
+static bool Gunzip(const uint8_t *src, size_t size, std::vector<uint8_t> *dst,
+                   std::string *err) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+    (*err) = "Failed to initialize zlib.";
+    return false;
+  }
+
+  // The last 4 bytes are the uncompressed size modulo 2^32. Use it as a hint
+  // (bounded by the maximum compression ratio of deflate).
+  size_t capacity = 1024 * 1024;
+  if (size >= 18) {
+    capacity = std::max(
+        capacity, std::min(size_t(ReadU32(src + size - 4)), size * 1032));
+  }
+  dst->resize(capacity);
+
+  const size_t kMaxChunk = size_t(1) << 30;
+  size_t src_remain = size;
+  size_t produced = 0;
+  int ret = Z_OK;
+  while (ret != Z_STREAM_END) {
+    if ((zs.avail_in == 0) && (src_remain > 0)) {
+      const size_t n = std::min(src_remain, kMaxChunk);
+      zs.next_in = const_cast<Bytef *>(src);
+      zs.avail_in = uInt(n);
+      src += n;
+      src_remain -= n;
+    }
+
+    if (produced == dst->size()) {
+      dst->resize(dst->size() * 2);
+    }
+    const size_t n = std::min(dst->size() - produced, kMaxChunk);
+    zs.next_out = dst->data() + produced;
+    zs.avail_out = uInt(n);
+
+    ret = inflate(&zs, Z_NO_FLUSH);
+    if ((ret != Z_OK) && (ret != Z_STREAM_END)) {
+      break;
+    }
+    produced += n - size_t(zs.avail_out);
+
+    if ((ret == Z_OK) && (zs.avail_in == 0) && (src_remain == 0) &&
+        (zs.avail_out != 0)) {
+      // Input exhausted before the end of stream.
+      ret = Z_DATA_ERROR;
+      break;
+    }
+  }
+
+  inflateEnd(&zs);
+
+  if (ret != Z_STREAM_END) {
+    (*err) = "Failed to decompress gzip data.";
+    dst->clear();
+    return false;
+  }
+
+  dst->resize(produced);
+  return true;
+}
+#endif
+
+bool Archive::is_archive_filename(const std::string &filename) {
+  const std::string ext = GetFileExtension(filename);
+  if ((ext.compare(".tar") == 0) || (ext.compare(".tgz") == 0) ||
+      (ext.compare(".zip") == 0)) {
+    return true;
+  }
+
+  std::string lower = filename;
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](char c) { return char(std::tolower(c)); });
+  return EndsWith(lower, ".tar.gz");
+}
+
+std::shared_ptr<Archive> Archive::open(const std::string &filename) {
+  std::shared_ptr<Archive> archive = std::make_shared<Archive>();
+  archive->_filename = filename;
+  archive->_mapping = MappedFile::open(filename);
+  if (!archive->_mapping) {
+    return nullptr;
+  }
+  archive->_data = archive->_mapping->data();
+  archive->_size = archive->_mapping->size();
+
+  const uint8_t *data = archive->_data;
+  const size_t size = archive->_size;
+
+  std::string err;
+  bool ok = false;
+  if ((size >= 2) && (data[0] == 0x1f) && (data[1] == 0x8b)) {
+#if defined(NNVIEW_WITH_ZLIB)
+    ok = Gunzip(data, size, &archive->_buffer, &err);
+    if (ok) {
+      // Members are served from the decompressed buffer.
+      archive->_mapping.reset();
+      archive->_data = archive->_buffer.data();
+      archive->_size = archive->_buffer.size();
+      ok = archive->index_tar(&err);
+    }
+#else
+    err = "Gzipped archive requires zlib. Rebuild nnview with "
+          "NNVIEW_USE_ZLIB=On.";
+#endif
+  } else if ((size >= kTarBlockSize) &&
+             (IsTarHeader(data) || IsZeroBlock(data))) {
+    ok = archive->index_tar(&err);
+  } else {
+    ok = archive->index_zip(&err);
+  }
+
+  if (!ok) {
+    std::cerr << err << " filename : " << filename << std::endl;
+    return nullptr;
+  }
+
+  return archive;
+}
+
+void Archive::add_member(const ArchiveMember &member) {
+  const std::string key = NormalizePath(member.name);
+  if (key.empty()) {
+    return;
+  }
+  // A later member of the same path overrides(as `tar -x` does).
+  _index[key] = _members.size();
+  _members.push_back(member);
+}
+
+bool Archive::index_tar(std::string *err) {
+  // Values of GNU long name and pax extended header apply to the next entry.
+  std::string next_path;
+  uint64_t next_size = 0;
+  bool has_next_size = false;
+
+  size_t pos = 0;
+  while (pos + kTarBlockSize <= _size) {
+    const uint8_t *h = _data + pos;
+    if (IsZeroBlock(h)) {
+      // End of archive.
+      break;
+    }
+    if (!IsTarHeader(h)) {
+      (*err) = "Invalid tar header at offset " + std::to_string(pos) + ".";
+      return false;
+    }
+
+    uint64_t size = 0;
+    if (!ParseTarNumber(h + 124, 12, &size)) {
+      (*err) = "Invalid size in tar header at offset " + std::to_string(pos) +
+               ".";
+      return false;
+    }
+
+    const char type = char(h[156]);
+    const bool is_file = (type == '0') || (type == '\0') || (type == '7');
+    if (is_file && has_next_size) {
+      size = next_size;
+    }
+
+    const size_t data_offset = pos + kTarBlockSize;
+    if (size > _size - data_offset) {
+      (*err) = "Tar member at offset " + std::to_string(pos) +
+               " is truncated.";
+      return false;
+    }
+    const uint8_t *content = _data + data_offset;
+
+    if (type == 'L') {
+      next_path = TarString(content, size_t(size));
+    } else if (type == 'x') {
+      ParsePaxRecords(content, size_t(size), &next_path, &next_size,
+                      &has_next_size);
+    } else {
+      if (is_file) {
+        ArchiveMember member;
+        if (!next_path.empty()) {
+          member.name = next_path;
+        } else {
+          member.name = TarString(h, 100);
+          // POSIX ustar splits long paths into prefix and name.
+          if (memcmp(h + 257, "ustar\0", 6) == 0) {
+            const std::string prefix = TarString(h + 345, 155);
+            if (!prefix.empty()) {
+              member.name = prefix + "/" + member.name;
+            }
+          }
+        }
+        member.offset = data_offset;
+        member.size = size;
+        member.compressed_size = size;
+        add_member(member);
+      }
+      // Directories, links, etc. are skipped.
+      next_path.clear();
+      has_next_size = false;
+    }
+
+    const size_t padded =
+        size_t((size + kTarBlockSize - 1) / kTarBlockSize * kTarBlockSize);
+    pos = data_offset + std::min(padded, _size - data_offset);
+  }
+
+  return true;
+}
+
+bool Archive::index_zip(std::string *err) {
+  const uint8_t *data = _data;
+  const size_t size = _size;
+
+  // Find End of central directory record.
+  const size_t kEOCDSize = 22;
+  if (size < kEOCDSize) {
+    (*err) = "File is too small for a zip archive.";
+    return false;
+  }
+
+  size_t eocd = std::string::npos;
+  const size_t search_end = (size > kEOCDSize + 65535)
+                                ? (size - kEOCDSize - 65535)
+                                : 0;
+  for (size_t i = size - kEOCDSize + 1; i-- > search_end;) {
+    if (ReadU32(data + i) == 0x06054b50) {
+      eocd = i;
+      break;
+    }
+  }
+
+  if (eocd == std::string::npos) {
+    (*err) = "End of central directory not found. Not a zip archive.";
+    return false;
+  }
+
+  uint64_t num_entries = ReadU16(data + eocd + 10);
+  uint64_t cd_size = ReadU32(data + eocd + 12);
+  uint64_t cd_offset = ReadU32(data + eocd + 16);
+
+  // ZIP64
+  if ((eocd >= 20) && (ReadU32(data + eocd - 20) == 0x07064b50)) {
+    const uint64_t eocd64 = ReadU64(data + eocd - 20 + 8);
+    if ((eocd64 > size) || (size - eocd64 < 56) ||
+        (ReadU32(data + eocd64) != 0x06064b50)) {
+      (*err) = "Invalid ZIP64 end of central directory.";
+      return false;
+    }
+    num_entries = ReadU64(data + eocd64 + 32);
+    cd_size = ReadU64(data + eocd64 + 40);
+    cd_offset = ReadU64(data + eocd64 + 48);
+  }
+
+  if ((cd_offset > size) || (cd_size > size - cd_offset)) {
+    (*err) = "Central directory is out of range.";
+    return false;
+  }
+
+  size_t p = size_t(cd_offset);
+  const size_t cd_end = size_t(cd_offset + cd_size);
+  for (uint64_t n = 0; n < num_entries; n++) {
+    if ((p + 46 > cd_end) || (ReadU32(data + p) != 0x02014b50)) {
+      (*err) = "Invalid central directory header.";
+      return false;
+    }
+
+    ArchiveMember member;
+    const uint16_t flags = ReadU16(data + p + 8);
+    member.encrypted = (flags & 0x1) != 0;
+    member.method = ReadU16(data + p + 10);
+    member.compressed_size = ReadU32(data + p + 20);
+    member.size = ReadU32(data + p + 24);
+    const size_t name_len = ReadU16(data + p + 28);
+    const size_t extra_len = ReadU16(data + p + 30);
+    const size_t comment_len = ReadU16(data + p + 32);
+    uint64_t local_header_offset = ReadU32(data + p + 42);
+
+    if (p + 46 + name_len + extra_len + comment_len > cd_end) {
+      (*err) = "Central directory entry is out of range.";
+      return false;
+    }
+
+    member.name.assign(reinterpret_cast<const char *>(data + p + 46),
+                       name_len);
+
+    // ZIP64 extended information extra field.
+    const uint8_t *extra = data + p + 46 + name_len;
+    for (size_t e = 0; e + 4 <= extra_len;) {
+      const uint16_t id = ReadU16(extra + e);
+      const size_t len = ReadU16(extra + e + 2);
+      if (e + 4 + len > extra_len) {
+        break;
+      }
+      if (id == 0x0001) {
+        const uint8_t *f = extra + e + 4;
+        const uint8_t *f_end = f + len;
+        if ((member.size == 0xFFFFFFFF) && (f + 8 <= f_end)) {
+          member.size = ReadU64(f);
+          f += 8;
+        }
+        if ((member.compressed_size == 0xFFFFFFFF) && (f + 8 <= f_end)) {
+          member.compressed_size = ReadU64(f);
+          f += 8;
+        }
+        if ((local_header_offset == 0xFFFFFFFF) && (f + 8 <= f_end)) {
+          local_header_offset = ReadU64(f);
+        }
+      }
+      e += 4 + len;
+    }
+
+    p += 46 + name_len + extra_len + comment_len;
+
+    if (member.name.empty() || (member.name.back() == '/')) {
+      // Directory entry.
+      continue;
+    }
+
+    const uint64_t lh = local_header_offset;
+    if ((lh > size) || (size - lh < 30) ||
+        (ReadU32(data + lh) != 0x04034b50)) {
+      (*err) = "Invalid local file header of `" + member.name + "`.";
+      return false;
+    }
+
+    member.offset = lh + 30 + ReadU16(data + lh + 26) + ReadU16(data + lh + 28);
+    if ((member.offset > size) ||
+        (size - member.offset < member.compressed_size) ||
+        ((member.method == 0) && (member.size != member.compressed_size))) {
+      (*err) = "Zip member `" + member.name + "` is out of range.";
+      return false;
+    }
+
+    add_member(member);
+  }
+
+  return true;
+}
+
+const ArchiveMember *Archive::find(const std::string &path) const {
+  auto it = _index.find(NormalizePath(path));
+  if (it == _index.end()) {
+    return nullptr;
+  }
+  return &_members[it->second];
+}
+
+const uint8_t *Archive::data(const ArchiveMember &member) const {
+  if ((member.method != 0) || member.encrypted) {
+    return nullptr;
+  }
+  return _data + size_t(member.offset);
+}
+
+bool Archive::read(const ArchiveMember &member, uint64_t offset, size_t len,
+                   uint8_t *dst, std::string *err) const {
+  if (member.encrypted) {
+    (*err) = "Encrypted archive member is not supported.";
+    return false;
+  }
+
+  if ((offset > member.size) || (member.size - offset < len)) {
+    (*err) = "Read is out of range of the archive member.";
+    return false;
+  }
+
+  if (member.method == 0) {
+    memcpy(dst, _data + size_t(member.offset + offset), len);
+    return true;
+  }
+
+  if (member.method != 8) {
+    (*err) = "Unsupported zip compression method " +
+             std::to_string(member.method) + ".";
+    return false;
+  }
+
+#if defined(NNVIEW_WITH_ZLIB)
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+    (*err) = "Failed to initialize zlib.";
+    return false;
+  }
+
+  const uint8_t *src = _data + size_t(member.offset);
+  size_t src_remain = size_t(member.compressed_size);
+
+  // Deflate stream cannot be seeked. Inflate and discard the data before
+  // `offset`.
+  bool ok = true;
+  if (offset > 0) {
+    std::vector<uint8_t> scratch(size_t(std::min(offset, uint64_t(65536))));
+    while (ok && (offset > 0)) {
+      const size_t n = size_t(std::min(offset, uint64_t(scratch.size())));
+      ok = InflateTo(&zs, &src, &src_remain, scratch.data(), n);
+      offset -= n;
+    }
+  }
+  ok = ok && InflateTo(&zs, &src, &src_remain, dst, len);
+
+  inflateEnd(&zs);
+
+  if (!ok) {
+    (*err) = "Failed to inflate archive member.";
+    return false;
+  }
+
+  return true;
+#else
+  (void)dst;
+  (*err) = "Compressed archive member requires zlib. Rebuild nnview with "
+           "NNVIEW_USE_ZLIB=On.";
+  return false;
+#endif
+}
+
+}  // namespace nnview
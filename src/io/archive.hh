@@ -0,0 +1,88 @@
+#ifndef NNVIEW_IO_ARCHIVE_H_
+#define NNVIEW_IO_ARCHIVE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "io/mapped-file.hh"
+
+//
+// Read-only access to the members of a tar or zip archive without extracting
+// it to disk.
+//
+// tar(ustar, GNU long names, pax `path`/`size` records) and zip(including
+// ZIP64) archives are memory-mapped and members are indexed by their path,
+// so stored(uncompressed) members can be used in place. Deflated zip members
+// are inflated on read. Gzipped tar(.tar.gz, .tgz) is decompressed into
+// memory once when opened. Deflate and gzip require zlib.
+//
+namespace nnview {
+
+struct ArchiveMember {
+  std::string name;  // Path in the archive as recorded.
+  uint64_t offset = 0;           // Byte offset of the member data.
+  uint64_t size = 0;             // Uncompressed size.
+  uint64_t compressed_size = 0;  // == `size` for stored members.
+  uint16_t method = 0;           // 0 = stored, 8 = deflate
+  bool encrypted = false;
+};
+
+class Archive {
+ public:
+  Archive() {}
+
+  Archive(const Archive &) = delete;
+  Archive &operator=(const Archive &) = delete;
+
+  // Whether the filename has an archive extension(.tar, .tar.gz, .tgz, .zip).
+  static bool is_archive_filename(const std::string &filename);
+
+  // The format is determined from the content. Returns nullptr and prints the
+  // reason on failure.
+  static std::shared_ptr<Archive> open(const std::string &filename);
+
+  const std::string &filename() const { return _filename; }
+
+  // File members(directories and links are not listed) in archive order.
+  const std::vector<ArchiveMember> &members() const { return _members; }
+
+  // Find a member by path. `.` and `..` components and duplicated separators
+  // are resolved, so `JoinPath(dir, filename)` can be used as is.
+  // Returns nullptr when not found.
+  const ArchiveMember *find(const std::string &path) const;
+
+  // The bytes of a stored member, or nullptr for a compressed member.
+  const uint8_t *data(const ArchiveMember &member) const;
+
+  // The mapping of the archive file when `data()` points into it. nullptr for
+  // archives decompressed in memory. Hold this to keep `data()` valid beyond
+  // the lifetime of the archive.
+  const std::shared_ptr<MappedFile> &mapping() const { return _mapping; }
+
+  // Read `len` bytes of the uncompressed member content starting at
+  // `offset`. Deflated members are inflated from the beginning.
+  bool read(const ArchiveMember &member, uint64_t offset, size_t len,
+            uint8_t *dst, std::string *err) const;
+
+ private:
+  bool index_zip(std::string *err);
+  bool index_tar(std::string *err);
+  void add_member(const ArchiveMember &member);
+
+  std::string _filename;
+  std::shared_ptr<MappedFile> _mapping;
+  std::vector<uint8_t> _buffer;  // Decompressed .tar.gz
+  const uint8_t *_data = nullptr;
+  size_t _size = 0;
+
+  std::vector<ArchiveMember> _members;
+  std::unordered_map<std::string, size_t> _index;  // normalized path -> id
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_ARCHIVE_H_
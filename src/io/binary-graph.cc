@@ -0,0 +1,508 @@
+#include "io/binary-graph.hh"
+#include "io/mapped-file.hh"
+#include "io/path-util.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace nnview {
+
+namespace {
+
+constexpr char kGraphMagic[8] = {'N', 'N', 'V', 'G', 'R', 'A', 'P', 'H'};
+constexpr uint32_t kGraphVersion = 1;
+constexpr uint64_t kSectionAlignment = 8;
+
+// `TensorRecord::file` of a tensor which has no file to read the payload
+// from.
+constexpr uint32_t kNoFile = std::numeric_limits<uint32_t>::max();
+
+// `FileRecord::flags`
+constexpr uint32_t kFileRelativeToGraph = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_symbols;
+  uint32_t num_strings;
+  uint32_t num_nodes;
+  uint32_t num_slots;
+  uint32_t num_tensors;
+  uint32_t num_dims;
+  uint32_t num_files;
+  uint32_t num_inputs;
+  uint32_t num_outputs;
+  uint64_t string_bytes;
+  uint8_t reserved[8];
+};
+
+struct NodeRecord {
+  int32_t type;
+  int32_t id;
+  int32_t depth;
+  uint32_t name;  // string index
+  uint32_t first_slot;
+  uint32_t num_inputs;
+  uint32_t num_outputs;
+};
+
+struct SlotRecord {
+  uint32_t name;       // symbol
+  uint32_t slot_name;  // symbol
+  int32_t id;
+};
+
+struct TensorRecord {
+  uint32_t name;  // string index
+  int32_t dtype;
+  uint32_t first_dim;
+  uint32_t rank;
+  uint64_t num_items;
+  uint64_t source_offset;
+  uint32_t file;
+  uint32_t reserved;
+};
+
+struct FileRecord {
+  uint32_t path;  // string index
+  uint32_t flags;
+};
+
+// Records are written as they are in memory, so they must not have padding.
+static_assert(sizeof(Header) == 64, "unexpected padding in Header");
+static_assert(sizeof(NodeRecord) == 28, "unexpected padding in NodeRecord");
+static_assert(sizeof(SlotRecord) == 12, "unexpected padding in SlotRecord");
+static_assert(sizeof(TensorRecord) == 40,
+              "unexpected padding in TensorRecord");
+static_assert(sizeof(FileRecord) == 8, "unexpected padding in FileRecord");
+
+// File offset of each table.
+struct Layout {
+  uint64_t nodes;
+  uint64_t slots;
+  uint64_t tensors;
+  uint64_t dims;
+  uint64_t files;
+  uint64_t string_offsets;
+  uint64_t strings;
+  uint64_t end;
+};
+
+inline uint64_t AlignUp(uint64_t x) {
+  return (x + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+inline Layout ComputeLayout(const Header &h) {
+  Layout l;
+  l.nodes = sizeof(Header);
+  l.slots = AlignUp(l.nodes + uint64_t(h.num_nodes) * sizeof(NodeRecord));
+  l.tensors = AlignUp(l.slots + uint64_t(h.num_slots) * sizeof(SlotRecord));
+  l.dims =
+      AlignUp(l.tensors + uint64_t(h.num_tensors) * sizeof(TensorRecord));
+  l.files = AlignUp(l.dims + uint64_t(h.num_dims) * sizeof(int32_t));
+  l.string_offsets =
+      AlignUp(l.files + uint64_t(h.num_files) * sizeof(FileRecord));
+  l.strings = AlignUp(l.string_offsets +
+                      (uint64_t(h.num_strings) + 1) * sizeof(uint32_t));
+  l.end = l.strings + h.string_bytes;
+  return l;
+}
+
+// Read the `index`th record of the table at `offset` in place.
+template <typename T>
+inline T LoadRecord(const uint8_t *data, uint64_t offset, size_t index) {
+  T v;
+  memcpy(&v, data + size_t(offset) + index * sizeof(T), sizeof(T));
+  return v;
+}
+
+}  // namespace
+
+static bool IsAbsolutePath(const std::string &path) {
+  return (!path.empty() && ((path[0] == '/') || (path[0] == '\\'))) ||
+         ((path.size() > 1) && (path[1] == ':'));
+}
+
+// Whether the payload of `tensor` can be read again from
+// `Tensor::source_filename` with `load_tensor_payload`.
+static bool HasPayloadReference(const Tensor &tensor) {
+  // Loaders leave `source_filename` empty for payloads which exist only in
+  // memory(e.g. members inflated from an archive). The payload of a sparse
+  // tensor is not stored densely.
+  return !tensor.source_filename.empty() && !tensor.sparse;
+}
+
+// Write a table and pad it to the section alignment.
+static void WriteSection(std::ofstream &ofs, const void *data, size_t size,
+                         uint64_t *pos) {
+  const char zeros[kSectionAlignment] = {};
+  ofs.write(static_cast<const char *>(data), std::streamsize(size));
+  const uint64_t end = (*pos) + size;
+  ofs.write(zeros, std::streamsize(AlignUp(end) - end));
+  (*pos) = AlignUp(end);
+}
+
+bool write_binary_graph(const std::string &filename, const Graph &graph) {
+  // The first strings are the symbols of the graph.
+  SymbolTable strings;
+  for (size_t i = 0; i < graph.symbols.size(); i++) {
+    strings.intern(graph.symbols.str(Symbol(i)));
+  }
+
+  std::vector<SlotRecord> slots;
+  auto add_slots = [&slots](const std::vector<Slot> &src) {
+    for (const auto &slot : src) {
+      slots.push_back(SlotRecord{slot.name, slot.slot_name, slot.id});
+    }
+  };
+  add_slots(graph.inputs);
+  add_slots(graph.outputs);
+
+  std::vector<NodeRecord> nodes;
+  nodes.reserve(graph.nodes.size());
+  for (const auto &node : graph.nodes) {
+    NodeRecord record;
+    record.type = int32_t(node.type);
+    record.id = node.id;
+    record.depth = node.depth;
+    record.name = strings.intern(node.name);
+    record.first_slot = uint32_t(slots.size());
+    record.num_inputs = uint32_t(node.inputs.size());
+    record.num_outputs = uint32_t(node.outputs.size());
+    add_slots(node.inputs);
+    add_slots(node.outputs);
+    nodes.push_back(record);
+  }
+
+  const std::string base_dir = GetBaseDir(filename);
+  std::vector<TensorRecord> tensors;
+  std::vector<int32_t> dims;
+  std::vector<FileRecord> files;
+  std::vector<uint32_t> file_ids;  // <string index, file id + 1>
+  tensors.reserve(graph.tensors.size());
+  for (const auto &tensor : graph.tensors) {
+    TensorRecord record = {};
+    record.name = strings.intern(tensor.name);
+    record.dtype = int32_t(tensor.dtype);
+    record.first_dim = uint32_t(dims.size());
+    record.rank = uint32_t(tensor.shape.size());
+    record.num_items = uint64_t(tensor.num_items);
+    record.file = kNoFile;
+    dims.insert(dims.end(), tensor.shape.begin(), tensor.shape.end());
+
+    if (HasPayloadReference(tensor)) {
+      std::string path = tensor.source_filename;
+      uint32_t flags = 0;
+      if (base_dir.empty()) {
+        if (!IsAbsolutePath(path)) {
+          flags = kFileRelativeToGraph;
+        }
+      } else if (path.compare(0, base_dir.size() + 1, base_dir + "/") == 0) {
+        path = path.substr(base_dir.size() + 1);
+        flags = kFileRelativeToGraph;
+      }
+
+      const Symbol sym = strings.intern(path);
+      if (sym >= file_ids.size()) {
+        file_ids.resize(strings.size(), 0);
+      }
+      if ((file_ids[sym] == 0) || (files[file_ids[sym] - 1].flags != flags)) {
+        files.push_back(FileRecord{sym, flags});
+        file_ids[sym] = uint32_t(files.size());
+      }
+      record.file = file_ids[sym] - 1;
+      record.source_offset = tensor.source_offset;
+    }
+
+    tensors.push_back(record);
+  }
+
+  std::vector<uint32_t> string_offsets;
+  string_offsets.reserve(strings.size() + 1);
+  uint64_t string_bytes = 0;
+  for (size_t i = 0; i < strings.size(); i++) {
+    string_offsets.push_back(uint32_t(string_bytes));
+    string_bytes += strings.str(Symbol(i)).size();
+  }
+  string_offsets.push_back(uint32_t(string_bytes));
+
+  const uint64_t kMaxCount = std::numeric_limits<uint32_t>::max();
+  if ((string_bytes > kMaxCount) || (slots.size() > kMaxCount) ||
+      (dims.size() > kMaxCount)) {
+    std::cerr << "Graph is too large for the binary graph : " << filename
+              << std::endl;
+    return false;
+  }
+
+  Header header = {};
+  memcpy(header.magic, kGraphMagic, sizeof(kGraphMagic));
+  header.version = kGraphVersion;
+  header.num_symbols = uint32_t(graph.symbols.size());
+  header.num_strings = uint32_t(strings.size());
+  header.num_nodes = uint32_t(nodes.size());
+  header.num_slots = uint32_t(slots.size());
+  header.num_tensors = uint32_t(tensors.size());
+  header.num_dims = uint32_t(dims.size());
+  header.num_files = uint32_t(files.size());
+  header.num_inputs = uint32_t(graph.inputs.size());
+  header.num_outputs = uint32_t(graph.outputs.size());
+  header.string_bytes = string_bytes;
+
+  // Write to a temporary file and rename it, so that an interrupted write
+  // never leaves a broken file.
+  const std::string tmp_filename = filename + ".tmp";
+  std::ofstream ofs(tmp_filename, std::ios::out | std::ios::binary);
+  if (!ofs) {
+    std::cerr << "Failed to open file for writing : " << tmp_filename
+              << std::endl;
+    return false;
+  }
+
+  uint64_t pos = 0;
+  WriteSection(ofs, &header, sizeof(header), &pos);
+  WriteSection(ofs, nodes.data(), nodes.size() * sizeof(NodeRecord), &pos);
+  WriteSection(ofs, slots.data(), slots.size() * sizeof(SlotRecord), &pos);
+  WriteSection(ofs, tensors.data(), tensors.size() * sizeof(TensorRecord),
+               &pos);
+  WriteSection(ofs, dims.data(), dims.size() * sizeof(int32_t), &pos);
+  WriteSection(ofs, files.data(), files.size() * sizeof(FileRecord), &pos);
+  WriteSection(ofs, string_offsets.data(),
+               string_offsets.size() * sizeof(uint32_t), &pos);
+  for (size_t i = 0; ofs && (i < strings.size()); i++) {
+    const std::string &s = strings.str(Symbol(i));
+    ofs.write(s.data(), std::streamsize(s.size()));
+  }
+
+  ofs.close();
+
+  if (!ofs) {
+    std::cerr << "Failed to write binary graph : " << filename << std::endl;
+    std::remove(tmp_filename.c_str());
+    return false;
+  }
+
+#if defined(_WIN32)
+  // `rename` does not overwrite an existing file on Windows.
+  std::remove(filename.c_str());
+#endif
+  if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    std::cerr << "Failed to rename " << tmp_filename << " to " << filename
+              << std::endl;
+    std::remove(tmp_filename.c_str());
+    return false;
+  }
+
+  std::cout << "Wrote binary graph : " << filename << "\n";
+
+  return true;
+}
+
+bool load_binary_graph(const std::string &filename, Graph *graph) {
+  if (graph == nullptr) {
+    std::cerr << "`graph` is nullptr\n";
+    return false;
+  }
+
+  std::shared_ptr<MappedFile> mapping = MappedFile::open(filename);
+  if (!mapping) {
+    std::cerr << "Failed to open binary graph : " << filename << std::endl;
+    return false;
+  }
+
+  const uint8_t *data = mapping->data();
+  const size_t size = mapping->size();
+
+  Header h;
+  if ((size < sizeof(Header)) ||
+      (memcmp(data, kGraphMagic, sizeof(kGraphMagic)) != 0)) {
+    std::cerr << "Not a nnview binary graph : " << filename << std::endl;
+    return false;
+  }
+  memcpy(&h, data, sizeof(h));
+  if (h.version != kGraphVersion) {
+    std::cerr << "Unsupported binary graph version " << h.version << " : "
+              << filename << std::endl;
+    return false;
+  }
+
+  const Layout layout = ComputeLayout(h);
+  if ((h.string_bytes > size) || (layout.end > size)) {
+    std::cerr << "Binary graph is truncated : " << filename << std::endl;
+    return false;
+  }
+
+  auto invalid = [&filename](const std::string &what) {
+    std::cerr << "Invalid " << what << " in binary graph : " << filename
+              << std::endl;
+    return false;
+  };
+
+  if ((h.num_symbols > h.num_strings) ||
+      (uint64_t(h.num_inputs) + h.num_outputs > h.num_slots)) {
+    return invalid("header");
+  }
+
+  // String offsets must be ascending and end at the string data size.
+  for (size_t i = 0; i <= h.num_strings; i++) {
+    const uint32_t offset =
+        LoadRecord<uint32_t>(data, layout.string_offsets, i);
+    const uint32_t prev =
+        (i == 0) ? 0
+                 : LoadRecord<uint32_t>(data, layout.string_offsets, i - 1);
+    if ((offset < prev) ||
+        ((i == h.num_strings) && (offset != h.string_bytes))) {
+      return invalid("string table");
+    }
+  }
+
+  const char *string_data =
+      reinterpret_cast<const char *>(data + size_t(layout.strings));
+  auto string_at = [&](uint32_t index, const char **str, size_t *len) {
+    const uint32_t begin =
+        LoadRecord<uint32_t>(data, layout.string_offsets, index);
+    const uint32_t end =
+        LoadRecord<uint32_t>(data, layout.string_offsets, index + 1);
+    (*str) = string_data + begin;
+    (*len) = end - begin;
+  };
+
+  Graph g;
+
+  for (uint32_t i = 0; i < h.num_symbols; i++) {
+    const char *str;
+    size_t len;
+    string_at(i, &str, &len);
+    if (g.symbols.intern(str, len) != i) {
+      return invalid("symbol table(duplicate symbol)");
+    }
+  }
+
+  auto read_slots = [&](size_t first, size_t count, std::vector<Slot> *dst) {
+    if (first + count > h.num_slots) {
+      return false;
+    }
+    dst->reserve(count);
+    for (size_t i = first; i < first + count; i++) {
+      const SlotRecord slot = LoadRecord<SlotRecord>(data, layout.slots, i);
+      if ((slot.name >= h.num_symbols) || (slot.slot_name >= h.num_symbols) ||
+          (slot.id < -1) || (int64_t(slot.id) >= int64_t(h.num_tensors))) {
+        return false;
+      }
+      dst->emplace_back(slot.name, slot.slot_name, slot.id);
+    }
+    return true;
+  };
+
+  if (!read_slots(0, h.num_inputs, &g.inputs) ||
+      !read_slots(h.num_inputs, h.num_outputs, &g.outputs)) {
+    return invalid("graph input/output");
+  }
+
+  g.nodes.resize(h.num_nodes);
+  for (size_t n = 0; n < g.nodes.size(); n++) {
+    const NodeRecord record = LoadRecord<NodeRecord>(data, layout.nodes, n);
+    Node &node = g.nodes[n];
+    if ((record.type < 0) || (record.type > int32_t(LAYER_UNKNOWN))) {
+      node.type = LAYER_UNKNOWN;
+    } else {
+      node.type = LayerType(record.type);
+    }
+    node.id = record.id;
+    node.depth = record.depth;
+
+    if (record.name >= h.num_strings) {
+      return invalid("node");
+    }
+    const char *name;
+    size_t len;
+    string_at(record.name, &name, &len);
+    node.name.assign(name, len);
+
+    const size_t first = record.first_slot;
+    if (!read_slots(first, record.num_inputs, &node.inputs) ||
+        !read_slots(first + record.num_inputs, record.num_outputs,
+                    &node.outputs)) {
+      return invalid("node slot");
+    }
+  }
+
+  // Paths are resolved once per file.
+  const std::string base_dir = GetBaseDir(filename);
+  std::vector<std::string> paths(h.num_files);
+  for (size_t i = 0; i < paths.size(); i++) {
+    const FileRecord file = LoadRecord<FileRecord>(data, layout.files, i);
+    if (file.path >= h.num_strings) {
+      return invalid("file");
+    }
+    const char *path;
+    size_t len;
+    string_at(file.path, &path, &len);
+    paths[i].assign(path, len);
+    if (file.flags & kFileRelativeToGraph) {
+      paths[i] = JoinPath(base_dir, paths[i]);
+    }
+  }
+
+  g.tensors.resize(h.num_tensors);
+  for (size_t t = 0; t < g.tensors.size(); t++) {
+    const TensorRecord record =
+        LoadRecord<TensorRecord>(data, layout.tensors, t);
+    Tensor &tensor = g.tensors[t];
+    if ((record.name >= h.num_strings) || (record.dtype < 0) ||
+        (record.dtype > int32_t(DTYPE_INT32)) || (record.rank < 2) ||
+        (uint64_t(record.first_dim) + record.rank > h.num_dims) ||
+        ((record.file != kNoFile) && (record.file >= h.num_files))) {
+      return invalid("tensor");
+    }
+
+    const char *name;
+    size_t len;
+    string_at(record.name, &name, &len);
+    tensor.name.assign(name, len);
+    tensor.dtype = DataType(record.dtype);
+    tensor.shape.resize(record.rank);
+    uint64_t num_items = 1;
+    bool overflow = false;
+    for (size_t k = 0; k < record.rank; k++) {
+      const int32_t d =
+          LoadRecord<int32_t>(data, layout.dims, record.first_dim + k);
+      if (d < 0) {
+        return invalid("tensor shape");
+      }
+      tensor.shape[k] = d;
+      if ((d > 0) &&
+          (num_items > std::numeric_limits<uint64_t>::max() / uint64_t(d))) {
+        overflow = true;
+      }
+      num_items *= uint64_t(d);
+    }
+    // The shape must describe the payload. A tensor without payload may have
+    // no items(e.g. its shape overflowed in the loader).
+    const uint64_t max_items = std::numeric_limits<size_t>::max() /
+                               get_dtype_size(tensor.dtype);
+    const bool no_payload =
+        (record.file == kNoFile) && (record.num_items == 0);
+    if (!no_payload &&
+        (overflow || (record.num_items != num_items) ||
+         (record.num_items > max_items))) {
+      return invalid("tensor shape");
+    }
+    tensor.num_items = size_t(record.num_items);
+    if (record.file != kNoFile) {
+      tensor.source_filename = paths[record.file];
+      tensor.source_offset = record.source_offset;
+    }
+    tensor.loaded = false;
+  }
+
+  (*graph) = std::move(g);
+
+  std::cout << "Loaded binary graph : " << filename << "\n";
+
+  return true;
+}
+
+}  // namespace nnview
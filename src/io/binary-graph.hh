@@ -0,0 +1,53 @@
+#ifndef NNVIEW_IO_BINARY_GRAPH_H_
+#define NNVIEW_IO_BINARY_GRAPH_H_
+
+#include <string>
+
+#include "datatypes.h"
+
+//
+// Compact binary encoding of `Graph`(.nnvgraph).
+//
+// Unlike the model cache(io/model-cache.hh), the binary graph holds no
+// tensor payloads. Tensors refer to the weight/tensor files they were loaded
+// from, and payloads are read when the tensor is selected(as with `--lazy`).
+// All records have a fixed size, so loading maps the file and reads the
+// records in place without parsing.
+//
+// format is:
+//
+// header(64 bytes) : magic("NNVGRAPH"), version, the number of records in
+//                    each table
+// nodes            : type, id, depth, name, first slot, # of inputs,
+//                    # of outputs(28 bytes each)
+// slots            : name, slot name, tensor id(12 bytes each). Graph inputs
+//                    and outputs come first, then the slots of each node
+//                    (inputs followed by outputs).
+// tensors          : name, dtype, first dim, rank, num_items, payload offset,
+//                    file(40 bytes each)
+// dims             : int32 shape of all tensors
+// files            : path and flags of weight/tensor files(8 bytes each)
+// string offsets   : uint32 x (# of strings + 1)
+// strings          : string data. The first strings are `Graph::symbols` in
+//                    symbol order, followed by node names, tensor names and
+//                    paths.
+//
+// Each table starts at an 8-byte aligned offset. Strings are referred to by
+// index. The file is written in the host byte order.
+//
+// Paths of files under the directory of the binary graph are stored relative
+// to it, so the model directory can be moved together with the binary graph.
+// Other paths are stored as they are.
+//
+namespace nnview {
+
+bool write_binary_graph(const std::string &filename, const Graph &graph);
+
+// Tensors are not loaded(`Tensor::loaded` = false). Call
+// `load_tensor_payload`(io/weights-loader.hh) to read the payload of a
+// tensor.
+bool load_binary_graph(const std::string &filename, Graph *graph);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_BINARY_GRAPH_H_
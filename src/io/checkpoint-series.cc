@@ -0,0 +1,443 @@
+#include "io/checkpoint-series.hh"
+#include "io/archive.hh"
+#include "io/path-util.hh"
+#include "parallel.hh"
+#include "sparse-storage.hh"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+namespace nnview {
+
+constexpr size_t CheckpointSeries::kKeyframeInterval;
+
+namespace {
+
+inline bool IsDigit(char c) { return (c >= '0') && (c <= '9'); }
+
+}  // namespace
+
+static bool IsDirectory(const std::string &path) {
+#if defined(_WIN32)
+  const DWORD attr = GetFileAttributesA(path.c_str());
+  return (attr != INVALID_FILE_ATTRIBUTES) &&
+         (attr & FILE_ATTRIBUTE_DIRECTORY);
+#else
+  struct stat st;
+  return (stat(path.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+#endif
+}
+
+static bool IsFile(const std::string &path) {
+#if defined(_WIN32)
+  const DWORD attr = GetFileAttributesA(path.c_str());
+  return (attr != INVALID_FILE_ATTRIBUTES) &&
+         !(attr & FILE_ATTRIBUTE_DIRECTORY);
+#else
+  struct stat st;
+  return (stat(path.c_str(), &st) == 0) && S_ISREG(st.st_mode);
+#endif
+}
+
+// Names of the entries in the directory except `.` and `..`.
+static bool ListDirectory(const std::string &dirname,
+                          std::vector<std::string> *names) {
+#if defined(_WIN32)
+  WIN32_FIND_DATAA data;
+  HANDLE handle = FindFirstFileA(JoinPath(dirname, "*").c_str(), &data);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  do {
+    names->push_back(data.cFileName);
+  } while (FindNextFileA(handle, &data));
+  FindClose(handle);
+#else
+  DIR *dir = opendir(dirname.c_str());
+  if (!dir) {
+    return false;
+  }
+  while (struct dirent *entry = readdir(dir)) {
+    names->push_back(entry->d_name);
+  }
+  closedir(dir);
+#endif
+
+  names->erase(std::remove_if(names->begin(), names->end(),
+                              [](const std::string &name) {
+                                return (name.compare(".") == 0) ||
+                                       (name.compare("..") == 0);
+                              }),
+               names->end());
+  return true;
+}
+
+// Compare names treating runs of digits as numbers. e.g. "iter_900" <
+// "iter_1000"
+static bool NaturalLess(const std::string &a, const std::string &b) {
+  size_t i = 0;
+  size_t j = 0;
+  while ((i < a.size()) && (j < b.size())) {
+    if (IsDigit(a[i]) && IsDigit(b[j])) {
+      // Skip leading zeros and compare the lengths of digit runs first.
+      while ((i < a.size()) && (a[i] == '0')) {
+        i++;
+      }
+      while ((j < b.size()) && (b[j] == '0')) {
+        j++;
+      }
+      size_t ie = i;
+      size_t je = j;
+      while ((ie < a.size()) && IsDigit(a[ie])) {
+        ie++;
+      }
+      while ((je < b.size()) && IsDigit(b[je])) {
+        je++;
+      }
+      if (ie - i != je - j) {
+        return (ie - i) < (je - j);
+      }
+      const int c = a.compare(i, ie - i, b, j, je - j);
+      if (c != 0) {
+        return c < 0;
+      }
+      i = ie;
+      j = je;
+    } else {
+      if (a[i] != b[j]) {
+        return a[i] < b[j];
+      }
+      i++;
+      j++;
+    }
+  }
+  return (a.size() - i) < (b.size() - j);
+}
+
+// Let `tensor` own its payload so that it can be rewritten in place.
+static void MakeOwned(Tensor *tensor) {
+  if (tensor->sparse) {
+    // Deltas are taken between dense payloads.
+    tensor->data.resize(tensor->byte_size());
+    tensor->sparse->to_dense(tensor->data.data());
+    tensor->sparse.reset();
+  }
+  if (tensor->mapped_data) {
+    tensor->data.assign(tensor->mapped_data,
+                        tensor->mapped_data + tensor->byte_size());
+  }
+  tensor->mapped_data = nullptr;
+  tensor->mapping.reset();
+  tensor->shared_data.reset();
+}
+
+// dst = a ^ b. `dst` may be `a`.
+static void Xor(const uint8_t *a, const uint8_t *b, size_t n, uint8_t *dst) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    x ^= y;
+    memcpy(dst + i, &x, 8);
+  }
+  for (; i < n; i++) {
+    dst[i] = a[i] ^ b[i];
+  }
+}
+
+static bool CheckTopology(const Graph &base, const Graph &graph,
+                          std::string *err) {
+  if ((base.nodes.size() != graph.nodes.size()) ||
+      (base.tensors.size() != graph.tensors.size())) {
+    (*err) = "The number of nodes or tensors differs from the first snapshot.";
+    return false;
+  }
+
+  for (size_t i = 0; i < base.nodes.size(); i++) {
+    if ((base.nodes[i].name != graph.nodes[i].name) ||
+        (base.nodes[i].type != graph.nodes[i].type)) {
+      (*err) = "Node `" + graph.nodes[i].name +
+               "` differs from the first snapshot.";
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < base.tensors.size(); i++) {
+    const Tensor &a = base.tensors[i];
+    const Tensor &b = graph.tensors[i];
+    if ((a.name != b.name) || (a.dtype != b.dtype) || (a.shape != b.shape) ||
+        (a.num_items != b.num_items) ||
+        ((a.raw_data() == nullptr) != (b.raw_data() == nullptr))) {
+      (*err) = "Tensor `" + b.name + "` differs from the first snapshot.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool CheckpointSeries::is_series_path(const std::string &path) {
+  return IsDirectory(path);
+}
+
+bool CheckpointSeries::load(const std::string &dirname, Graph *graph,
+                            const GraphLoadOption &option) {
+  _snapshots.clear();
+  _current = 0;
+  _num_threads = option.num_threads;
+
+  std::vector<std::string> names;
+  if (!ListDirectory(dirname, &names)) {
+    std::cerr << "Failed to open directory : " << dirname << std::endl;
+    return false;
+  }
+  std::sort(names.begin(), names.end(), NaturalLess);
+
+  for (const auto &name : names) {
+    const std::string path = JoinPath(dirname, name);
+    Snapshot snapshot;
+    snapshot.name = name;
+    if (IsDirectory(path) && IsFile(JoinPath(path, "model.json"))) {
+      snapshot.filename = JoinPath(path, "model.json");
+    } else if (Archive::is_archive_filename(name) && IsFile(path)) {
+      snapshot.filename = path;
+    } else {
+      continue;
+    }
+    _snapshots.push_back(snapshot);
+  }
+
+  if (_snapshots.empty()) {
+    std::cerr << "No snapshot(directory with model.json or archive) found in "
+              << dirname << std::endl;
+    return false;
+  }
+
+#if !defined(NNVIEW_WITH_ZLIB)
+  std::cerr << "Checkpoint series requires zlib. Rebuild nnview with "
+               "NNVIEW_USE_ZLIB=On.\n";
+  return false;
+#else
+  GraphLoadOption snapshot_option = option;
+  snapshot_option.weights.use_mmap = false;
+  snapshot_option.weights.header_only = false;
+
+  if (!load_json_graph(_snapshots[0].filename, graph, snapshot_option)) {
+    return false;
+  }
+  for (auto &tensor : graph->tensors) {
+    MakeOwned(&tensor);
+  }
+
+  const size_t num_tensors = graph->tensors.size();
+  std::vector<Tensor> prev = graph->tensors;
+  std::atomic<bool> failed(false);
+
+  for (size_t k = 0; k < _snapshots.size(); k++) {
+    Snapshot &snapshot = _snapshots[k];
+    snapshot.deltas.resize(num_tensors);
+
+    Graph next;
+    const Graph *current = graph;
+    if (k > 0) {
+      std::string err;
+      if (!load_json_graph(snapshot.filename, &next, snapshot_option)) {
+        return false;
+      }
+      for (auto &tensor : next.tensors) {
+        MakeOwned(&tensor);
+      }
+      if (!CheckTopology(*graph, next, &err)) {
+        std::cerr << err << " snapshot : " << snapshot.filename << std::endl;
+        return false;
+      }
+      current = &next;
+    }
+
+    const bool is_keyframe = (k % kKeyframeInterval) == 0;
+    if (is_keyframe) {
+      snapshot.keyframe.resize(num_tensors);
+    }
+
+    parallel_for(num_tensors, _num_threads, [&](size_t i) {
+      const Tensor &tensor = current->tensors[i];
+      const uint8_t *data = tensor.raw_data();
+      const size_t size = tensor.byte_size();
+      if (!data || (size == 0)) {
+        return;
+      }
+      const size_t element_size = get_dtype_size(tensor.dtype);
+
+      if (k > 0) {
+        const uint8_t *prev_data = prev[i].raw_data();
+        if (memcmp(prev_data, data, size) != 0) {
+          std::vector<uint8_t> delta(size);
+          Xor(prev_data, data, size, delta.data());
+          snapshot.deltas[i] =
+              CompressedStorage::compress(delta.data(), size, element_size);
+          if (!snapshot.deltas[i]) {
+            failed = true;
+          }
+        }
+      }
+
+      if (is_keyframe) {
+        snapshot.keyframe[i] =
+            CompressedStorage::compress(data, size, element_size);
+        if (!snapshot.keyframe[i]) {
+          failed = true;
+        }
+      }
+    });
+
+    if (failed) {
+      std::cerr << "Failed to compress snapshot : " << snapshot.filename
+                << std::endl;
+      return false;
+    }
+
+    if (k > 0) {
+      prev = std::move(next.tensors);
+    }
+  }
+
+  size_t snapshot_bytes = 0;
+  for (const auto &tensor : graph->tensors) {
+    snapshot_bytes += tensor.data.size();
+  }
+  const double mb = 1.0 / (1024.0 * 1024.0);
+  std::cout << "Loaded " << _snapshots.size() << " snapshots("
+            << double(snapshot_bytes) * mb << " MB each). Deltas "
+            << double(delta_bytes()) * mb << " MB, keyframes "
+            << double(keyframe_bytes()) * mb << " MB\n";
+
+  return true;
+#endif
+}
+
+bool CheckpointSeries::apply_delta(size_t index, Graph *graph) {
+  const Snapshot &snapshot = _snapshots[index];
+  std::atomic<bool> failed(false);
+
+  parallel_for(graph->tensors.size(), _num_threads, [&](size_t i) {
+    const auto &delta = snapshot.deltas[i];
+    if (!delta) {
+      return;
+    }
+    Tensor &tensor = graph->tensors[i];
+    std::vector<uint8_t> buf(delta->size());
+    if ((tensor.data.size() != buf.size()) || !delta->decompress(buf.data())) {
+      failed = true;
+      return;
+    }
+    Xor(tensor.data.data(), buf.data(), buf.size(), tensor.data.data());
+  });
+
+  return !failed;
+}
+
+bool CheckpointSeries::restore_keyframe(size_t index, Graph *graph) {
+  const Snapshot &snapshot = _snapshots[index];
+  std::atomic<bool> failed(false);
+
+  parallel_for(graph->tensors.size(), _num_threads, [&](size_t i) {
+    const auto &keyframe = snapshot.keyframe[i];
+    if (!keyframe) {
+      return;
+    }
+    Tensor &tensor = graph->tensors[i];
+    if ((tensor.data.size() != keyframe->size()) ||
+        !keyframe->decompress(tensor.data.data())) {
+      failed = true;
+    }
+  });
+
+  return !failed;
+}
+
+bool CheckpointSeries::select(size_t index, Graph *graph) {
+  if (index >= _snapshots.size()) {
+    std::cerr << "Snapshot index " << index << " is out of range.\n";
+    return false;
+  }
+
+  if (graph->tensors.size() != _snapshots[0].deltas.size()) {
+    std::cerr << "Graph is not the one loaded by the checkpoint series.\n";
+    return false;
+  }
+
+  // Walk from the current snapshot or from the nearest keyframe, whichever
+  // applies fewer deltas. Restoring a keyframe counts as one step.
+  size_t from = _current;
+  size_t steps = (index > _current) ? (index - _current) : (_current - index);
+
+  const size_t lower = index / kKeyframeInterval * kKeyframeInterval;
+  const size_t upper = lower + kKeyframeInterval;
+  if (1 + (index - lower) < steps) {
+    from = lower;
+    steps = 1 + (index - lower);
+  }
+  if ((upper < _snapshots.size()) && (1 + (upper - index) < steps)) {
+    from = upper;
+  }
+
+  bool ok = true;
+  if (from != _current) {
+    ok = restore_keyframe(from, graph);
+    _current = from;
+  }
+
+  // XOR is its own inverse, so the delta of snapshot k moves k-1 -> k and
+  // k -> k-1.
+  while (ok && (_current < index)) {
+    ok = apply_delta(_current + 1, graph);
+    _current++;
+  }
+  while (ok && (_current > index)) {
+    ok = apply_delta(_current, graph);
+    _current--;
+  }
+
+  if (!ok) {
+    std::cerr << "Failed to restore snapshot : " << _snapshots[index].name
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+size_t CheckpointSeries::delta_bytes() const {
+  size_t n = 0;
+  for (const auto &snapshot : _snapshots) {
+    for (const auto &delta : snapshot.deltas) {
+      n += delta ? delta->compressed_size() : 0;
+    }
+  }
+  return n;
+}
+
+size_t CheckpointSeries::keyframe_bytes() const {
+  size_t n = 0;
+  for (const auto &snapshot : _snapshots) {
+    for (const auto &keyframe : snapshot.keyframe) {
+      n += keyframe ? keyframe->compressed_size() : 0;
+    }
+  }
+  return n;
+}
+
+}  // namespace nnview
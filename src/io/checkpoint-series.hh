@@ -0,0 +1,88 @@
+#ifndef NNVIEW_IO_CHECKPOINT_SERIES_H_
+#define NNVIEW_IO_CHECKPOINT_SERIES_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compressed-storage.hh"
+#include "datatypes.h"
+#include "io/graph-loader.hh"
+
+//
+// A series of training snapshots of the same model.
+//
+// A series is a directory whose entries are snapshots in the JSON graph
+// format: subdirectories containing `model.json`, or archives of them(see
+// `load_json_graph`). Snapshots are ordered by name, comparing digit runs as
+// numbers(`iter_900` < `iter_1000`). All snapshots must have the same topology
+// as the first one.
+//
+// Only one snapshot is expanded in `Graph::tensors` at a time. Every other
+// snapshot is kept as the XOR of its tensor payloads with the previous
+// snapshot, block-compressed with `CompressedStorage`. Bits which did not
+// change are zero and compress away, so memory grows with how much the
+// weights change between snapshots rather than with the number of snapshots.
+// Every `kKeyframeInterval`-th snapshot(including the first) is also kept as a
+// compressed full copy so that jumping to a distant snapshot applies a
+// bounded number of deltas.
+//
+// Requires zlib.
+//
+namespace nnview {
+
+class CheckpointSeries {
+ public:
+  static constexpr size_t kKeyframeInterval = 16;
+
+  // Whether `path` is a directory, which is loaded as a series.
+  static bool is_series_path(const std::string &path);
+
+  // Load all snapshots in `dirname`. `graph` is set to the first snapshot.
+  // Tensor payloads are always read into memory(`WeightsLoadOption::use_mmap`
+  // and `header_only` are ignored).
+  bool load(const std::string &dirname, Graph *graph,
+            const GraphLoadOption &option = GraphLoadOption());
+
+  size_t size() const { return _snapshots.size(); }
+
+  // Name of the `index`-th snapshot(the directory entry name).
+  const std::string &name(size_t index) const {
+    return _snapshots[index].name;
+  }
+
+  // Index of the snapshot currently expanded in the graph.
+  size_t current() const { return _current; }
+
+  // Rewrite the payloads of `graph->tensors` to the `index`-th snapshot.
+  // `graph` must be the one passed to `load`.
+  bool select(size_t index, Graph *graph);
+
+  // Memory used by deltas and keyframes in bytes.
+  size_t delta_bytes() const;
+  size_t keyframe_bytes() const;
+
+ private:
+  struct Snapshot {
+    std::string name;
+    std::string filename;
+
+    // Per tensor XOR with the previous snapshot. nullptr : unchanged.
+    std::vector<std::shared_ptr<const CompressedStorage>> deltas;
+
+    // Per tensor compressed payload. Empty for non keyframe snapshots.
+    std::vector<std::shared_ptr<const CompressedStorage>> keyframe;
+  };
+
+  bool apply_delta(size_t index, Graph *graph);
+  bool restore_keyframe(size_t index, Graph *graph);
+
+  std::vector<Snapshot> _snapshots;
+  size_t _current = 0;
+  int _num_threads = 0;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_CHECKPOINT_SERIES_H_
@@ -0,0 +1,953 @@
+#include "io/dot-loader.hh"
+#include "io/graph-loader.hh"
+#include "io/mapped-file.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace nnview {
+
+namespace {
+
+// Maximum nesting depth of subgraphs. Bounds the recursion for broken files.
+constexpr int kMaxDepth = 200;
+
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+enum DotToken {
+  DOT_TOKEN_ID,
+  DOT_TOKEN_LBRACE,    // {
+  DOT_TOKEN_RBRACE,    // }
+  DOT_TOKEN_LBRACKET,  // [
+  DOT_TOKEN_RBRACKET,  // ]
+  DOT_TOKEN_EQUAL,     // =
+  DOT_TOKEN_SEMICOLON,
+  DOT_TOKEN_COMMA,
+  DOT_TOKEN_COLON,
+  DOT_TOKEN_EDGEOP,  // -> or --
+  DOT_TOKEN_END,
+  DOT_TOKEN_ERROR,
+};
+
+inline bool IsDigit(char c) { return (c >= '0') && (c <= '9'); }
+
+inline bool IsIdChar(char c) {
+  return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+         IsDigit(c) || (c == '_') || (uint8_t(c) >= 0x80);
+}
+
+inline bool IsSpace(char c) {
+  return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') ||
+         (c == '\f') || (c == '\v');
+}
+
+//
+// Tokenizer of DOT. The text of an ID points into the buffer(or into an
+// internal buffer for strings having escapes or `+` concatenation) and is
+// valid until the next token.
+//
+class DotLexer {
+ public:
+  DotLexer(const char *data, size_t size)
+      : _begin(data), _p(data), _end(data + size) {}
+
+  DotToken next();
+
+  // Skip whitespace and comments and return the next character('\0' at the
+  // end of input) without reading a token.
+  char peek() {
+    skip_whitespace();
+    return (_p < _end) ? *_p : '\0';
+  }
+
+  // Text of the ID token. Quotes are removed.
+  const char *str() const { return _str; }
+  size_t len() const { return _len; }
+
+  bool is(const char *s) const {
+    return (strlen(s) == _len) && (memcmp(s, _str, _len) == 0);
+  }
+
+  // Keywords are case-insensitive. A quoted string is never a keyword.
+  bool is_keyword(const char *keyword) const;
+
+  // Line number(1-based) of the current token.
+  size_t line() const {
+    return 1 + size_t(std::count(_begin, _token ? _token : _p, '\n'));
+  }
+
+  const std::string &error() const { return _err; }
+
+ private:
+  DotToken fail(const std::string &msg) {
+    _err = msg;
+    return DOT_TOKEN_ERROR;
+  }
+  void skip_whitespace();  // and comments
+  DotToken scan_quoted();
+  DotToken scan_html();
+
+  const char *_begin;
+  const char *_p;
+  const char *_end;
+  const char *_token = nullptr;  // beginning of the current token
+  bool _line_start = true;  // only whitespace since the beginning of line
+
+  const char *_str = nullptr;
+  size_t _len = 0;
+  bool _quoted = false;
+  std::string _buf;
+
+  std::string _err;
+};
+
+// Node attributes used by the loader.
+struct DotAttrs {
+  bool has_label = false;
+  std::string label;
+  bool has_shape = false;
+  bool is_variable = false;
+};
+
+struct DotNode {
+  bool has_label = false;  // The label is the node ID when not set.
+  std::string label;
+  bool is_variable = false;
+};
+
+struct DotGraph {
+  SymbolTable ids;  // <node ID, index to `nodes`>
+  std::vector<DotNode> nodes;
+  std::vector<std::pair<uint32_t, uint32_t>> edges;  // <from, to>
+};
+
+//
+// Recursive descent parser of the DOT grammar. Builds `DotGraph` from the
+// first graph in the input.
+//
+class DotParser {
+ public:
+  DotParser(const char *data, size_t size) : _lex(data, size) {}
+
+  bool parse(DotGraph *graph);
+
+  // Error message with the line number. Valid after `parse` returned false.
+  const std::string &error() const { return _err; }
+
+ private:
+  bool fail(const std::string &msg) {
+    _err = msg + " at line " + std::to_string(_lex.line());
+    return false;
+  }
+  bool advance() {
+    _tok = _lex.next();
+    if (_tok == DOT_TOKEN_ERROR) {
+      return fail(_lex.error());
+    }
+    return true;
+  }
+  bool at_subgraph() const {
+    return (_tok == DOT_TOKEN_LBRACE) ||
+           ((_tok == DOT_TOKEN_ID) && _lex.is_keyword("subgraph"));
+  }
+
+  // Node of the current ID token. Created with the current node defaults
+  // when it appears for the first time.
+  uint32_t get_node();
+  void apply(const DotAttrs &attrs, DotNode *node);
+
+  // `members` collects the nodes in the statements for a subgraph used as
+  // an edge operand. nullptr for the graph.
+  bool parse_stmt_list(std::vector<uint32_t> *members);
+  bool parse_stmt(std::vector<uint32_t> *members);
+  bool parse_edges(std::vector<uint32_t> *lhs, std::vector<uint32_t> *members);
+  bool parse_subgraph(std::vector<uint32_t> *members);
+  bool parse_port();
+  bool parse_attr_list(DotAttrs *attrs);
+
+  DotLexer _lex;
+  DotToken _tok = DOT_TOKEN_END;
+  DotGraph *_graph = nullptr;
+  DotNode _defaults;  // set by `node [...]`
+  int _depth = 0;
+  std::string _err;
+};
+
+// Variable label written by Chainer: "[name: ](d0, d1, ...), dtype"
+struct VariableLabel {
+  std::string name;
+  std::vector<int> shape;
+  DataType dtype = DTYPE_FLOAT32;
+};
+
+}  // namespace
+
+void DotLexer::skip_whitespace() {
+  while (_p < _end) {
+    const char c = *_p;
+    if (c == '\n') {
+      _line_start = true;
+      _p++;
+    } else if (IsSpace(c)) {
+      _p++;
+    } else if (((c == '#') && _line_start) ||
+               ((c == '/') && (_end - _p >= 2) && (_p[1] == '/'))) {
+      // `#` line(C preprocessor output) or `//` comment
+      const void *nl = memchr(_p, '\n', size_t(_end - _p));
+      _p = nl ? static_cast<const char *>(nl) : _end;
+    } else if ((c == '/') && (_end - _p >= 2) && (_p[1] == '*')) {
+      const char *q = _p + 2;
+      while ((_end - q >= 2) && !((q[0] == '*') && (q[1] == '/'))) {
+        q++;
+      }
+      // An unterminated comment runs to the end of input.
+      _p = (_end - q >= 2) ? (q + 2) : _end;
+    } else {
+      break;
+    }
+  }
+}
+
+bool DotLexer::is_keyword(const char *keyword) const {
+  if (_quoted || (strlen(keyword) != _len)) {
+    return false;
+  }
+  for (size_t i = 0; i < _len; i++) {
+    char c = _str[i];
+    if ((c >= 'A') && (c <= 'Z')) {
+      c = char(c - 'A' + 'a');
+    }
+    if (c != keyword[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+DotToken DotLexer::next() {
+  skip_whitespace();
+  _token = _p;
+  _line_start = false;
+  _quoted = false;
+
+  if (_p >= _end) {
+    return DOT_TOKEN_END;
+  }
+
+  const char c = *_p;
+  switch (c) {
+    case '{':
+      _p++;
+      return DOT_TOKEN_LBRACE;
+    case '}':
+      _p++;
+      return DOT_TOKEN_RBRACE;
+    case '[':
+      _p++;
+      return DOT_TOKEN_LBRACKET;
+    case ']':
+      _p++;
+      return DOT_TOKEN_RBRACKET;
+    case '=':
+      _p++;
+      return DOT_TOKEN_EQUAL;
+    case ';':
+      _p++;
+      return DOT_TOKEN_SEMICOLON;
+    case ',':
+      _p++;
+      return DOT_TOKEN_COMMA;
+    case ':':
+      _p++;
+      return DOT_TOKEN_COLON;
+    case '"':
+      return scan_quoted();
+    case '<':
+      return scan_html();
+    default:
+      break;
+  }
+
+  if ((c == '-') && (_end - _p >= 2) && ((_p[1] == '>') || (_p[1] == '-'))) {
+    _p += 2;
+    return DOT_TOKEN_EDGEOP;
+  }
+
+  _str = _p;
+  if ((c == '-') || (c == '.') || IsDigit(c)) {
+    // Numeral: [-]?(.[0-9]+ | [0-9]+(.[0-9]*)?)
+    const char *q = (c == '-') ? (_p + 1) : _p;
+    bool has_digit = false;
+    bool has_dot = false;
+    for (; q < _end; q++) {
+      if (IsDigit(*q)) {
+        has_digit = true;
+      } else if ((*q == '.') && !has_dot) {
+        has_dot = true;
+      } else {
+        break;
+      }
+    }
+    if (!has_digit) {
+      return fail(std::string("unexpected character '") + c + "'");
+    }
+    _p = q;
+  } else if (IsIdChar(c)) {
+    while ((_p < _end) && IsIdChar(*_p)) {
+      _p++;
+    }
+  } else {
+    return fail(std::string("unexpected character '") + c + "'");
+  }
+
+  _len = size_t(_p - _str);
+  return DOT_TOKEN_ID;
+}
+
+DotToken DotLexer::scan_quoted() {
+  _quoted = true;
+  bool use_buf = false;
+
+  for (;;) {
+    // `_p` is at the opening quote.
+    const char *s = ++_p;
+    const char *q = s;
+    bool has_escape = false;
+    while ((q < _end) && (*q != '"')) {
+      if ((*q == '\\') && (_end - q >= 2)) {
+        has_escape = true;
+        q += 2;
+      } else {
+        q++;
+      }
+    }
+    if (q >= _end) {
+      return fail("unterminated string");
+    }
+    _p = q + 1;
+
+    if (!use_buf && !has_escape) {
+      _str = s;
+      _len = size_t(q - s);
+    } else {
+      if (!use_buf) {
+        _buf.clear();
+        use_buf = true;
+      }
+      // Only `\"` and line continuation are escapes of the DOT language.
+      // Other backslashes(e.g. `\n` in labels) are kept.
+      for (const char *r = s; r < q; r++) {
+        if ((r[0] == '\\') && (q - r >= 2)) {
+          if (r[1] == '"') {
+            _buf.push_back('"');
+            r++;
+            continue;
+          } else if (r[1] == '\n') {
+            r++;
+            continue;
+          } else if ((r[1] == '\r') && (q - r >= 3) && (r[2] == '\n')) {
+            r += 2;
+            continue;
+          }
+        }
+        _buf.push_back(*r);
+      }
+    }
+
+    // "a" + "b"
+    if (peek() != '+') {
+      break;
+    }
+    _p++;
+    if (peek() != '"') {
+      return fail("expected a string after '+'");
+    }
+    if (!use_buf) {
+      _buf.assign(_str, _len);
+      use_buf = true;
+    }
+  }
+
+  if (use_buf) {
+    _str = _buf.data();
+    _len = _buf.size();
+  }
+  return DOT_TOKEN_ID;
+}
+
+DotToken DotLexer::scan_html() {
+  _quoted = true;
+  _str = ++_p;
+  int depth = 1;
+  for (; _p < _end; _p++) {
+    if (*_p == '<') {
+      depth++;
+    } else if ((*_p == '>') && (--depth == 0)) {
+      _len = size_t(_p - _str);
+      _p++;
+      return DOT_TOKEN_ID;
+    }
+  }
+  return fail("unterminated HTML string");
+}
+
+bool DotParser::parse(DotGraph *graph) {
+  _graph = graph;
+
+  if (!advance()) {
+    return false;
+  }
+  if ((_tok == DOT_TOKEN_ID) && _lex.is_keyword("strict") && !advance()) {
+    return false;
+  }
+  if ((_tok != DOT_TOKEN_ID) ||
+      !(_lex.is_keyword("graph") || _lex.is_keyword("digraph"))) {
+    return fail("expected `graph` or `digraph`");
+  }
+  if (!advance()) {
+    return false;
+  }
+  if ((_tok == DOT_TOKEN_ID) && !advance()) {  // graph name
+    return false;
+  }
+  if (_tok != DOT_TOKEN_LBRACE) {
+    return fail("expected '{'");
+  }
+
+  // Anything after the first graph is ignored.
+  return advance() && parse_stmt_list(nullptr);
+}
+
+uint32_t DotParser::get_node() {
+  const Symbol sym = _graph->ids.intern(_lex.str(), _lex.len());
+  if (sym == _graph->nodes.size()) {
+    _graph->nodes.push_back(_defaults);
+  }
+  return sym;
+}
+
+void DotParser::apply(const DotAttrs &attrs, DotNode *node) {
+  if (attrs.has_label) {
+    node->has_label = true;
+    node->label = attrs.label;
+  }
+  if (attrs.has_shape) {
+    node->is_variable = attrs.is_variable;
+  }
+}
+
+// Parse statements up to the closing '}', which is consumed.
+bool DotParser::parse_stmt_list(std::vector<uint32_t> *members) {
+  while (_tok != DOT_TOKEN_RBRACE) {
+    if (_tok == DOT_TOKEN_END) {
+      return fail("unexpected end of input(missing '}')");
+    }
+    if (_tok == DOT_TOKEN_SEMICOLON) {
+      if (!advance()) {
+        return false;
+      }
+      continue;
+    }
+    if (!parse_stmt(members)) {
+      return false;
+    }
+  }
+  return advance();
+}
+
+bool DotParser::parse_stmt(std::vector<uint32_t> *members) {
+  if (at_subgraph()) {
+    std::vector<uint32_t> operand;
+    return parse_subgraph(&operand) && parse_edges(&operand, members);
+  }
+
+  if (_tok != DOT_TOKEN_ID) {
+    return fail("expected a statement");
+  }
+
+  // graph/node/edge [attributes]
+  if (_lex.is_keyword("graph") || _lex.is_keyword("node") ||
+      _lex.is_keyword("edge")) {
+    const bool is_node = _lex.is_keyword("node");
+    DotAttrs attrs;
+    if (!advance() || !parse_attr_list(&attrs)) {
+      return false;
+    }
+    if (is_node) {
+      apply(attrs, &_defaults);
+    }
+    return true;
+  }
+
+  // ID = ID(graph attribute)
+  if (_lex.peek() == '=') {
+    if (!advance() || !advance()) {
+      return false;
+    }
+    if (_tok != DOT_TOKEN_ID) {
+      return fail("expected a value after '='");
+    }
+    return advance();
+  }
+
+  std::vector<uint32_t> operand(1, get_node());
+  if (!advance() || !parse_port()) {
+    return false;
+  }
+  if (_tok == DOT_TOKEN_EDGEOP) {
+    return parse_edges(&operand, members);
+  }
+
+  // Node statement
+  DotAttrs attrs;
+  if (!parse_attr_list(&attrs)) {
+    return false;
+  }
+  apply(attrs, &_graph->nodes[operand[0]]);
+  if (members) {
+    members->push_back(operand[0]);
+  }
+  return true;
+}
+
+// Parse the rest of an edge statement after its first operand `lhs`. Also
+// used for a subgraph statement, which has no edge operator.
+bool DotParser::parse_edges(std::vector<uint32_t> *lhs,
+                            std::vector<uint32_t> *members) {
+  if (members) {
+    members->insert(members->end(), lhs->begin(), lhs->end());
+  }
+
+  std::vector<uint32_t> rhs;
+  while (_tok == DOT_TOKEN_EDGEOP) {
+    if (!advance()) {
+      return false;
+    }
+
+    rhs.clear();
+    if (at_subgraph()) {
+      if (!parse_subgraph(&rhs)) {
+        return false;
+      }
+    } else if (_tok == DOT_TOKEN_ID) {
+      rhs.push_back(get_node());
+      if (!advance() || !parse_port()) {
+        return false;
+      }
+    } else {
+      return fail("expected a node or a subgraph after the edge operator");
+    }
+
+    for (const uint32_t from : *lhs) {
+      for (const uint32_t to : rhs) {
+        _graph->edges.emplace_back(from, to);
+      }
+    }
+    if (members) {
+      members->insert(members->end(), rhs.begin(), rhs.end());
+    }
+    lhs->swap(rhs);
+  }
+
+  // Edge attributes are not used.
+  DotAttrs attrs;
+  return parse_attr_list(&attrs);
+}
+
+bool DotParser::parse_subgraph(std::vector<uint32_t> *members) {
+  if (_tok == DOT_TOKEN_ID) {  // `subgraph`
+    if (!advance()) {
+      return false;
+    }
+    if ((_tok == DOT_TOKEN_ID) && !advance()) {  // subgraph name
+      return false;
+    }
+  }
+  if (_tok != DOT_TOKEN_LBRACE) {
+    return fail("expected '{'");
+  }
+  if (++_depth > kMaxDepth) {
+    return fail("exceeded maximum nesting depth");
+  }
+
+  // Node defaults set in the subgraph are local to it.
+  const DotNode defaults = _defaults;
+  if (!advance() || !parse_stmt_list(members)) {
+    return false;
+  }
+  _defaults = defaults;
+  _depth--;
+
+  return true;
+}
+
+// :port[:compass]
+bool DotParser::parse_port() {
+  while (_tok == DOT_TOKEN_COLON) {
+    if (!advance()) {
+      return false;
+    }
+    if (_tok != DOT_TOKEN_ID) {
+      return fail("expected a port after ':'");
+    }
+    if (!advance()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Zero or more [k=v, ...] lists.
+bool DotParser::parse_attr_list(DotAttrs *attrs) {
+  while (_tok == DOT_TOKEN_LBRACKET) {
+    if (!advance()) {
+      return false;
+    }
+    while (_tok != DOT_TOKEN_RBRACKET) {
+      if (_tok != DOT_TOKEN_ID) {
+        return fail("expected an attribute name");
+      }
+      const bool is_label = _lex.is("label");
+      const bool is_shape = _lex.is("shape");
+      if (!advance()) {
+        return false;
+      }
+
+      if (_tok == DOT_TOKEN_EQUAL) {
+        if (!advance()) {
+          return false;
+        }
+        if (_tok != DOT_TOKEN_ID) {
+          return fail("expected an attribute value");
+        }
+        if (is_label) {
+          attrs->has_label = true;
+          attrs->label.assign(_lex.str(), _lex.len());
+        } else if (is_shape) {
+          // Chainer draws variables as octagons.
+          attrs->has_shape = true;
+          attrs->is_variable = _lex.is("octagon");
+        }
+        if (!advance()) {
+          return false;
+        }
+      }
+
+      if (((_tok == DOT_TOKEN_SEMICOLON) || (_tok == DOT_TOKEN_COMMA)) &&
+          !advance()) {
+        return false;
+      }
+    }
+    if (!advance()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::string Trim(const std::string &s, const char *chars) {
+  const size_t begin = s.find_first_not_of(chars);
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  return s.substr(begin, s.find_last_not_of(chars) - begin + 1);
+}
+
+static bool GetDataType(const std::string &name, DataType *dtype) {
+  static const struct {
+    const char *name;
+    DataType dtype;
+  } kTypes[] = {
+      {"float32", DTYPE_FLOAT32}, {"float16", DTYPE_FLOAT16},
+      {"bfloat16", DTYPE_BFLOAT16}, {"float64", DTYPE_FLOAT64},
+      {"int8", DTYPE_INT8},       {"uint8", DTYPE_UINT8},
+      {"int32", DTYPE_INT32},
+  };
+  for (const auto &type : kTypes) {
+    if (name.compare(type.name) == 0) {
+      (*dtype) = type.dtype;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void ParseVariableLabel(const std::string &label, VariableLabel *var) {
+  var->name.clear();
+  var->shape.clear();
+  var->dtype = DTYPE_FLOAT32;
+
+  const size_t open = label.rfind('(');
+  const size_t close =
+      (open == std::string::npos) ? std::string::npos : label.find(')', open);
+  if (close == std::string::npos) {
+    // No shape.
+    var->name = Trim(label, " ");
+    return;
+  }
+
+  var->name = Trim(label.substr(0, open), " :");
+
+  const char *p = label.c_str() + open + 1;
+  const char *end = label.c_str() + close;
+  while (p < end) {
+    char *next = nullptr;
+    const long d = std::strtol(p, &next, 10);
+    if ((next == p) || (next > end)) {
+      p++;
+      continue;
+    }
+    if ((d < 0) || (d > std::numeric_limits<int>::max())) {
+      // Unknown dimension.
+      var->shape.clear();
+      break;
+    }
+    var->shape.push_back(int(d));
+    p = next;
+  }
+
+  // Unknown dtypes are displayed as float32.
+  GetDataType(Trim(label.substr(close + 1), " ,"), &var->dtype);
+}
+
+// The first line of a label. `\n`, `\l` and `\r` are line breaks in DOT
+// labels.
+static std::string FirstLine(const std::string &label) {
+  size_t end = label.find('\n');
+  for (size_t i = 0; (i + 1 < label.size()) && (i < end); i++) {
+    if ((label[i] == '\\') &&
+        ((label[i + 1] == 'n') || (label[i + 1] == 'l') ||
+         (label[i + 1] == 'r'))) {
+      end = i;
+    }
+  }
+  return Trim(label.substr(0, end), " ");
+}
+
+static void BuildGraph(const DotGraph &dot, Graph *graph) {
+  const size_t num_dot_nodes = dot.nodes.size();
+  auto label = [&dot](size_t i) -> const std::string & {
+    return dot.nodes[i].has_label ? dot.nodes[i].label
+                                  : dot.ids.str(Symbol(i));
+  };
+  auto is_variable = [&dot](uint32_t i) { return dot.nodes[i].is_variable; };
+
+  SymbolTable &symbols = graph->symbols;
+  const Symbol input_sym = symbols.intern("input");
+  const Symbol output_sym = symbols.intern("output");
+
+  // Functions are numbered in the order of appearance.
+  std::vector<uint32_t> function_ids(num_dot_nodes, kNone);
+  std::vector<std::string> function_names;
+  for (size_t i = 0; i < num_dot_nodes; i++) {
+    if (!dot.nodes[i].is_variable) {
+      function_ids[i] = uint32_t(function_names.size());
+      function_names.push_back(FirstLine(label(i)) + "-" +
+                               std::to_string(function_names.size()));
+    }
+  }
+  const size_t num_functions = function_names.size();
+
+  // The first function which outputs(consumes) each variable. Variables are
+  // named after it.
+  std::vector<uint32_t> producers(num_dot_nodes, kNone);
+  std::vector<uint32_t> consumers(num_dot_nodes, kNone);
+  std::vector<uint32_t> output_index(num_dot_nodes, 0);
+  std::vector<uint32_t> num_outputs(num_functions, 0);
+  std::vector<bool> passes_tensor(num_functions, false);
+  for (const auto &edge : dot.edges) {
+    const uint32_t from = edge.first;
+    const uint32_t to = edge.second;
+    if (is_variable(from) && !is_variable(to)) {
+      if (consumers[from] == kNone) {
+        consumers[from] = function_ids[to];
+      }
+    } else if (!is_variable(from) && is_variable(to)) {
+      if (producers[to] == kNone) {
+        producers[to] = function_ids[from];
+        output_index[to] = num_outputs[function_ids[from]]++;
+      }
+    } else if (!is_variable(from) && !is_variable(to)) {
+      passes_tensor[function_ids[from]] = true;
+    }
+  }
+
+  // Tensors of variables.
+  std::vector<int> tensor_ids(num_dot_nodes, -1);
+  std::vector<Symbol> tensor_syms(num_dot_nodes, 0);
+  std::vector<Symbol> slot_names(num_dot_nodes, input_sym);
+  std::vector<uint32_t> inputs;  // variables which get an `input` node
+  VariableLabel var;
+  for (uint32_t i = 0; i < num_dot_nodes; i++) {
+    if (!is_variable(i)) {
+      continue;
+    }
+    ParseVariableLabel(label(i), &var);
+
+    Tensor tensor;
+    if (producers[i] != kNone) {
+      tensor.name = function_names[producers[i]] + "_" +
+                    std::to_string(output_index[i]);
+    } else if (!var.name.empty()) {
+      // Parameter, e.g. `W` of LinearFunction.
+      tensor.name = (consumers[i] != kNone)
+                        ? (function_names[consumers[i]] + "_" + var.name)
+                        : var.name;
+      slot_names[i] = symbols.intern(var.name);
+    } else {
+      tensor.name = inputs.empty()
+                        ? std::string("input")
+                        : ("input-" + std::to_string(inputs.size()));
+      inputs.push_back(i);
+    }
+
+    tensor.shape = var.shape;
+    while (tensor.shape.size() < 2) {
+      tensor.shape.push_back(1);
+    }
+    tensor.num_items = 1;
+    for (const int d : tensor.shape) {
+      tensor.num_items *= size_t(d);
+    }
+    tensor.dtype = var.dtype;
+    // Variables have no data.
+    tensor.loaded = false;
+
+    tensor_ids[i] = int(graph->tensors.size());
+    tensor_syms[i] = symbols.intern(tensor.name);
+    graph->tensors.push_back(std::move(tensor));
+  }
+
+  // Implicit tensors passed between two functions.
+  std::vector<int> implicit_ids(num_functions, -1);
+  std::vector<Symbol> implicit_syms(num_functions, 0);
+  for (size_t f = 0; f < num_functions; f++) {
+    if (!passes_tensor[f]) {
+      continue;
+    }
+    Tensor tensor;
+    tensor.name = function_names[f] + "_" + std::to_string(num_outputs[f]);
+    tensor.shape = {1, 1};
+    tensor.num_items = 1;
+    tensor.loaded = false;
+
+    implicit_ids[f] = int(graph->tensors.size());
+    implicit_syms[f] = symbols.intern(tensor.name);
+    graph->tensors.push_back(std::move(tensor));
+  }
+
+  graph->nodes.reserve(inputs.size() + num_functions);
+
+  for (const uint32_t i : inputs) {
+    const std::string &name = graph->tensors[size_t(tensor_ids[i])].name;
+
+    Node node;
+    node.type = LAYER_INPUT;
+    node.name = name;
+    node.id = int(graph->nodes.size());
+    node.outputs.push_back(Slot(tensor_syms[i], output_sym, tensor_ids[i]));
+    graph->nodes.push_back(std::move(node));
+
+    graph->inputs.push_back(Slot(tensor_syms[i], input_sym, tensor_ids[i]));
+  }
+
+  const size_t first_function = graph->nodes.size();
+  for (size_t i = 0; i < num_dot_nodes; i++) {
+    if (is_variable(uint32_t(i))) {
+      continue;
+    }
+    const std::string type = FirstLine(label(i));
+
+    Node node;
+    node.name = function_names[function_ids[i]];
+    node.id = int(graph->nodes.size());
+    if (type.compare("LinearFunction") == 0) {
+      node.type = LAYER_LINEAR_FUNCTION;
+    } else if (type.compare("ReLU") == 0) {
+      node.type = LAYER_RELU;
+    }
+    graph->nodes.push_back(std::move(node));
+  }
+
+  for (const auto &edge : dot.edges) {
+    const uint32_t from = edge.first;
+    const uint32_t to = edge.second;
+    if (is_variable(from) && !is_variable(to)) {
+      Node &node = graph->nodes[first_function + function_ids[to]];
+      node.inputs.push_back(
+          Slot(tensor_syms[from], slot_names[from], tensor_ids[from]));
+    } else if (!is_variable(from) && is_variable(to)) {
+      Node &node = graph->nodes[first_function + function_ids[from]];
+      node.outputs.push_back(Slot(tensor_syms[to], output_sym, tensor_ids[to]));
+    } else if (!is_variable(from) && !is_variable(to)) {
+      const uint32_t f = function_ids[from];
+      Node &node = graph->nodes[first_function + function_ids[to]];
+      node.inputs.push_back(Slot(implicit_syms[f], input_sym, implicit_ids[f]));
+    }
+    // Edges between variables are ignored.
+  }
+
+  for (size_t f = 0; f < num_functions; f++) {
+    Node &node = graph->nodes[first_function + f];
+    if (passes_tensor[f]) {
+      node.outputs.push_back(
+          Slot(implicit_syms[f], output_sym, implicit_ids[f]));
+    }
+    // DOT has no argument order. Put the data inputs before the parameters.
+    std::stable_partition(
+        node.inputs.begin(), node.inputs.end(),
+        [input_sym](const Slot &slot) { return slot.slot_name == input_sym; });
+  }
+
+  // Variables which no function consumes are the outputs of the graph.
+  for (uint32_t i = 0; i < num_dot_nodes; i++) {
+    if (is_variable(i) && (producers[i] != kNone) &&
+        (consumers[i] == kNone)) {
+      graph->outputs.push_back(
+          Slot(tensor_syms[i], output_sym, tensor_ids[i]));
+    }
+  }
+
+  compute_node_depth(graph);
+}
+
+bool load_dot_graph(const std::string &filename, Graph *graph) {
+  if (graph == nullptr) {
+    std::cerr << "`graph` is nullptr\n";
+    return false;
+  }
+
+  std::shared_ptr<MappedFile> mapping = MappedFile::open(filename);
+  if (!mapping) {
+    std::cerr << "Failed to open DOT file : " << filename << std::endl;
+    return false;
+  }
+
+  DotGraph dot;
+  DotParser parser(reinterpret_cast<const char *>(mapping->data()),
+                   mapping->size());
+  if (!parser.parse(&dot)) {
+    std::cerr << "DOT parse error. filename: " << filename
+              << " err: " << parser.error() << std::endl;
+    return false;
+  }
+
+  graph->inputs.clear();
+  graph->outputs.clear();
+  graph->nodes.clear();
+  graph->tensors.clear();
+  graph->symbols.clear();
+
+  BuildGraph(dot, graph);
+
+  std::cout << "DOT graph : " << graph->nodes.size() << " nodes, "
+            << graph->tensors.size() << " tensors, " << dot.edges.size()
+            << " edges\n";
+
+  return true;
+}
+
+}  // namespace nnview
@@ -0,0 +1,34 @@
+#ifndef NNVIEW_IO_DOT_LOADER_H_
+#define NNVIEW_IO_DOT_LOADER_H_
+
+#include <string>
+
+#include "datatypes.h"
+
+//
+// Loader for Graphviz DOT graphs(.dot, .gv), e.g. `computational_graph.dot`
+// written by Chainer(chainer.computational_graph).
+//
+// The mapped file is tokenized in a single pass. No Graphviz installation is
+// required. The DOT grammar(node, edge and attribute statements, subgraphs,
+// ports, comments, quoted/HTML strings) is parsed, but only the `label` and
+// `shape` attributes of nodes are used.
+//
+// - Nodes with `shape=octagon`(Chainer's variable style) are variables and
+//   become `Tensor`s. The shape and dtype are parsed from the label(e.g.
+//   "W: (100, 784), float32"). Tensors have no data.
+// - Other nodes are functions and become `Node`s. The first line of the label
+//   is the function type(e.g. "LinearFunction").
+// - Edges from a variable to a function are inputs of the function, and
+//   edges from a function to a variable are outputs. An edge between two
+//   functions passes an implicit tensor.
+// - Variables which no function outputs(except named parameters such as `W`)
+//   get an `input` node.
+//
+namespace nnview {
+
+bool load_dot_graph(const std::string &filename, Graph *graph);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_DOT_LOADER_H_
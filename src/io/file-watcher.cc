@@ -0,0 +1,145 @@
+#include "io/file-watcher.hh"
+#include "io/path-util.hh"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace nnview {
+
+#if !defined(__linux__)
+static bool GetFileStat(const std::string &filename,
+                        std::pair<uint64_t, int64_t> *stat_value) {
+#if defined(_WIN32)
+  struct _stat64 st;
+  if (_stat64(filename.c_str(), &st) != 0) {
+    return false;
+  }
+#else
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    return false;
+  }
+#endif
+  stat_value->first = uint64_t(st.st_size);
+  stat_value->second = int64_t(st.st_mtime);
+  return true;
+}
+#endif
+
+FileWatcher::FileWatcher() {}
+
+FileWatcher::~FileWatcher() {
+#if defined(__linux__)
+  if (_fd != -1) {
+    close(_fd);
+  }
+#endif
+}
+
+bool FileWatcher::watch(const std::vector<std::string> &filenames) {
+#if defined(__linux__)
+  if (_fd == -1) {
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd == -1) {
+      std::cerr << "Failed to initialize inotify.\n";
+      return false;
+    }
+  }
+
+  std::set<std::string> dirs;
+  for (const auto &dir : _dirs) {
+    dirs.insert(dir.second);
+  }
+
+  for (const auto &filename : filenames) {
+    const std::string dir = GetBaseDir(filename);
+    if (!dirs.count(dir)) {
+      const int wd = inotify_add_watch(_fd, dir.empty() ? "." : dir.c_str(),
+                                       IN_CLOSE_WRITE | IN_MOVED_TO);
+      if (wd == -1) {
+        std::cerr << "Failed to watch directory : " << dir << "\n";
+        continue;
+      }
+      _dirs[wd] = dir;
+      dirs.insert(dir);
+    }
+    _files.insert(filename);
+  }
+#else
+  for (const auto &filename : filenames) {
+    std::pair<uint64_t, int64_t> st;
+    if (!GetFileStat(filename, &st)) {
+      std::cerr << "Failed to watch file : " << filename << "\n";
+      continue;
+    }
+    _stats[filename] = st;
+    _files.insert(filename);
+  }
+#endif
+
+  return !_files.empty();
+}
+
+std::vector<std::string> FileWatcher::wait(int timeout_ms) {
+  std::set<std::string> changed;
+
+#if defined(__linux__)
+  if (_fd == -1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+    return std::vector<std::string>();
+  }
+
+  struct pollfd pfd;
+  pfd.fd = _fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, timeout_ms) <= 0) {
+    return std::vector<std::string>();
+  }
+
+  alignas(struct inotify_event) char buf[16 * 1024];
+  for (;;) {
+    const ssize_t len = read(_fd, buf, sizeof(buf));
+    if (len <= 0) {
+      break;
+    }
+    for (ssize_t i = 0; i < len;) {
+      const struct inotify_event *event =
+          static_cast<const struct inotify_event *>(
+              static_cast<const void *>(buf + i));
+      i += ssize_t(sizeof(struct inotify_event) + event->len);
+
+      auto dir = _dirs.find(event->wd);
+      if ((dir == _dirs.end()) || (event->len == 0)) {
+        continue;
+      }
+      const std::string filename = JoinPath(dir->second, event->name);
+      if (_files.count(filename)) {
+        changed.insert(filename);
+      }
+    }
+  }
+#else
+  std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+  for (auto &item : _stats) {
+    std::pair<uint64_t, int64_t> st;
+    if (GetFileStat(item.first, &st) && (st != item.second)) {
+      item.second = st;
+      changed.insert(item.first);
+    }
+  }
+#endif
+
+  return std::vector<std::string>(changed.begin(), changed.end());
+}
+
+}  // namespace nnview
@@ -0,0 +1,50 @@
+#ifndef NNVIEW_IO_FILE_WATCHER_H_
+#define NNVIEW_IO_FILE_WATCHER_H_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// Watch a set of files for rewrites.
+//
+// On Linux the parent directories of the files are watched with inotify for
+// `IN_CLOSE_WRITE`(file written in place) and `IN_MOVED_TO`(file replaced by
+// rename), so a change is reported once the writer has finished. On other
+// platforms the size and modification time of each file are polled.
+//
+namespace nnview {
+
+class FileWatcher {
+ public:
+  FileWatcher();
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  // Start watching `filenames`. Returns false when no file can be watched.
+  bool watch(const std::vector<std::string> &filenames);
+
+  // Wait up to `timeout_ms` milliseconds for changes. Returns the changed
+  // files(as passed to `watch`), or an empty list on timeout.
+  std::vector<std::string> wait(int timeout_ms);
+
+ private:
+  std::set<std::string> _files;
+
+#if defined(__linux__)
+  int _fd = -1;
+  std::map<int, std::string> _dirs;  // watch descriptor -> directory
+#else
+  // filename -> <size, mtime>
+  std::map<std::string, std::pair<uint64_t, int64_t>> _stats;
+#endif
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_FILE_WATCHER_H_
@@ -1,66 +1,262 @@
 #include "io/graph-loader.hh"
+#include "compressed-storage.hh"
+#include "io/archive.hh"
+#include "io/binary-graph.hh"
+#include "io/dot-loader.hh"
+#include "io/json-reader.hh"
+#include "io/manifest.hh"
+#include "io/mapped-file.hh"
+#include "io/model-cache.hh"
+#include "io/npy-loader.hh"
+#include "io/onnx-loader.hh"
+#include "io/path-util.hh"
+#include "io/safetensors-loader.hh"
+#include "io/tensor-dedup.hh"
+#include "io/tflite-loader.hh"
+#include "io/uring-reader.hh"
 #include "io/weights-loader.hh"
+#include "parallel.hh"
 
-#include "json11.hpp"
-
+#include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <fstream>
+#include <chrono>
 #include <iostream>
-#include <sstream>
-
-using namespace json11;
+#include <map>
+#include <set>
 
 namespace nnview {
 
-static std::string JoinPath(const std::string &dir,
-                            const std::string &filename) {
-  if (dir.empty()) {
-    return filename;
-  } else {
-    char lastChar = *dir.rbegin();
-    if (lastChar != '/') {
-      return dir + std::string("/") + filename;
+// Files are looked up in `archive` instead of the file system when it is not
+// nullptr. Files are verified against `manifest` when it is not nullptr.
+static bool LoadWeights(
+    const std::vector<std::pair<std::string, std::string>> &weights,
+    const std::string base_dir, const Archive *archive,
+    const Manifest *manifest, const WeightsLoadOption &option,
+    int num_threads, std::map<std::string, Tensor> *tensors) {
+  // item = <name, filename>
+
+  // Ensure uniqueness
+  {
+    std::set<std::string> names;
+    for (const auto &item : weights) {
+      if (tensors->count(item.first) || names.count(item.first)) {
+        std::cerr << item.first << "(filename: " << item.second
+                  << ") is already exists.\n";
+        return false;
+      }
+      names.insert(item.first);
+    }
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  // Each worker writes only to its own slot, so the result does not depend on
+  // the scheduling of threads.
+  std::vector<Tensor> loaded(weights.size());
+  std::vector<char> succeeded(weights.size(), 0);
+  std::atomic<bool> failed(false);
+
+  // Read .weights/.tensor files with batched io_uring reads. NPY files are
+  // loaded by the worker threads below.
+  const bool use_batch = !archive && option.use_io_uring &&
+                         !option.use_mmap && is_uring_reader_available();
+  if (!archive && option.use_io_uring && !use_batch && !option.use_mmap) {
+    std::cout << "io_uring is not available. Use the regular reader.\n";
+  }
+
+  if (use_batch) {
+    std::vector<size_t> ids;
+    std::vector<std::string> filepaths;
+    for (size_t i = 0; i < weights.size(); i++) {
+      std::string filepath = JoinPath(base_dir, weights[i].second);
+      if (GetFileExtension(filepath).compare(".npy") != 0) {
+        ids.push_back(i);
+        filepaths.push_back(filepath);
+      }
+    }
+
+    std::vector<Tensor> batch;
+    if (load_weights_batch(filepaths, &batch, option)) {
+      for (size_t k = 0; k < ids.size(); k++) {
+        loaded[ids[k]] = std::move(batch[k]);
+        succeeded[ids[k]] = 1;
+      }
     } else {
-      return dir + filename;
+      // The regular reader below loads all files again and reports the file
+      // which fails.
+      std::cerr << "Failed to read weights/tensors with io_uring. Use the "
+                   "regular reader.\n";
     }
   }
-}
 
-static std::string GetBaseDir(const std::string &filepath) {
-  if (filepath.find_last_of("/\\") != std::string::npos)
-    return filepath.substr(0, filepath.find_last_of("/\\"));
-  return "";
-}
+  parallel_for(weights.size(), num_threads, [&](size_t i) {
+    if (failed) {
+      // Abort remaining items.
+      return;
+    }
 
-static bool LoadWeights(
-    const std::vector<std::pair<std::string, std::string>> &weights,
-    const std::string base_dir, std::map<std::string, Tensor> *tensors) {
-  // item = <name, filename>
-  for (const auto &item : weights) {
-    Tensor tensor;
-    std::string filepath = JoinPath(base_dir, item.second);
-    if (!load_weights(filepath, &tensor)) {
-      std::cerr << "Failed to read weight/tensor : " << filepath << "\n";
-      return false;
+    if (succeeded[i]) {
+      // Already loaded in the batch.
+      return;
     }
 
-    // Ensure uniqueness
-    if (tensors->count(item.first)) {
-      std::cerr << item.first << "(filename: " << item.second
-                << ") is already exists.\n";
+    std::string filepath = JoinPath(base_dir, weights[i].second);
+    const bool is_npy = (GetFileExtension(filepath).compare(".npy") == 0);
+    bool ret = false;
+    if (archive) {
+      const ArchiveMember *member = archive->find(filepath);
+      if (!member) {
+        std::cerr << filepath << " not found in " << archive->filename()
+                  << "\n";
+      } else {
+        ret = is_npy ? load_npy_from_archive(*archive, *member, &loaded[i])
+                     : load_weights_from_archive(*archive, *member, &loaded[i]);
+      }
+    } else {
+      ret = is_npy ? load_npy(filepath, &loaded[i], option)
+                   : load_weights(filepath, &loaded[i], option);
+    }
+    if (!ret) {
+      std::cerr << "Failed to read weight/tensor : " << filepath << "\n";
+      failed = true;
+      return;
+    }
+    succeeded[i] = 1;
+  });
+
+  if (manifest) {
+    // Loaded payloads are checked from memory. After a failure, the files are
+    // read to tell whether it comes from a truncated or corrupted file.
+    std::vector<ManifestFile> files(weights.size());
+    for (size_t i = 0; i < weights.size(); i++) {
+      files[i].path = weights[i].second;
+      files[i].filepath = JoinPath(base_dir, weights[i].second);
+      files[i].tensor = failed ? nullptr : &loaded[i];
+    }
+    if (!verify_manifest(*manifest, files, num_threads)) {
+      std::cerr << "Weight/tensor files do not match the manifest : "
+                << manifest->filename() << "\n";
       return false;
     }
+  }
 
-    std::cout << "loaded tensor/weight : " << item.first
-              << ", len(shape) = " << tensor.shape.size() << "\n";
-    (*tensors)[item.first] = tensor;
+  if (failed) {
+    return false;
   }
 
+  size_t total_bytes = 0;
+  for (size_t i = 0; i < weights.size(); i++) {
+    assert(succeeded[i]);
+    std::cout << "loaded tensor/weight : " << weights[i].first
+              << ", len(shape) = " << loaded[i].shape.size() << "\n";
+    if (loaded[i].loaded) {
+      total_bytes += loaded[i].byte_size();
+    }
+    (*tensors)[weights[i].first] = std::move(loaded[i]);
+  }
+
+  auto end_time = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed = end_time - start_time;
+  const double mb = double(total_bytes) / (1024.0 * 1024.0);
+
+  std::cout << "Loaded " << weights.size() << " weights/tensors(" << mb
+            << " MB) in " << elapsed.count() << " secs with "
+            << get_num_threads(num_threads) << " threads. "
+            << ((elapsed.count() > 0.0) ? (mb / elapsed.count()) : 0.0)
+            << " MB/s\n";
+
   return true;
 }
 
-static bool ParseInputProperty(const Json &j, Node *node, Graph *graph) {
-  (void)j;
+namespace {
+
+// Value of a string property of a layer.
+struct LayerString {
+  std::string value;
+  bool is_string = false;  // false when missing or not a string
+};
+
+// Properties of a layer in model.json used by nnview. Other properties are
+// skipped without being copied.
+struct JsonLayer {
+  std::string type;
+  std::string name;
+  int rank = 0;  // layer depth
+  std::vector<std::string> output_names;
+  LayerString source;
+  LayerString kernel_weights_file;
+  LayerString bias_weights_file;
+  LayerString input_tensor;
+  LayerString output_tensor;
+};
+
+}  // namespace
+
+static bool ReadLayerString(JsonReader *r, LayerString *s) {
+  s->is_string = (r->peek() == JSON_TYPE_STRING);
+  if (s->is_string) {
+    return r->read_string(&s->value);
+  }
+  s->value.clear();
+  return r->skip();
+}
+
+// Read an array of strings. Other elements are skipped.
+static bool ReadStringArray(JsonReader *r, std::vector<std::string> *strs) {
+  strs->clear();
+  if (r->peek() != JSON_TYPE_ARRAY) {
+    return r->skip();
+  }
+  return r->read_array([&]() {
+    if (r->peek() != JSON_TYPE_STRING) {
+      return r->skip();
+    }
+    strs->emplace_back();
+    return r->read_string(&strs->back());
+  });
+}
+
+// Read a layer object. `layer` is reused between layers to keep the
+// allocated strings.
+static bool ReadLayer(JsonReader *r, JsonLayer *layer) {
+  layer->type.clear();
+  layer->name.clear();
+  layer->rank = 0;
+  layer->output_names.clear();
+  layer->source = LayerString();
+  layer->kernel_weights_file = LayerString();
+  layer->bias_weights_file = LayerString();
+  layer->input_tensor = LayerString();
+  layer->output_tensor = LayerString();
+
+  return r->read_object([&](const std::string &key) {
+    if (key.compare("type") == 0) {
+      return r->get_string(&layer->type);
+    } else if (key.compare("name") == 0) {
+      return r->get_string(&layer->name);
+    } else if (key.compare("rank") == 0) {
+      return r->get_int(&layer->rank);
+    } else if (key.compare("output_names") == 0) {
+      return ReadStringArray(r, &layer->output_names);
+    } else if (key.compare("source") == 0) {
+      return ReadLayerString(r, &layer->source);
+    } else if (key.compare("kernel_weights_file") == 0) {
+      return ReadLayerString(r, &layer->kernel_weights_file);
+    } else if (key.compare("bias_weights_file") == 0) {
+      return ReadLayerString(r, &layer->bias_weights_file);
+    } else if (key.compare("input_tensor") == 0) {
+      return ReadLayerString(r, &layer->input_tensor);
+    } else if (key.compare("output_tensor") == 0) {
+      return ReadLayerString(r, &layer->output_tensor);
+    }
+    return r->skip();
+  });
+}
+
+static bool ParseInputProperty(const JsonLayer &layer, Node *node,
+                               Graph *graph) {
+  (void)layer;
   (void)node;
   (void)graph;
 #if 0
@@ -88,196 +284,419 @@ static bool ParseInputProperty(const Json &j, Node *node, Graph *graph) {
 }
 
 static bool ParseLinearFunctionProperty(
-    const Json &j, Node *node,
+    const JsonLayer &layer, Node *node, SymbolTable *symbols,
     std::vector<std::pair<std::string, std::string>> *tensor_files) {
-  if (j["source"].is_string()) {
-    std::string name = j["source"].string_value();
+  if (layer.source.is_string) {
+    const std::string &name = layer.source.value;
 
     // id will be determinted later
-    node->inputs.push_back(Slot(name, "input", -1));
+    node->inputs.push_back(
+        Slot(symbols->intern(name), symbols->intern("input"), -1));
   }
 
-  if (j["kernel_weights_file"].is_string()) {
-    std::string filepath = j["kernel_weights_file"].string_value();
+  if (layer.kernel_weights_file.is_string) {
+    const std::string &filepath = layer.kernel_weights_file.value;
 
     (*tensor_files).push_back({filepath, filepath});
 
     // id will be determinted later
-    node->inputs.push_back(Slot(filepath, "W", -1));
+    node->inputs.push_back(
+        Slot(symbols->intern(filepath), symbols->intern("W"), -1));
   }
 
-  if (j["bias_weights_file"].is_string()) {
-    std::string filepath = j["bias_weights_file"].string_value();
+  if (layer.bias_weights_file.is_string) {
+    const std::string &filepath = layer.bias_weights_file.value;
 
     (*tensor_files).push_back({filepath, filepath});
 
     // id will be determinted later
-    node->inputs.push_back(Slot(filepath, "b", -1));
+    node->inputs.push_back(
+        Slot(symbols->intern(filepath), symbols->intern("b"), -1));
   }
 
   return true;
 }
 
-static bool ParseReLUProperty(const Json &j, Node *node) {
-  if (j["source"].is_string()) {
-    std::string name = j["source"].string_value();
+static bool ParseReLUProperty(const JsonLayer &layer, Node *node,
+                              SymbolTable *symbols) {
+  if (layer.source.is_string) {
+    const std::string &name = layer.source.value;
 
     // id will be determinted later
-    node->inputs.push_back(Slot(name, "input", -1));
+    node->inputs.push_back(
+        Slot(symbols->intern(name), symbols->intern("input"), -1));
   }
 
   return true;
 }
 
-static int FindTensor(const std::string &name,
-                      const std::vector<Tensor> &tensors) {
-  for (size_t i = 0; i < tensors.size(); i++) {
-    if (name.compare(tensors[i].name) == 0) {
-      return int(i);
-    }
-  }
+namespace {
 
-  return -1;  // not found
-}
+// Number of layers parsed by a worker at a time. Fixed so that the result
+// does not depend on the number of threads.
+constexpr size_t kLayersPerChunk = 512;
 
-bool load_json_graph(const std::string &filename, Graph *graph) {
-  if (graph == nullptr) {
-    std::cerr << "`graph` is nullptr\n";
-    return false;
-  }
+// Chunks parsed per thread before they are merged. Bounds the memory held by
+// parsed but not yet merged layers.
+constexpr size_t kChunksPerThread = 4;
 
-  std::ifstream ifs(filename, std::ios::in);
-  if (!ifs) {
-    std::cerr << "Failed to open graph file : " << filename << std::endl;
-    return false;
-  }
+// Nodes built from consecutive layers by a worker thread. Names are interned
+// in a chunk-local table and remapped to `Graph::symbols` when the chunks are
+// merged in order.
+struct LayerChunk {
+  SymbolTable symbols;
+  std::vector<Node> nodes;
+  std::vector<Symbol> node_names;  // name of each node
+  std::vector<std::pair<std::string, std::string>>
+      tensor_files;  // <name, filename>
+  std::string log;
 
-  std::stringstream ss;
-  ss << ifs.rdbuf();
-  ifs.close();
+  bool ok = true;
+  bool json_error = false;  // `err` is a JSON parse error
+  std::string err;
+};
 
-  std::string json_str(ss.str());
+}  // namespace
 
-  std::string err;
-  Json json = Json::parse(json_str, err);
+// Build the node of `layer` into `chunk`.
+static bool BuildNode(const JsonLayer &layer, int id, Graph *graph,
+                      LayerChunk *chunk) {
+  SymbolTable &symbols = chunk->symbols;
+  auto &temp_tensors = chunk->tensor_files;
 
-  if (!err.empty()) {
-    std::cerr << "JSON parse error. filename: " << filename << " err: " << err
-              << std::endl;
-    return false;
+  Node node;
+  node.name = layer.name;
+  node.depth = layer.rank;
+
+  for (const auto &output_name : layer.output_names) {
+    node.outputs.push_back(
+        Slot(symbols.intern(output_name), symbols.intern("output"), -1));
   }
 
-  std::vector<std::string> inputs;
-  for (auto input : json["inputs"].array_items()) {
-    if (input.is_string()) {
-      inputs.push_back(input.string_value());
+  // TODO(LTE): Support multiple outputs.
+  if (node.outputs.size() == 1) {
+    if (layer.output_tensor.is_string) {
+      temp_tensors.push_back(
+          {symbols.str(node.outputs[0].name), layer.output_tensor.value});
     }
   }
 
-  std::vector<std::string> outputs;
-  for (auto output : json["outputs"].array_items()) {
-    // Chainer-TRT's outpus is an array of array item.
-    if (output.is_array()) {
-      // Just take the first one.
-      auto &item = output.array_items()[0];
-      if (item.is_string()) {
-        outputs.push_back(item.string_value());
-      }
+  if (layer.type.compare("input") == 0) {
+    bool ret = ParseInputProperty(layer, &node, graph);
+    if (!ret) {
+      chunk->err = "Failed to parse `input` layer.";
+      return false;
+    }
+
+    // `input` layer has `input_tensor`.
+    // We treat it as output tensor.
+    assert(node.outputs.size() == 1);
+    if (layer.input_tensor.is_string) {
+      temp_tensors.push_back(
+          {symbols.str(node.outputs[0].name), layer.input_tensor.value});
+    }
+
+  } else if (layer.type.compare("LinearFunction") == 0) {
+    bool ret =
+        ParseLinearFunctionProperty(layer, &node, &symbols, &temp_tensors);
+    if (!ret) {
+      chunk->err = "Failed to parse `LinearFunction` layer.";
+      return false;
     }
+  } else if (layer.type.compare("ReLU") == 0) {
+    bool ret = ParseReLUProperty(layer, &node, &symbols);
+    if (!ret) {
+      chunk->err = "Failed to parse `ReLU` layer.";
+      return false;
+    }
+  } else {
+    // Unknown
   }
 
-  std::map<std::string, int> node_name_to_id_map;
+  node.id = id;
 
-  std::vector<std::pair<std::string, std::string>>
-      temp_tensors;  // <name, filename>
+  chunk->log += "Node: " + layer.name + ", id: " + std::to_string(id) + "\n";
+  chunk->log +=
+      "  # of inputs: " + std::to_string(node.inputs.size()) + "\n";
+  chunk->log +=
+      "  # of outputs: " + std::to_string(node.outputs.size()) + "\n";
 
-  graph->nodes.clear();
-  // layers
-  for (auto layer : json["layers"].array_items()) {
-    // Exampe definition of layer.
-    // See $nnview/models/mnist/model.json for details.
-    //
-    // {
-    //   "type": "input",
-    //   "name": "input",
-    //   "output_names": [
-    //     "input"
-    //   ],
-    //   "rank": -2,
-    //   "shape": [
-    //     784
-    //   ]
-    // },
-
-    if (!layer.is_object()) {
-      continue;
+  chunk->node_names.push_back(symbols.intern(layer.name));
+  chunk->nodes.push_back(std::move(node));
+  return true;
+}
+
+// Parse `layers[begin, end)` into `chunk`. `first_id` is the node id of
+// `layers[0]`.
+static void ParseLayerChunk(std::vector<JsonReader> *layers, size_t begin,
+                            size_t end, int first_id, Graph *graph,
+                            LayerChunk *chunk) {
+  JsonLayer layer;
+  for (size_t i = begin; i < end; i++) {
+    JsonReader &r = (*layers)[i];
+    if (!ReadLayer(&r, &layer) || !r.finish()) {
+      chunk->ok = false;
+      chunk->json_error = true;
+      chunk->err = r.error();
+      return;
     }
 
-    std::string type = layer["type"].string_value();
-    std::string name = layer["name"].string_value();
+    if (!BuildNode(layer, first_id + int(i), graph, chunk)) {
+      chunk->ok = false;
+      return;
+    }
+  }
+}
 
-    std::vector<std::string> output_names;
+// Find the JSON graph in the archive. `model.json` closest to the root is
+// preferred, otherwise the archive must contain exactly one JSON file.
+static const ArchiveMember *FindGraphMember(const Archive &archive) {
+  const ArchiveMember *model_json = nullptr;
+  const ArchiveMember *json = nullptr;
+  size_t num_json = 0;
+  for (const auto &member : archive.members()) {
+    if (GetFileExtension(member.name).compare(".json") != 0) {
+      continue;
+    }
+    num_json++;
+    json = &member;
+
+    const size_t pos = member.name.find_last_of("/\\");
+    const std::string basename =
+        (pos == std::string::npos) ? member.name : member.name.substr(pos + 1);
+    if ((basename.compare("model.json") == 0) &&
+        (!model_json || (member.name.size() < model_json->name.size()))) {
+      model_json = &member;
+    }
+  }
 
-    // rank = layer depth
-    int rank = layer["rank"].int_value();
+  if (model_json) {
+    return model_json;
+  }
+  return (num_json == 1) ? json : nullptr;
+}
 
-    Node node;
-    node.name = name;
-    node.depth = rank;
+bool load_json_graph(const std::string &filename, Graph *graph,
+                     const GraphLoadOption &option) {
+  if (graph == nullptr) {
+    std::cerr << "`graph` is nullptr\n";
+    return false;
+  }
 
-    for (auto &output_name : layer["output_names"].array_items()) {
-      if (output_name.is_string()) {
-        node.outputs.push_back(Slot(output_name.string_value(), "output", -1));
-      }
+  // The JSON is parsed in place from the mapped file(or the stored archive
+  // member) without building a DOM.
+  const char *json_data = nullptr;
+  size_t json_size = 0;
+  std::string json_str;  // for a compressed archive member
+  std::shared_ptr<MappedFile> mapping;
+  std::string base_dir;
+  std::shared_ptr<Archive> archive;
+  if (Archive::is_archive_filename(filename)) {
+    archive = Archive::open(filename);
+    if (!archive) {
+      return false;
     }
 
-    // TODO(LTE): Support multiple outputs.
-    if (node.outputs.size() == 1) {
-      if (layer["output_tensor"].is_string()) {
-        std::string tensor_filename = layer["output_tensor"].string_value();
-        temp_tensors.push_back({node.outputs[0].name, tensor_filename});
-      }
+    const ArchiveMember *member = FindGraphMember(*archive);
+    if (!member) {
+      std::cerr << "JSON graph file not found in archive : " << filename
+                << std::endl;
+      return false;
     }
 
-    if (type.compare("input") == 0) {
-      bool ret = ParseInputProperty(layer, &node, graph);
-      if (!ret) {
-        std::cerr << "Failed to parse `input` layer.\n";
+    if (const uint8_t *data = archive->data(*member)) {
+      json_data = reinterpret_cast<const char *>(data);
+      json_size = size_t(member->size);
+    } else {
+      std::string err;
+      json_str.resize(size_t(member->size));
+      if (!archive->read(*member, 0, json_str.size(),
+                         reinterpret_cast<uint8_t *>(&json_str[0]), &err)) {
+        std::cerr << err << " member : " << member->name << " in "
+                  << filename << std::endl;
         return false;
       }
+      json_data = json_str.data();
+      json_size = json_str.size();
+    }
 
-      // `input` layer has `input_tensor`.
-      // We treat it as output tensor.
-      assert(node.outputs.size() == 1);
-      if (layer["input_tensor"].is_string()) {
-        std::string tensor_filename = layer["input_tensor"].string_value();
-        temp_tensors.push_back({node.outputs[0].name, tensor_filename});
-      }
+    // Weights/tensors are looked up relative to the JSON in the archive.
+    base_dir = GetBaseDir(member->name);
+  } else {
+    mapping = MappedFile::open(filename);
+    if (!mapping) {
+      std::cerr << "Failed to open graph file : " << filename << std::endl;
+      return false;
+    }
 
-    } else if (type.compare("LinearFunction") == 0) {
-      bool ret = ParseLinearFunctionProperty(layer, &node, &temp_tensors);
-      if (!ret) {
-        std::cerr << "Failed to parse `LinearFunction` layer.\n";
-        return false;
-      }
-    } else if (type.compare("ReLU") == 0) {
-      bool ret = ParseReLUProperty(layer, &node);
-      if (!ret) {
-        std::cerr << "Failed to parse `ReLU` layer.\n";
-        return false;
+    json_data = reinterpret_cast<const char *>(mapping->data());
+    json_size = mapping->size();
+    base_dir = GetBaseDir(filename);
+  }
+
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+
+  // Node and tensor names are interned in `graph->symbols`, so links are
+  // resolved by indexing with a symbol instead of comparing strings.
+  SymbolTable &symbols = graph->symbols;
+  symbols.clear();
+
+  // <symbol, node id>. -1 = not a node name.
+  std::vector<int> node_name_to_id_map;
+
+  std::vector<std::pair<std::string, std::string>>
+      temp_tensors;  // <name, filename>
+
+  graph->nodes.clear();
+
+  // Exampe definition of layer.
+  // See $nnview/models/mnist/model.json for details.
+  //
+  // {
+  //   "type": "input",
+  //   "name": "input",
+  //   "output_names": [
+  //     "input"
+  //   ],
+  //   "rank": -2,
+  //   "shape": [
+  //     784
+  //   ]
+  // },
+  JsonReader reader(json_data, json_size);
+  bool error_reported = false;
+
+  // Layers are located serially and parsed in chunks by worker threads.
+  auto read_layers = [&]() {
+    std::vector<JsonReader> layers;
+    const bool located = reader.read_array([&]() {
+      if (reader.peek() != JSON_TYPE_OBJECT) {
+        return reader.skip();
       }
-    } else {
-      // Unknown
+      layers.emplace_back();
+      return reader.read_raw(&layers.back());
+    });
+    if (!located) {
+      return false;
     }
 
-    node.id = int(graph->nodes.size());
-    graph->nodes.push_back(node);
+    // Parse a wave of chunks in parallel, then merge it in order, so that
+    // only one wave of parsed layers is held at a time.
+    // Chunk-local symbols are interned in the order of their first
+    // appearance, so the result is the same as parsing the layers serially.
+    const int first_id = int(graph->nodes.size());
+    const size_t num_chunks =
+        (layers.size() + kLayersPerChunk - 1) / kLayersPerChunk;
+    const size_t wave_size =
+        kChunksPerThread * size_t(get_num_threads(option.num_threads));
+    graph->nodes.reserve(graph->nodes.size() + layers.size());
+
+    std::vector<LayerChunk> chunks;
+    std::vector<Symbol> to_global;
+    for (size_t wave = 0; wave < num_chunks; wave += wave_size) {
+      chunks.clear();
+      chunks.resize(std::min(wave_size, num_chunks - wave));
+      parallel_for(chunks.size(), option.num_threads, [&](size_t c) {
+        const size_t begin = (wave + c) * kLayersPerChunk;
+        ParseLayerChunk(&layers, begin,
+                        std::min(layers.size(), begin + kLayersPerChunk),
+                        first_id, graph, &chunks[c]);
+      });
+
+      for (auto &chunk : chunks) {
+        std::cout << chunk.log;
+
+        if (!chunk.ok) {
+          if (chunk.json_error) {
+            std::cerr << "JSON parse error. filename: " << filename
+                      << " err: " << chunk.err << std::endl;
+          } else {
+            std::cerr << chunk.err << "\n";
+          }
+          error_reported = true;
+          return false;
+        }
+
+        to_global.resize(chunk.symbols.size());
+        for (size_t i = 0; i < chunk.symbols.size(); i++) {
+          to_global[i] = symbols.intern(chunk.symbols.str(Symbol(i)));
+        }
+
+        for (size_t n = 0; n < chunk.nodes.size(); n++) {
+          Node &node = chunk.nodes[n];
+          for (auto &slot : node.inputs) {
+            slot.name = to_global[slot.name];
+            slot.slot_name = to_global[slot.slot_name];
+          }
+          for (auto &slot : node.outputs) {
+            slot.name = to_global[slot.name];
+            slot.slot_name = to_global[slot.slot_name];
+          }
+
+          const Symbol sym = to_global[chunk.node_names[n]];
+          if (sym >= node_name_to_id_map.size()) {
+            node_name_to_id_map.resize(symbols.size(), -1);
+          }
+          node_name_to_id_map[sym] = node.id;
+
+          graph->nodes.push_back(std::move(node));
+        }
+
+        for (auto &item : chunk.tensor_files) {
+          temp_tensors.push_back(std::move(item));
+        }
+      }
+    }
 
-    std::cout << "Node: " << name << ", id: " << node.id << "\n";
-    std::cout << "  # of inputs: " << node.inputs.size() << "\n";
-    std::cout << "  # of outputs: " << node.outputs.size() << "\n";
+    return true;
+  };
 
-    node_name_to_id_map[name] = node.id;
+  auto read_graph = [&](const std::string &key) {
+    if (key.compare("inputs") == 0) {
+      return ReadStringArray(&reader, &inputs);
+    } else if (key.compare("outputs") == 0) {
+      outputs.clear();
+      if (reader.peek() != JSON_TYPE_ARRAY) {
+        return reader.skip();
+      }
+      return reader.read_array([&]() {
+        // Chainer-TRT's outpus is an array of array item.
+        if (reader.peek() != JSON_TYPE_ARRAY) {
+          return reader.skip();
+        }
+        // Just take the first one.
+        bool first = true;
+        return reader.read_array([&]() {
+          if (!first || (reader.peek() != JSON_TYPE_STRING)) {
+            first = false;
+            return reader.skip();
+          }
+          first = false;
+          outputs.emplace_back();
+          return reader.read_string(&outputs.back());
+        });
+      });
+    } else if (key.compare("layers") == 0) {
+      if (reader.peek() != JSON_TYPE_ARRAY) {
+        return reader.skip();
+      }
+      return read_layers();
+    }
+    return reader.skip();
+  };
+
+  const bool parsed = ((reader.peek() == JSON_TYPE_OBJECT)
+                           ? reader.read_object(read_graph)
+                           : reader.skip()) &&
+                      reader.finish();
+  if (error_reported) {
+    return false;
+  }
+  if (!parsed) {
+    std::cerr << "JSON parse error. filename: " << filename
+              << " err: " << reader.error() << std::endl;
+    return false;
   }
 
   for (size_t i = 0; i < temp_tensors.size(); i++) {
@@ -285,47 +704,79 @@ bool load_json_graph(const std::string &filename, Graph *graph) {
               << "\n";
   }
 
+  Manifest manifest;
+  if (!option.manifest_filename.empty()) {
+    if (archive) {
+      std::cerr << "Manifest verification is not supported for archives : "
+                << filename << "\n";
+      return false;
+    }
+    if (!manifest.load(option.manifest_filename)) {
+      return false;
+    }
+  }
+
   // Batch load weights/tensors.
   {
-    std::string base_dir = GetBaseDir(filename);
-
     std::map<std::string, Tensor> tensors;
-    if (!LoadWeights(temp_tensors, base_dir, &tensors)) {
+    if (!LoadWeights(temp_tensors, base_dir, archive.get(),
+                     option.manifest_filename.empty() ? nullptr : &manifest,
+                     option.weights, option.num_threads, &tensors)) {
       return false;
     }
 
     for (auto &item : tensors) {
       // Rename
       item.second.name = item.first;
-      graph->tensors.push_back(item.second);
       std::cout << "len(shape) = " << item.second.shape.size() << "\n";
+      graph->tensors.push_back(std::move(item.second));
     }
   }
 
   // Find id for input and output of the graph.
   {
+    // Unknown names get id 0.
+    auto find_node_id = [&](Symbol sym) {
+      return ((sym < node_name_to_id_map.size()) &&
+              (node_name_to_id_map[sym] >= 0))
+                 ? node_name_to_id_map[sym]
+                 : 0;
+    };
+
     for (const auto &input : inputs) {
-      int input_id = node_name_to_id_map[input];
-      graph->inputs.push_back(Slot(input, "input", input_id));
+      const Symbol sym = symbols.intern(input);
+      int input_id = find_node_id(sym);
+      graph->inputs.push_back(Slot(sym, symbols.intern("input"), input_id));
       std::cout << "Input: " << input << ", id: " << input_id << "\n";
     }
 
     for (const auto &output : outputs) {
-      int output_id = node_name_to_id_map[output];
-      graph->inputs.push_back(Slot(output, "output", output_id));
+      const Symbol sym = symbols.intern(output);
+      int output_id = find_node_id(sym);
+      graph->inputs.push_back(Slot(sym, symbols.intern("output"), output_id));
       std::cout << "Output: " << output << ", id: " << output_id << "\n";
     }
   }
 
+  // <symbol, tensor id>. -1 = no tensor. The first tensor wins when names
+  // collide.
+  std::vector<int> tensor_ids(symbols.size(), -1);
+  for (size_t t = 0; t < graph->tensors.size(); t++) {
+    const int sym = symbols.find(graph->tensors[t].name);
+    if ((sym >= 0) && (tensor_ids[size_t(sym)] == -1)) {
+      tensor_ids[size_t(sym)] = int(t);
+    }
+  }
+
   // Establish the link of inputs and outpus for each layers.
   {
     for (size_t n = 0; n < graph->nodes.size(); n++) {
       Node &node = graph->nodes[n];
 
       for (size_t i = 0; i < node.inputs.size(); i++) {
-        const std::string &name = node.inputs[i].name;
+        const std::string &name = symbols.str(node.inputs[i].name);
 
-        int tensor_id = FindTensor(name, graph->tensors);
+        int tensor_id = tensor_ids[node.inputs[i].name];
         if (tensor_id == -1) {
           std::cerr << "Input tensor \"" << name
                     << "\" not found in the graph.\n";
@@ -339,9 +790,9 @@ bool load_json_graph(const std::string &filename, Graph *graph) {
       }
 
       for (size_t o = 0; o < node.outputs.size(); o++) {
-        const std::string &name = node.outputs[o].name;
+        const std::string &name = symbols.str(node.outputs[o].name);
 
-        int tensor_id = FindTensor(name, graph->tensors);
+        int tensor_id = tensor_ids[node.outputs[o].name];
         if (tensor_id == -1) {
           std::cerr << "Output tensor \"" << name
                     << "\" not found in the graph.\n";
@@ -359,4 +810,213 @@ bool load_json_graph(const std::string &filename, Graph *graph) {
   return true;
 }
 
+bool build_tensor_graph(std::vector<Tensor> *tensors, Graph *graph) {
+  if ((tensors == nullptr) || (graph == nullptr)) {
+    return false;
+  }
+
+  graph->nodes.clear();
+  graph->tensors.clear();
+  graph->symbols.clear();
+
+  const Symbol output_sym = graph->symbols.intern("output");
+
+  for (size_t i = 0; i < tensors->size(); i++) {
+    Tensor &tensor = (*tensors)[i];
+
+    Node node;
+    node.type = LAYER_TENSOR;
+    node.id = int(i);
+    node.depth = int(i);
+    node.name = tensor.name;
+    node.outputs.push_back(
+        Slot(graph->symbols.intern(tensor.name), output_sym, int(i)));
+
+    graph->nodes.push_back(node);
+    graph->tensors.push_back(std::move(tensor));
+  }
+
+  tensors->clear();
+
+  return true;
+}
+
+void compute_node_depth(Graph *graph) {
+  const size_t num_nodes = graph->nodes.size();
+
+  // <tensor id, index of the node which outputs the tensor>
+  std::vector<int> producers(graph->tensors.size(), -1);
+  for (size_t n = 0; n < num_nodes; n++) {
+    for (const auto &slot : graph->nodes[n].outputs) {
+      if ((slot.id >= 0) && (size_t(slot.id) < producers.size())) {
+        producers[size_t(slot.id)] = int(n);
+      }
+    }
+  }
+  auto producer_of = [&producers](const Slot &slot) {
+    return ((slot.id >= 0) && (size_t(slot.id) < producers.size()))
+               ? producers[size_t(slot.id)]
+               : -1;
+  };
+
+  // Consumers of each node(CSR).
+  std::vector<size_t> offsets(num_nodes + 1, 0);
+  std::vector<size_t> num_producers(num_nodes, 0);
+  for (size_t n = 0; n < num_nodes; n++) {
+    for (const auto &slot : graph->nodes[n].inputs) {
+      const int p = producer_of(slot);
+      if (p >= 0) {
+        offsets[size_t(p) + 1]++;
+        num_producers[n]++;
+      }
+    }
+  }
+  for (size_t n = 0; n < num_nodes; n++) {
+    offsets[n + 1] += offsets[n];
+  }
+  std::vector<size_t> consumers(offsets[num_nodes]);
+  {
+    std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+    for (size_t n = 0; n < num_nodes; n++) {
+      for (const auto &slot : graph->nodes[n].inputs) {
+        const int p = producer_of(slot);
+        if (p >= 0) {
+          consumers[pos[size_t(p)]++] = n;
+        }
+      }
+    }
+  }
+
+  for (auto &node : graph->nodes) {
+    node.depth = 0;
+  }
+
+  // Longest path from the nodes without producers, in topological
+  // order(Kahn's algorithm). Linear in the number of slots whatever the
+  // order of nodes is.
+  std::vector<size_t> queue;
+  queue.reserve(num_nodes);
+  for (size_t n = 0; n < num_nodes; n++) {
+    if (num_producers[n] == 0) {
+      queue.push_back(n);
+    }
+  }
+  for (size_t head = 0; head < queue.size(); head++) {
+    const size_t n = queue[head];
+    const int depth = graph->nodes[n].depth + 1;
+    for (size_t k = offsets[n]; k < offsets[n + 1]; k++) {
+      Node &consumer = graph->nodes[consumers[k]];
+      consumer.depth = std::max(consumer.depth, depth);
+      if (--num_producers[consumers[k]] == 0) {
+        queue.push_back(consumers[k]);
+      }
+    }
+  }
+
+  // Nodes on cycles are never queued. Place them after their producers.
+  if (queue.size() < num_nodes) {
+    for (size_t n = 0; n < num_nodes; n++) {
+      if (num_producers[n] == 0) {
+        continue;
+      }
+      Node &node = graph->nodes[n];
+      for (const auto &slot : node.inputs) {
+        const int p = producer_of(slot);
+        if (p >= 0) {
+          node.depth = std::max(node.depth, graph->nodes[size_t(p)].depth + 1);
+        }
+      }
+    }
+  }
+}
+
+static bool LoadGraph(const std::string &filename, Graph *graph,
+                      const GraphLoadOption &option) {
+  const std::string ext = GetFileExtension(filename);
+
+  if (ext.compare(".npz") == 0) {
+    std::vector<Tensor> tensors;
+    if (!load_npz(filename, &tensors, option.weights, option.num_threads)) {
+      return false;
+    }
+    return build_tensor_graph(&tensors, graph);
+  } else if (ext.compare(".safetensors") == 0) {
+    std::vector<Tensor> tensors;
+    if (!load_safetensors(filename, &tensors)) {
+      return false;
+    }
+    return build_tensor_graph(&tensors, graph);
+  } else if (ext.compare(".onnx") == 0) {
+    return load_onnx_graph(filename, graph);
+  } else if (ext.compare(".tflite") == 0) {
+    return load_tflite_graph(filename, graph);
+  } else if (ext.compare(".nnvgraph") == 0) {
+    return load_binary_graph(filename, graph);
+  } else if ((ext.compare(".dot") == 0) || (ext.compare(".gv") == 0)) {
+    return load_dot_graph(filename, graph);
+  } else if (ext.compare(".npy") == 0) {
+    std::vector<Tensor> tensors(1);
+    if (!load_npy(filename, &tensors[0], option.weights)) {
+      return false;
+    }
+    tensors[0].name = GetBaseName(filename);
+    return build_tensor_graph(&tensors, graph);
+  }
+
+  // The cache holds copies of the payloads, so it cannot be verified against
+  // the manifest.
+  if (!option.use_cache || !option.manifest_filename.empty()) {
+    return load_json_graph(filename, graph, option);
+  }
+
+  const std::string cache_filename = get_model_cache_filename(filename);
+  if (load_model_cache(cache_filename, graph)) {
+    return true;
+  }
+
+  if (!load_json_graph(filename, graph, option)) {
+    return false;
+  }
+
+  // Failing to write the cache is not fatal.
+  write_model_cache(cache_filename, filename, *graph, option.weights);
+
+  return true;
+}
+
+bool load_graph(const std::string &filename, Graph *graph,
+                const GraphLoadOption &option) {
+  if (graph == nullptr) {
+    std::cerr << "`graph` is nullptr\n";
+    return false;
+  }
+
+  if (!LoadGraph(filename, graph, option)) {
+    return false;
+  }
+
+  if (option.deduplicate) {
+    const DedupStats stats =
+        deduplicate_tensors(&graph->tensors, option.num_threads);
+    if (stats.num_tensors > 0) {
+      std::cout << "Deduplicated " << stats.num_tensors
+                << " tensors with identical data. Saved "
+                << double(stats.bytes_saved) / (1024.0 * 1024.0) << " MB\n";
+    }
+  }
+
+  if (option.compress_tensors) {
+    const CompressStats stats =
+        compress_tensors(&graph->tensors, option.num_threads);
+    if (stats.num_tensors > 0) {
+      std::cout << "Compressed " << stats.num_tensors << " tensors. "
+                << double(stats.raw_bytes) / (1024.0 * 1024.0) << " MB -> "
+                << double(stats.compressed_bytes) / (1024.0 * 1024.0)
+                << " MB\n";
+    }
+  }
+
+  return true;
+}
+
 }  // namespace nnview
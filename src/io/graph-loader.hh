@@ -2,8 +2,10 @@
 #define NNVIEW_IO_GRAPH_LOADER_H_
 
 #include <string>
+#include <vector>
 
 #include "datatypes.h"
+#include "io/weights-loader.hh"
 
 //
 // Simple JSON graph loader. Supports JSON graph description generated by
@@ -11,7 +13,66 @@
 //
 namespace nnview {
 
-bool load_json_graph(const std::string &filename, Graph *graph);
+struct GraphLoadOption {
+  // Option passed to `load_weights` for each weight/tensor file.
+  WeightsLoadOption weights;
+
+  // The number of worker threads used to load weight/tensor files.
+  // <= 0 : use all hardware threads.
+  int num_threads = 0;
+
+  // Load the model from the packed cache(`get_model_cache_filename`) next to
+  // the JSON graph when it is up to date. Otherwise load the model as usual
+  // and write the cache. Only used for the JSON graph.
+  bool use_cache = false;
+
+  // Share one storage block between tensors having byte-identical payloads
+  // (e.g. tied weights). See io/tensor-dedup.hh.
+  bool deduplicate = true;
+
+  // Keep tensor payloads block-compressed in memory and decompress blocks on
+  // demand. See compressed-storage.hh. Requires zlib.
+  bool compress_tensors = false;
+
+  // Verify the size and CRC32C of weight/tensor files against this
+  // manifest(see io/manifest.hh) while loading. Empty = no verification.
+  // Only used for the JSON graph. The packed cache is not read while
+  // verifying. With `weights.header_only`, files are read once for
+  // verification.
+  std::string manifest_filename;
+};
+
+// `filename` may also be a tar(.tar, .tar.gz, .tgz) or zip(.zip) archive
+// containing the JSON graph(`model.json`, or the only .json file) and its
+// weights/tensors. Files are read directly from the archive without
+// extraction. See io/archive.hh.
+bool load_json_graph(const std::string &filename, Graph *graph,
+                     const GraphLoadOption &option = GraphLoadOption());
+
+// Load a graph or weights file. The format is determined by the file
+// extension:
+//
+//   .npz : numpy archive. Each array becomes a tensor node.
+//   .npy : numpy array.
+//   .safetensors : safetensors. Each tensor becomes a tensor node.
+//   .tflite : TensorFlow Lite model.
+//   .onnx : ONNX model.
+//   .nnvgraph : binary graph(io/binary-graph.hh).
+//   .dot, .gv : Graphviz DOT graph(io/dot-loader.hh).
+//   otherwise : JSON graph description or an archive of it(`load_json_graph`).
+//
+bool load_graph(const std::string &filename, Graph *graph,
+                const GraphLoadOption &option = GraphLoadOption());
+
+// Build a graph which has one `LAYER_TENSOR` node per tensor. Used for the
+// formats having no graph structure(e.g. NPZ, safetensors). `tensors` are moved into
+// `graph`.
+bool build_tensor_graph(std::vector<Tensor> *tensors, Graph *graph);
+
+// Compute `Node::depth` from the connection of tensors. Used for the formats
+// having no layout information(e.g. TFLite).
+// Slot ids in `graph` must be resolved before calling this function.
+void compute_node_depth(Graph *graph);
 
 }  // namespace nnview
 
@@ -0,0 +1,522 @@
+#include "io/json-reader.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace nnview {
+
+namespace {
+
+// Same as json11: values nested deeper than this from the top-level value
+// (depth 0) are rejected.
+constexpr int kMaxDepth = 200;
+
+inline bool IsDigit(char c) { return (c >= '0') && (c <= '9'); }
+
+// Characters which `read_raw` has to look at.
+struct StructuralChars {
+  constexpr StructuralChars() : is_structural() {
+    is_structural[uint8_t('"')] = true;
+    is_structural[uint8_t('{')] = true;
+    is_structural[uint8_t('}')] = true;
+    is_structural[uint8_t('[')] = true;
+    is_structural[uint8_t(']')] = true;
+  }
+  bool is_structural[256];
+};
+
+constexpr StructuralChars kStructuralChars;
+
+inline int HexValue(char c) {
+  if ((c >= '0') && (c <= '9')) {
+    return c - '0';
+  } else if ((c >= 'a') && (c <= 'f')) {
+    return c - 'a' + 10;
+  } else if ((c >= 'A') && (c <= 'F')) {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+}  // namespace
+
+static void EncodeUtf8(uint32_t cp, std::string *s) {
+  if (cp < 0x80) {
+    s->push_back(char(cp));
+  } else if (cp < 0x800) {
+    s->push_back(char(0xc0 | (cp >> 6)));
+    s->push_back(char(0x80 | (cp & 0x3f)));
+  } else if (cp < 0x10000) {
+    s->push_back(char(0xe0 | (cp >> 12)));
+    s->push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+    s->push_back(char(0x80 | (cp & 0x3f)));
+  } else {
+    s->push_back(char(0xf0 | (cp >> 18)));
+    s->push_back(char(0x80 | ((cp >> 12) & 0x3f)));
+    s->push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+    s->push_back(char(0x80 | (cp & 0x3f)));
+  }
+}
+
+JsonReader::JsonReader(const char *data, size_t size)
+    : _begin(data), _p(data), _end(data + size) {}
+
+bool JsonReader::fail(const std::string &msg) {
+  // Keep the first error.
+  if (_err.empty()) {
+    _err = msg + " at byte " + std::to_string(_p - _begin);
+  }
+  return false;
+}
+
+void JsonReader::skip_whitespace() {
+  while ((_p < _end) &&
+         ((*_p == ' ') || (*_p == '\n') || (*_p == '\r') || (*_p == '\t'))) {
+    _p++;
+  }
+}
+
+bool JsonReader::expect(const char *literal) {
+  const char *p = _p;
+  for (const char *c = literal; *c; c++, p++) {
+    if ((p >= _end) || (*p != *c)) {
+      return fail(std::string("expected `") + literal + "`");
+    }
+  }
+  _p = p;
+  return true;
+}
+
+// `_depth` is the depth of the elements of the entered object or array.
+bool JsonReader::enter() {
+  if (++_depth > kMaxDepth + 1) {
+    return fail("exceeded maximum nesting depth");
+  }
+  while (size_t(_depth) > _keys.size()) {
+    _keys.emplace_back(new std::string());
+  }
+  return true;
+}
+
+JsonType JsonReader::peek() {
+  skip_whitespace();
+  if (_p >= _end) {
+    return JSON_TYPE_INVALID;
+  }
+
+  switch (*_p) {
+    case 'n':
+      return JSON_TYPE_NULL;
+    case 't':
+    case 'f':
+      return JSON_TYPE_BOOL;
+    case '"':
+      return JSON_TYPE_STRING;
+    case '[':
+      return JSON_TYPE_ARRAY;
+    case '{':
+      return JSON_TYPE_OBJECT;
+    default:
+      break;
+  }
+
+  if ((*_p == '-') || IsDigit(*_p)) {
+    return JSON_TYPE_NUMBER;
+  }
+  return JSON_TYPE_INVALID;
+}
+
+// `s` = nullptr to only validate the string.
+bool JsonReader::scan_string(std::string *s) {
+  _p++;  // '"'
+  if (s) {
+    s->clear();
+  }
+
+  const char *start = _p;
+  while (_p < _end) {
+    const char c = *_p;
+    if (c == '"') {
+      if (s) {
+        s->append(start, _p);
+      }
+      _p++;
+      return true;
+    }
+
+    if (static_cast<unsigned char>(c) < 0x20) {
+      return fail("unescaped control character in string");
+    }
+
+    if (c != '\\') {
+      _p++;
+      continue;
+    }
+
+    if (s) {
+      s->append(start, _p);
+    }
+    _p++;
+    if (_p >= _end) {
+      break;
+    }
+
+    const char e = *_p++;
+    char decoded = 0;
+    switch (e) {
+      case 'b':
+        decoded = '\b';
+        break;
+      case 'f':
+        decoded = '\f';
+        break;
+      case 'n':
+        decoded = '\n';
+        break;
+      case 'r':
+        decoded = '\r';
+        break;
+      case 't':
+        decoded = '\t';
+        break;
+      case '"':
+      case '\\':
+      case '/':
+        decoded = e;
+        break;
+      case 'u':
+        break;
+      default:
+        return fail(std::string("invalid escape character `") + e + "`");
+    }
+
+    if (e != 'u') {
+      if (s) {
+        s->push_back(decoded);
+      }
+      start = _p;
+      continue;
+    }
+
+    // \uXXXX. A surrogate pair is combined into one code point.
+    auto read_hex4 = [this](uint32_t *cp) {
+      if (_end - _p < 4) {
+        return false;
+      }
+      uint32_t v = 0;
+      for (int k = 0; k < 4; k++) {
+        const int h = HexValue(_p[k]);
+        if (h < 0) {
+          return false;
+        }
+        v = (v << 4) | uint32_t(h);
+      }
+      _p += 4;
+      (*cp) = v;
+      return true;
+    };
+
+    uint32_t cp = 0;
+    if (!read_hex4(&cp)) {
+      return fail("bad \\u escape");
+    }
+    if ((cp >= 0xd800) && (cp <= 0xdbff) && (_end - _p >= 6) &&
+        (_p[0] == '\\') && (_p[1] == 'u')) {
+      const char *saved = _p;
+      _p += 2;
+      uint32_t low = 0;
+      if (!read_hex4(&low)) {
+        return fail("bad \\u escape");
+      }
+      if ((low >= 0xdc00) && (low <= 0xdfff)) {
+        cp = (((cp - 0xd800) << 10) | (low - 0xdc00)) + 0x10000;
+      } else {
+        _p = saved;
+      }
+    }
+    if (s) {
+      EncodeUtf8(cp, s);
+    }
+    start = _p;
+  }
+
+  return fail("unexpected end of input in string");
+}
+
+// `v` = nullptr to only validate the number.
+bool JsonReader::scan_number(double *v) {
+  const char *start = _p;
+
+  if ((_p < _end) && (*_p == '-')) {
+    _p++;
+  }
+
+  if ((_p < _end) && (*_p == '0')) {
+    _p++;
+    if ((_p < _end) && IsDigit(*_p)) {
+      return fail("leading 0s not permitted in numbers");
+    }
+  } else if ((_p < _end) && IsDigit(*_p)) {
+    while ((_p < _end) && IsDigit(*_p)) {
+      _p++;
+    }
+  } else {
+    return fail("invalid number");
+  }
+
+  if ((_p < _end) && (*_p == '.')) {
+    _p++;
+    if ((_p >= _end) || !IsDigit(*_p)) {
+      return fail("at least one digit required in fractional part");
+    }
+    while ((_p < _end) && IsDigit(*_p)) {
+      _p++;
+    }
+  }
+
+  if ((_p < _end) && ((*_p == 'e') || (*_p == 'E'))) {
+    _p++;
+    if ((_p < _end) && ((*_p == '+') || (*_p == '-'))) {
+      _p++;
+    }
+    if ((_p >= _end) || !IsDigit(*_p)) {
+      return fail("at least one digit required in exponent");
+    }
+    while ((_p < _end) && IsDigit(*_p)) {
+      _p++;
+    }
+  }
+
+  if (v) {
+    // The buffer is not null terminated.
+    const std::string str(start, _p);
+    (*v) = std::strtod(str.c_str(), nullptr);
+  }
+  return true;
+}
+
+bool JsonReader::read_object(
+    const std::function<bool(const std::string &key)> &f) {
+  if (peek() != JSON_TYPE_OBJECT) {
+    return fail("expected object");
+  }
+  if (!enter()) {
+    return false;
+  }
+  _p++;
+
+  std::string &key = *_keys[size_t(_depth - 1)];
+
+  skip_whitespace();
+  if ((_p < _end) && (*_p == '}')) {
+    _p++;
+    _depth--;
+    return true;
+  }
+
+  if (_depth > kMaxDepth) {
+    return fail("exceeded maximum nesting depth");
+  }
+
+  for (;;) {
+    skip_whitespace();
+    if ((_p >= _end) || (*_p != '"')) {
+      return fail("expected '\"' in object");
+    }
+    if (!scan_string(&key)) {
+      return false;
+    }
+
+    skip_whitespace();
+    if ((_p >= _end) || (*_p != ':')) {
+      return fail("expected ':' in object");
+    }
+    _p++;
+
+    if (!f(key)) {
+      return fail("invalid value of `" + key + "`");
+    }
+
+    skip_whitespace();
+    if ((_p < _end) && (*_p == ',')) {
+      _p++;
+      continue;
+    }
+    if ((_p < _end) && (*_p == '}')) {
+      _p++;
+      break;
+    }
+    return fail("expected ',' or '}' in object");
+  }
+
+  _depth--;
+  return true;
+}
+
+bool JsonReader::read_array(const std::function<bool()> &f) {
+  if (peek() != JSON_TYPE_ARRAY) {
+    return fail("expected array");
+  }
+  if (!enter()) {
+    return false;
+  }
+  _p++;
+
+  skip_whitespace();
+  if ((_p < _end) && (*_p == ']')) {
+    _p++;
+    _depth--;
+    return true;
+  }
+
+  if (_depth > kMaxDepth) {
+    return fail("exceeded maximum nesting depth");
+  }
+
+  for (;;) {
+    if (!f()) {
+      return fail("invalid array element");
+    }
+
+    skip_whitespace();
+    if ((_p < _end) && (*_p == ',')) {
+      _p++;
+      continue;
+    }
+    if ((_p < _end) && (*_p == ']')) {
+      _p++;
+      break;
+    }
+    return fail("expected ',' or ']' in array");
+  }
+
+  _depth--;
+  return true;
+}
+
+bool JsonReader::read_string(std::string *s) {
+  if (peek() != JSON_TYPE_STRING) {
+    return fail("expected string");
+  }
+  return scan_string(s);
+}
+
+bool JsonReader::read_number(double *v) {
+  if (peek() != JSON_TYPE_NUMBER) {
+    return fail("expected number");
+  }
+  return scan_number(v);
+}
+
+bool JsonReader::skip() {
+  switch (peek()) {
+    case JSON_TYPE_NULL:
+      return expect("null");
+    case JSON_TYPE_BOOL:
+      return (*_p == 't') ? expect("true") : expect("false");
+    case JSON_TYPE_NUMBER:
+      return scan_number(nullptr);
+    case JSON_TYPE_STRING:
+      return scan_string(nullptr);
+    case JSON_TYPE_ARRAY:
+      return read_array([this]() { return skip(); });
+    case JSON_TYPE_OBJECT:
+      return read_object([this](const std::string &) { return skip(); });
+    case JSON_TYPE_INVALID:
+      break;
+  }
+
+  if (_p >= _end) {
+    return fail("unexpected end of input");
+  }
+  return fail(std::string("unexpected character `") + *_p + "`");
+}
+
+bool JsonReader::read_raw(JsonReader *value) {
+  const JsonType type = peek();
+  if ((type != JSON_TYPE_OBJECT) && (type != JSON_TYPE_ARRAY)) {
+    return fail("expected object or array");
+  }
+
+  const char *begin = _p;
+  size_t depth = 0;
+  while (_p < _end) {
+    const char c = *_p++;
+    if (!kStructuralChars.is_structural[uint8_t(c)]) {
+      continue;
+    }
+
+    if (c == '"') {
+      // Find the closing quote, which is preceded by an even number of
+      // backslashes.
+      for (;;) {
+        const void *q = memchr(_p, '"', size_t(_end - _p));
+        if (!q) {
+          _p = _end;
+          return fail("unexpected end of input in string");
+        }
+        const char *quote = static_cast<const char *>(q);
+        size_t num_backslashes = 0;
+        while (quote[-1 - std::ptrdiff_t(num_backslashes)] == '\\') {
+          num_backslashes++;
+        }
+        _p = quote + 1;
+        if ((num_backslashes % 2) == 0) {
+          break;
+        }
+      }
+    } else if ((c == '{') || (c == '[')) {
+      depth++;
+    } else if (--depth == 0) {
+      value->_begin = _begin;
+      value->_p = begin;
+      value->_end = _p;
+      value->_depth = _depth;
+      value->_err.clear();
+      return true;
+    }
+  }
+
+  return fail("unexpected end of input");
+}
+
+bool JsonReader::get_string(std::string *s) {
+  if (peek() == JSON_TYPE_STRING) {
+    return scan_string(s);
+  }
+  s->clear();
+  return skip();
+}
+
+bool JsonReader::get_int(int *v) {
+  if (peek() == JSON_TYPE_NUMBER) {
+    double d = 0.0;
+    if (!scan_number(&d)) {
+      return false;
+    }
+    // Clamp instead of the undefined conversion of an out of range value.
+    if (!(d > double(std::numeric_limits<int>::min()))) {
+      (*v) = std::isnan(d) ? 0 : std::numeric_limits<int>::min();
+    } else if (!(d < double(std::numeric_limits<int>::max()))) {
+      (*v) = std::numeric_limits<int>::max();
+    } else {
+      (*v) = int(d);
+    }
+    return true;
+  }
+  (*v) = 0;
+  return skip();
+}
+
+bool JsonReader::finish() {
+  skip_whitespace();
+  if (_p != _end) {
+    return fail(std::string("unexpected trailing `") + *_p + "`");
+  }
+  return true;
+}
+
+}  // namespace nnview
@@ -0,0 +1,97 @@
+#ifndef NNVIEW_IO_JSON_READER_H_
+#define NNVIEW_IO_JSON_READER_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+// Streaming(pull) JSON reader.
+//
+// Reads values in place from a buffer(e.g. a memory mapped file) without
+// building a DOM. The caller walks the document with `read_object` and
+// `read_array` and either reads or `skip`s each value, so only the values
+// the caller keeps are copied.
+//
+// The whole document is validated as in json11(RFC 8259 grammar, maximum
+// nesting depth of 200) even for skipped values.
+//
+namespace nnview {
+
+enum JsonType {
+  JSON_TYPE_NULL,
+  JSON_TYPE_BOOL,
+  JSON_TYPE_NUMBER,
+  JSON_TYPE_STRING,
+  JSON_TYPE_ARRAY,
+  JSON_TYPE_OBJECT,
+  JSON_TYPE_INVALID,  // syntax error or end of input
+};
+
+class JsonReader {
+ public:
+  JsonReader() : JsonReader(nullptr, 0) {}
+  JsonReader(const char *data, size_t size);
+
+  // Type of the next value.
+  JsonType peek();
+
+  // Calls `f(key)` for each member of the object. `f` must consume the value
+  // (read it or `skip()` it) and return false on error. `key` is valid only
+  // during the call.
+  bool read_object(const std::function<bool(const std::string &key)> &f);
+
+  // Calls `f()` for each element of the array. `f` must consume the element.
+  bool read_array(const std::function<bool()> &f);
+
+  bool read_string(std::string *s);
+  bool read_number(double *v);
+
+  // Skip the next value.
+  bool skip();
+
+  // Find the extent of the next object or array by matching brackets and
+  // quotes only, which is much faster than `skip()`, and set `value` to a
+  // reader of it. The value is NOT validated until it is read with `value`,
+  // e.g. by a worker thread. Error offsets and the nesting depth of `value`
+  // continue from this reader.
+  bool read_raw(JsonReader *value);
+
+  // Read a string or a number in the json11 accessor manner: a value of the
+  // other type is skipped and gives the default value("" or 0).
+  bool get_string(std::string *s);
+  bool get_int(int *v);
+
+  // Check that only whitespace follows the document.
+  bool finish();
+
+  // Error message with the byte offset. Valid after a function returned
+  // false.
+  const std::string &error() const { return _err; }
+
+ private:
+  bool fail(const std::string &msg);
+  void skip_whitespace();
+  bool expect(const char *literal);
+  bool scan_string(std::string *s);
+  bool scan_number(double *v);
+  bool enter();
+
+  const char *_begin;
+  const char *_p;
+  const char *_end;
+  int _depth = 0;
+
+  // Key buffer of each nesting level, reused between objects. Held by pointer
+  // so that the keys of outer levels stay in place while inner levels are
+  // added.
+  std::vector<std::unique_ptr<std::string>> _keys;
+
+  std::string _err;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_JSON_READER_H_
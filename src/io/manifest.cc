@@ -0,0 +1,295 @@
+#include "io/manifest.hh"
+#include "crc32c.hh"
+#include "parallel.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace nnview {
+
+namespace {
+
+// Unit of work of the worker threads.
+constexpr uint64_t kChunkSize = 16ull * 1024ull * 1024ull;
+
+struct Chunk {
+  size_t file = 0;  // index to files
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  const uint8_t *data = nullptr;  // nullptr = read from the file
+  uint32_t crc = 0;
+  bool ok = false;
+};
+
+}  // namespace
+
+static std::string NormalizePath(const std::string &path) {
+  std::string s = path;
+  for (auto &c : s) {
+    if (c == '\\') {
+      c = '/';
+    }
+  }
+  while (s.compare(0, 2, "./") == 0) {
+    s.erase(0, 2);
+  }
+  return s;
+}
+
+static bool GetFileSize(const std::string &filepath, uint64_t *size) {
+  std::ifstream ifs(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!ifs) {
+    return false;
+  }
+  const std::streamoff end = ifs.tellg();
+  if (end < 0) {
+    return false;
+  }
+  (*size) = uint64_t(end);
+  return true;
+}
+
+static void AddChunks(size_t file, uint64_t offset, uint64_t size,
+                      const uint8_t *data, std::vector<Chunk> *chunks) {
+  for (uint64_t pos = 0; pos < size; pos += kChunkSize) {
+    Chunk chunk;
+    chunk.file = file;
+    chunk.offset = offset + pos;
+    chunk.size = std::min(kChunkSize, size - pos);
+    chunk.data = data ? (data + pos) : nullptr;
+    chunks->push_back(chunk);
+  }
+}
+
+static bool ReadChunk(const std::string &filepath, const Chunk &chunk,
+                      std::vector<uint8_t> *buf) {
+  std::ifstream ifs(filepath, std::ios::in | std::ios::binary);
+  if (!ifs) {
+    return false;
+  }
+  buf->resize(size_t(chunk.size));
+  ifs.seekg(std::streamoff(chunk.offset));
+  ifs.read(reinterpret_cast<char *>(buf->data()),
+           std::streamsize(chunk.size));
+  return bool(ifs);
+}
+
+// Compute the CRC32C of each file whose size is `sizes[i]`. Files with
+// `crcs_valid[i]` = 0 on return could not be read.
+static void ComputeCrcs(const std::vector<ManifestFile> &files,
+                        const std::vector<uint64_t> &sizes, int num_threads,
+                        std::vector<uint32_t> *crcs,
+                        std::vector<char> *crcs_valid) {
+  std::vector<Chunk> chunks;
+  for (size_t i = 0; i < files.size(); i++) {
+    const Tensor *tensor = files[i].tensor;
+    const uint8_t *payload = tensor ? tensor->raw_data() : nullptr;
+    if (tensor && tensor->loaded && payload &&
+        (tensor->source_offset <= sizes[i]) &&
+        (tensor->byte_size() <= sizes[i] - tensor->source_offset)) {
+      // Only the header and trailing bytes(if any) are read from the file.
+      const uint64_t payload_end = tensor->source_offset + tensor->byte_size();
+      AddChunks(i, 0, tensor->source_offset, nullptr, &chunks);
+      AddChunks(i, tensor->source_offset, tensor->byte_size(), payload,
+                &chunks);
+      AddChunks(i, payload_end, sizes[i] - payload_end, nullptr, &chunks);
+    } else {
+      AddChunks(i, 0, sizes[i], nullptr, &chunks);
+    }
+  }
+
+  parallel_for(chunks.size(), num_threads, [&](size_t k) {
+    Chunk &chunk = chunks[k];
+    if (chunk.data) {
+      chunk.crc = crc32c(chunk.data, size_t(chunk.size));
+      chunk.ok = true;
+      return;
+    }
+
+    std::vector<uint8_t> buf;
+    if (ReadChunk(files[chunk.file].filepath, chunk, &buf)) {
+      chunk.crc = crc32c(buf.data(), buf.size());
+      chunk.ok = true;
+    }
+  });
+
+  // Chunks are stored in file order.
+  crcs->assign(files.size(), 0);
+  crcs_valid->assign(files.size(), 1);
+  for (const Chunk &chunk : chunks) {
+    (*crcs)[chunk.file] =
+        crc32c_combine((*crcs)[chunk.file], chunk.crc, chunk.size);
+    if (!chunk.ok) {
+      (*crcs_valid)[chunk.file] = 0;
+    }
+  }
+}
+
+static std::string ToHex(uint32_t v) {
+  std::ostringstream ss;
+  ss << std::hex << std::setw(8) << std::setfill('0') << v;
+  return ss.str();
+}
+
+bool Manifest::load(const std::string &filename) {
+  std::ifstream ifs(filename);
+  if (!ifs) {
+    std::cerr << "Failed to open manifest : " << filename << "\n";
+    return false;
+  }
+
+  _filename = filename;
+  _entries.clear();
+
+  std::string line;
+  size_t lineno = 0;
+  while (std::getline(ifs, line)) {
+    lineno++;
+    if (!line.empty() && (line.back() == '\r')) {
+      line.pop_back();
+    }
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+
+    std::istringstream ss(line);
+    std::string crc_str;
+    uint64_t size = 0;
+    std::string path;
+    ss >> crc_str >> size;
+    std::getline(ss >> std::ws, path);
+
+    char *end = nullptr;
+    const unsigned long crc = std::strtoul(crc_str.c_str(), &end, 16);
+    if (!ss.eof() || (crc_str.size() != 8) || (*end != '\0') ||
+        path.empty()) {
+      std::cerr << "Invalid manifest line " << lineno << " : " << filename
+                << "\n";
+      return false;
+    }
+
+    ManifestEntry entry;
+    entry.size = size;
+    entry.crc32c = uint32_t(crc);
+    _entries[NormalizePath(path)] = entry;
+  }
+
+  return true;
+}
+
+const ManifestEntry *Manifest::find(const std::string &path) const {
+  auto it = _entries.find(NormalizePath(path));
+  return (it == _entries.end()) ? nullptr : &it->second;
+}
+
+bool verify_manifest(const Manifest &manifest,
+                     const std::vector<ManifestFile> &files,
+                     int num_threads) {
+  auto start_time = std::chrono::steady_clock::now();
+
+  bool ok = true;
+
+  // Check the existence and size first. Files failing here are not read.
+  std::vector<ManifestFile> targets;
+  std::vector<const ManifestEntry *> entries;
+  std::vector<uint64_t> sizes;
+  uint64_t total_bytes = 0;
+  for (const auto &file : files) {
+    const ManifestEntry *entry = manifest.find(file.path);
+    if (!entry) {
+      std::cerr << file.path << " is not listed in the manifest "
+                << manifest.filename() << "\n";
+      ok = false;
+      continue;
+    }
+
+    uint64_t size = 0;
+    if (!GetFileSize(file.filepath, &size)) {
+      std::cerr << "Failed to open file : " << file.filepath << "\n";
+      ok = false;
+      continue;
+    }
+    if (size != entry->size) {
+      std::cerr << "File size mismatch(truncated or replaced?) : "
+                << file.filepath << ". expected " << entry->size
+                << " bytes but got " << size << " bytes\n";
+      ok = false;
+      continue;
+    }
+
+    targets.push_back(file);
+    entries.push_back(entry);
+    sizes.push_back(size);
+    total_bytes += size;
+  }
+
+  std::vector<uint32_t> crcs;
+  std::vector<char> crcs_valid;
+  ComputeCrcs(targets, sizes, num_threads, &crcs, &crcs_valid);
+
+  for (size_t i = 0; i < targets.size(); i++) {
+    if (!crcs_valid[i]) {
+      std::cerr << "Failed to read file : " << targets[i].filepath << "\n";
+      ok = false;
+    } else if (crcs[i] != entries[i]->crc32c) {
+      std::cerr << "CRC32C mismatch(corrupted?) : " << targets[i].filepath
+                << ". expected " << ToHex(entries[i]->crc32c) << " but got "
+                << ToHex(crcs[i]) << "\n";
+      ok = false;
+    }
+  }
+
+  auto end_time = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed = end_time - start_time;
+  std::cout << "Verified " << targets.size() << " files("
+            << double(total_bytes) / (1024.0 * 1024.0) << " MB) in "
+            << elapsed.count() << " secs\n";
+
+  return ok;
+}
+
+bool write_manifest(const std::string &filename,
+                    const std::vector<ManifestFile> &files,
+                    int num_threads) {
+  std::vector<uint64_t> sizes(files.size(), 0);
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!GetFileSize(files[i].filepath, &sizes[i])) {
+      std::cerr << "Failed to open file : " << files[i].filepath << "\n";
+      return false;
+    }
+  }
+
+  std::vector<uint32_t> crcs;
+  std::vector<char> crcs_valid;
+  ComputeCrcs(files, sizes, num_threads, &crcs, &crcs_valid);
+
+  std::ofstream ofs(filename);
+  if (!ofs) {
+    std::cerr << "Failed to open manifest for writing : " << filename << "\n";
+    return false;
+  }
+
+  ofs << "# crc32c size path\n";
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!crcs_valid[i]) {
+      std::cerr << "Failed to read file : " << files[i].filepath << "\n";
+      return false;
+    }
+    ofs << ToHex(crcs[i]) << " " << sizes[i] << " "
+        << NormalizePath(files[i].path) << "\n";
+  }
+
+  if (!ofs) {
+    std::cerr << "Failed to write manifest : " << filename << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace nnview
@@ -0,0 +1,72 @@
+#ifndef NNVIEW_IO_MANIFEST_H_
+#define NNVIEW_IO_MANIFEST_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "datatypes.h"
+
+//
+// Manifest of weight/tensor files for integrity verification.
+//
+// A manifest is a text file with one line per file:
+//
+//   <CRC32C(8 hex digits)> <size in bytes> <path>
+//
+// e.g. `1a2b3c4d 313632 LinearFunction-0-1_kernel.weights`. `path` is relative
+// to the directory of the JSON graph. Empty lines and lines starting with '#'
+// are ignored.
+//
+// Files are split into chunks which are checked by worker threads, so a
+// single multi-GB file is verified in parallel as well. The payload of a
+// loaded tensor is checked from memory, so verification reads only the
+// header of the file again.
+//
+namespace nnview {
+
+struct ManifestEntry {
+  uint64_t size = 0;
+  uint32_t crc32c = 0;
+};
+
+class Manifest {
+ public:
+  bool load(const std::string &filename);
+
+  // Returns nullptr when `path` is not listed.
+  const ManifestEntry *find(const std::string &path) const;
+
+  const std::string &filename() const { return _filename; }
+
+ private:
+  std::string _filename;
+  std::map<std::string, ManifestEntry> _entries;
+};
+
+// A file to verify or to list in a manifest.
+struct ManifestFile {
+  std::string path;      // Path in the manifest.
+  std::string filepath;  // Path to open.
+
+  // Tensor loaded from the file, or nullptr. Its payload is used instead of
+  // reading the file when loaded.
+  const Tensor *tensor = nullptr;
+};
+
+// Verify the size and CRC32C of `files`. All files are checked and each
+// mismatch is reported. Returns false when any file is missing from the
+// manifest or does not match.
+bool verify_manifest(const Manifest &manifest,
+                     const std::vector<ManifestFile> &files,
+                     int num_threads = 0);
+
+// Write a manifest listing `files`.
+bool write_manifest(const std::string &filename,
+                    const std::vector<ManifestFile> &files,
+                    int num_threads = 0);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_MANIFEST_H_
@@ -0,0 +1,119 @@
+#include "io/mapped-file.hh"
+
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nnview {
+
+MappedFile::~MappedFile() { close(); }
+
+void MappedFile::close() {
+#if defined(_WIN32)
+  if (_data) {
+    UnmapViewOfFile(_data);
+  }
+  if (_mapping_handle) {
+    CloseHandle(_mapping_handle);
+  }
+  if (_file_handle) {
+    CloseHandle(_file_handle);
+  }
+  _mapping_handle = nullptr;
+  _file_handle = nullptr;
+#else
+  if (_data && (_size > 0)) {
+    munmap(const_cast<uint8_t *>(_data), _size);
+  }
+  if (_fd != -1) {
+    ::close(_fd);
+  }
+  _fd = -1;
+#endif
+  _data = nullptr;
+  _size = 0;
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &filename) {
+  std::shared_ptr<MappedFile> mf = std::make_shared<MappedFile>();
+  mf->_filename = filename;
+
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cerr << "Failed to open file : " << filename << std::endl;
+    return nullptr;
+  }
+  mf->_file_handle = file;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    std::cerr << "Failed to get file size : " << filename << std::endl;
+    return nullptr;
+  }
+  mf->_size = size_t(file_size.QuadPart);
+
+  if (mf->_size == 0) {
+    // Nothing to map.
+    return mf;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    std::cerr << "Failed to create file mapping : " << filename << std::endl;
+    return nullptr;
+  }
+  mf->_mapping_handle = mapping;
+
+  void *p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (p == nullptr) {
+    std::cerr << "Failed to map file : " << filename << std::endl;
+    return nullptr;
+  }
+  mf->_data = reinterpret_cast<const uint8_t *>(p);
+#else
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    std::cerr << "Failed to open file : " << filename << std::endl;
+    return nullptr;
+  }
+  mf->_fd = fd;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    std::cerr << "Failed to stat file : " << filename << std::endl;
+    return nullptr;
+  }
+  mf->_size = size_t(st.st_size);
+
+  if (mf->_size == 0) {
+    // mmap with zero length fails, so return an empty mapping.
+    return mf;
+  }
+
+  void *p = mmap(nullptr, mf->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) {
+    std::cerr << "Failed to mmap file : " << filename << std::endl;
+    mf->_size = 0;
+    return nullptr;
+  }
+  mf->_data = reinterpret_cast<const uint8_t *>(p);
+#endif
+
+  return mf;
+}
+
+}  // namespace nnview
@@ -0,0 +1,48 @@
+#ifndef NNVIEW_IO_MAPPED_FILE_H_
+#define NNVIEW_IO_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//
+// Read-only memory mapped file.
+// Pages are faulted in by the OS on first access, so mapping a huge file
+// costs almost nothing until its content is actually touched.
+//
+namespace nnview {
+
+class MappedFile {
+ public:
+  MappedFile() {}
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Returns nullptr when the file cannot be opened or mapped.
+  static std::shared_ptr<MappedFile> open(const std::string &filename);
+
+  const uint8_t *data() const { return _data; }
+  size_t size() const { return _size; }
+  const std::string &filename() const { return _filename; }
+
+ private:
+  void close();
+
+  std::string _filename;
+  const uint8_t *_data = nullptr;
+  size_t _size = 0;
+
+#if defined(_WIN32)
+  void *_file_handle = nullptr;
+  void *_mapping_handle = nullptr;
+#else
+  int _fd = -1;
+#endif
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_MAPPED_FILE_H_
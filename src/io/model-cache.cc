@@ -0,0 +1,549 @@
+#include "io/model-cache.hh"
+#include "compressed-storage.hh"
+#include "io/mapped-file.hh"
+#include "sparse-storage.hh"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+
+namespace nnview {
+
+namespace {
+
+constexpr char kCacheMagic[8] = {'N', 'N', 'V', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t kCacheVersion = 2;
+constexpr size_t kCacheHeaderSize = 64;
+constexpr uint64_t kPayloadAlignment = 64;
+
+inline uint64_t AlignUp(uint64_t x) {
+  return (x + kPayloadAlignment - 1) & ~(kPayloadAlignment - 1);
+}
+
+class CacheWriter {
+ public:
+  void u8(uint8_t v) { _buf.push_back(v); }
+  void u32(uint32_t v) { put(&v, sizeof(v)); }
+  void i32(int32_t v) { put(&v, sizeof(v)); }
+  void u64(uint64_t v) { put(&v, sizeof(v)); }
+  void i64(int64_t v) { put(&v, sizeof(v)); }
+  void string(const std::string &s) {
+    u32(uint32_t(s.size()));
+    put(s.data(), s.size());
+  }
+
+  // Overwrite a u64 value written at `pos`.
+  void patch_u64(size_t pos, uint64_t v) { memcpy(&_buf[pos], &v, sizeof(v)); }
+
+  size_t size() const { return _buf.size(); }
+  const std::vector<uint8_t> &buffer() const { return _buf; }
+
+ private:
+  void put(const void *p, size_t n) {
+    const uint8_t *s = static_cast<const uint8_t *>(p);
+    _buf.insert(_buf.end(), s, s + n);
+  }
+
+  std::vector<uint8_t> _buf;
+};
+
+//
+// Bounds checked reader of the index. Once a read fails, all subsequent reads
+// fail.
+//
+class CacheReader {
+ public:
+  CacheReader(const uint8_t *begin, const uint8_t *end)
+      : _p(begin), _end(end) {}
+
+  bool valid() const { return _valid; }
+
+  uint8_t u8() {
+    uint8_t v = 0;
+    get(&v, sizeof(v));
+    return v;
+  }
+  uint32_t u32() {
+    uint32_t v = 0;
+    get(&v, sizeof(v));
+    return v;
+  }
+  int32_t i32() {
+    int32_t v = 0;
+    get(&v, sizeof(v));
+    return v;
+  }
+  uint64_t u64() {
+    uint64_t v = 0;
+    get(&v, sizeof(v));
+    return v;
+  }
+  int64_t i64() {
+    int64_t v = 0;
+    get(&v, sizeof(v));
+    return v;
+  }
+  std::string string() {
+    const uint32_t n = u32();
+    if (!_valid || (size_t(_end - _p) < n)) {
+      _valid = false;
+      return std::string();
+    }
+    std::string s(reinterpret_cast<const char *>(_p), n);
+    _p += n;
+    return s;
+  }
+
+  // Count of the following items. Each item takes at least `min_item_size`
+  // bytes, which bounds the count for broken files.
+  uint32_t count(size_t min_item_size) {
+    const uint32_t n = u32();
+    if (!_valid || (size_t(_end - _p) / min_item_size < n)) {
+      _valid = false;
+      return 0;
+    }
+    return n;
+  }
+
+ private:
+  void get(void *dst, size_t n) {
+    if (!_valid || (size_t(_end - _p) < n)) {
+      _valid = false;
+      return;
+    }
+    memcpy(dst, _p, n);
+    _p += n;
+  }
+
+  const uint8_t *_p;
+  const uint8_t *_end;
+  bool _valid = true;
+};
+
+}  // namespace
+
+static bool GetFileStat(const std::string &filename, uint64_t *size,
+                        int64_t *mtime) {
+#if defined(_WIN32)
+  struct _stat64 st;
+  if (_stat64(filename.c_str(), &st) != 0) {
+    return false;
+  }
+#else
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    return false;
+  }
+#endif
+
+  (*size) = uint64_t(st.st_size);
+  (*mtime) = int64_t(st.st_mtime);
+
+  return true;
+}
+
+// Whether the payload of `tensor` is available(loaded or can be loaded).
+static bool HasPayload(const Tensor &tensor) {
+  if (tensor.loaded) {
+    return (tensor.compressed || tensor.sparse || tensor.raw_data()) &&
+           (tensor.byte_size() > 0);
+  }
+  return !tensor.source_filename.empty();
+}
+
+// Whether `num_items` matches the product of `shape` and its byte size fits
+// in size_t. A tensor without payload may have no items(e.g. its shape
+// overflowed in the loader).
+static bool IsValidTensorSize(const std::vector<int> &shape, size_t num_items,
+                              DataType dtype, bool has_data) {
+  if (!has_data && (num_items == 0)) {
+    return true;
+  }
+
+  uint64_t product = 1;
+  for (const int d : shape) {
+    if (d < 0) {
+      return false;
+    }
+    if ((d > 0) &&
+        (product > std::numeric_limits<uint64_t>::max() / uint64_t(d))) {
+      return false;
+    }
+    product *= uint64_t(d);
+  }
+
+  return (uint64_t(num_items) == product) &&
+         (num_items <= std::numeric_limits<size_t>::max() /
+                           get_dtype_size(dtype));
+}
+
+static void WriteSymbols(const SymbolTable &symbols, CacheWriter *w) {
+  w->u32(uint32_t(symbols.size()));
+  for (size_t i = 0; i < symbols.size(); i++) {
+    w->string(symbols.str(Symbol(i)));
+  }
+}
+
+static void ReadSymbols(CacheReader *r, SymbolTable *symbols) {
+  // length(4)
+  const uint32_t n = r->count(4);
+  symbols->clear();
+  for (uint32_t i = 0; i < n; i++) {
+    symbols->intern(r->string());
+  }
+}
+
+static void WriteSlots(const std::vector<Slot> &slots, CacheWriter *w) {
+  w->u32(uint32_t(slots.size()));
+  for (const auto &slot : slots) {
+    w->u32(slot.name);
+    w->u32(slot.slot_name);
+    w->i32(slot.id);
+  }
+}
+
+static void ReadSlots(CacheReader *r, std::vector<Slot> *slots) {
+  // name(4) + slot_name(4) + id(4)
+  const uint32_t n = r->count(12);
+  slots->clear();
+  for (uint32_t i = 0; i < n; i++) {
+    const Symbol name = r->u32();
+    const Symbol slot_name = r->u32();
+    const int32_t id = r->i32();
+    slots->emplace_back(name, slot_name, id);
+  }
+}
+
+static bool ValidateSlotIds(const Graph &graph) {
+  const int num_tensors = int(graph.tensors.size());
+  const size_t num_symbols = graph.symbols.size();
+  auto valid = [num_tensors, num_symbols](const std::vector<Slot> &slots) {
+    for (const auto &slot : slots) {
+      if ((slot.id < -1) || (slot.id >= num_tensors) ||
+          (slot.name >= num_symbols) || (slot.slot_name >= num_symbols)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  if (!valid(graph.inputs) || !valid(graph.outputs)) {
+    return false;
+  }
+  for (const auto &node : graph.nodes) {
+    if (!valid(node.inputs) || !valid(node.outputs)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::string get_model_cache_filename(const std::string &model_filename) {
+  return model_filename + ".nnvcache";
+}
+
+bool write_model_cache(const std::string &cache_filename,
+                       const std::string &model_filename, const Graph &graph,
+                       const WeightsLoadOption &option) {
+  // The model file and all files the payloads come from.
+  std::set<std::string> dependencies;
+  dependencies.insert(model_filename);
+  for (const auto &tensor : graph.tensors) {
+    if (!tensor.source_filename.empty()) {
+      dependencies.insert(tensor.source_filename);
+    }
+  }
+
+  CacheWriter w;
+
+  w.u32(uint32_t(dependencies.size()));
+  for (const auto &dep : dependencies) {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (!GetFileStat(dep, &size, &mtime)) {
+      std::cerr << "Failed to stat file : " << dep << std::endl;
+      return false;
+    }
+    w.string(dep);
+    w.u64(size);
+    w.i64(mtime);
+  }
+
+  WriteSymbols(graph.symbols, &w);
+  WriteSlots(graph.inputs, &w);
+  WriteSlots(graph.outputs, &w);
+
+  w.u32(uint32_t(graph.nodes.size()));
+  for (const auto &node : graph.nodes) {
+    w.i32(int32_t(node.type));
+    w.i32(node.id);
+    w.i32(node.depth);
+    w.string(node.name);
+    WriteSlots(node.inputs, &w);
+    WriteSlots(node.outputs, &w);
+  }
+
+  // Payload offsets are patched once the size of the index is known.
+  std::vector<size_t> offset_positions;
+  w.u32(uint32_t(graph.tensors.size()));
+  for (const auto &tensor : graph.tensors) {
+    const bool has_data = HasPayload(tensor);
+    w.string(tensor.name);
+    w.i32(int32_t(tensor.dtype));
+    w.u32(uint32_t(tensor.shape.size()));
+    for (const int d : tensor.shape) {
+      w.i32(d);
+    }
+    w.u64(uint64_t(tensor.num_items));
+    w.u8(has_data ? 1 : 0);
+    offset_positions.push_back(w.size());
+    w.u64(0);
+  }
+
+  uint64_t offset = AlignUp(kCacheHeaderSize + w.size());
+  for (size_t i = 0; i < graph.tensors.size(); i++) {
+    const Tensor &tensor = graph.tensors[i];
+    if (HasPayload(tensor)) {
+      w.patch_u64(offset_positions[i], offset);
+      offset = AlignUp(offset + tensor.byte_size());
+    }
+  }
+
+  // Write to a temporary file and rename it, so that an interrupted write
+  // never leaves a broken cache.
+  const std::string tmp_filename = cache_filename + ".tmp";
+  std::ofstream ofs(tmp_filename, std::ios::out | std::ios::binary);
+  if (!ofs) {
+    std::cerr << "Failed to open file for writing : " << tmp_filename
+              << std::endl;
+    return false;
+  }
+
+  uint8_t header[kCacheHeaderSize] = {};
+  memcpy(header, kCacheMagic, sizeof(kCacheMagic));
+  const uint64_t index_size = w.size();
+  memcpy(header + 8, &kCacheVersion, sizeof(kCacheVersion));
+  memcpy(header + 16, &index_size, sizeof(index_size));
+  ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+  ofs.write(reinterpret_cast<const char *>(w.buffer().data()),
+            std::streamsize(w.size()));
+
+  const char zeros[kPayloadAlignment] = {};
+  uint64_t pos = kCacheHeaderSize + w.size();
+  bool ok = bool(ofs);
+
+  for (size_t i = 0; ok && (i < graph.tensors.size()); i++) {
+    const Tensor &tensor = graph.tensors[i];
+    if (!HasPayload(tensor)) {
+      continue;
+    }
+
+    const Tensor *src = &tensor;
+    Tensor tmp;
+    if (!tensor.loaded) {
+      // Read the payload of a lazily loaded tensor only while writing it.
+      tmp = tensor;
+      if (!load_tensor_payload(&tmp, option)) {
+        ok = false;
+        break;
+      }
+      src = &tmp;
+    } else if (tensor.compressed) {
+      tmp.data.resize(tensor.byte_size());
+      if (!tensor.compressed->read(0, tmp.data.size(), tmp.data.data())) {
+        ok = false;
+        break;
+      }
+      tmp.dtype = tensor.dtype;
+      tmp.num_items = tensor.num_items;
+      src = &tmp;
+    } else if (tensor.sparse) {
+      // The cache stores dense payloads.
+      tmp.data.resize(tensor.byte_size());
+      tensor.sparse->to_dense(tmp.data.data());
+      tmp.dtype = tensor.dtype;
+      tmp.num_items = tensor.num_items;
+      src = &tmp;
+    }
+
+    const uint64_t aligned = AlignUp(pos);
+    ofs.write(zeros, std::streamsize(aligned - pos));
+    ofs.write(reinterpret_cast<const char *>(src->raw_data()),
+              std::streamsize(src->byte_size()));
+    pos = aligned + src->byte_size();
+    ok = bool(ofs);
+  }
+
+  ofs.close();
+
+  if (!ok || !ofs) {
+    std::cerr << "Failed to write model cache : " << cache_filename
+              << std::endl;
+    std::remove(tmp_filename.c_str());
+    return false;
+  }
+
+#if defined(_WIN32)
+  // `rename` does not overwrite an existing file on Windows.
+  std::remove(cache_filename.c_str());
+#endif
+  if (std::rename(tmp_filename.c_str(), cache_filename.c_str()) != 0) {
+    std::cerr << "Failed to rename " << tmp_filename << " to "
+              << cache_filename << std::endl;
+    std::remove(tmp_filename.c_str());
+    return false;
+  }
+
+  std::cout << "Wrote model cache : " << cache_filename << "\n";
+
+  return true;
+}
+
+bool load_model_cache(const std::string &cache_filename, Graph *graph) {
+  {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (!GetFileStat(cache_filename, &size, &mtime)) {
+      // No cache.
+      return false;
+    }
+  }
+
+  std::shared_ptr<MappedFile> mapping = MappedFile::open(cache_filename);
+  if (!mapping) {
+    return false;
+  }
+
+  const uint8_t *data = mapping->data();
+  const size_t size = mapping->size();
+
+  uint32_t version = 0;
+  uint64_t index_size = 0;
+  if ((size < kCacheHeaderSize) ||
+      (memcmp(data, kCacheMagic, sizeof(kCacheMagic)) != 0)) {
+    std::cerr << "Not a nnview model cache : " << cache_filename << std::endl;
+    return false;
+  }
+  memcpy(&version, data + 8, sizeof(version));
+  memcpy(&index_size, data + 16, sizeof(index_size));
+  if (version != kCacheVersion) {
+    std::cout << "Model cache version mismatch. Ignore " << cache_filename
+              << "\n";
+    return false;
+  }
+  if (index_size > size - kCacheHeaderSize) {
+    std::cerr << "Model cache is truncated : " << cache_filename << std::endl;
+    return false;
+  }
+
+  CacheReader r(data + kCacheHeaderSize,
+                data + kCacheHeaderSize + size_t(index_size));
+
+  // path length(4) + size(8) + mtime(8)
+  const uint32_t num_dependencies = r.count(20);
+  for (uint32_t i = 0; i < num_dependencies; i++) {
+    const std::string dep = r.string();
+    const uint64_t recorded_size = r.u64();
+    const int64_t recorded_mtime = r.i64();
+    if (!r.valid()) {
+      break;
+    }
+
+    uint64_t dep_size = 0;
+    int64_t dep_mtime = 0;
+    if (!GetFileStat(dep, &dep_size, &dep_mtime) ||
+        (dep_size != recorded_size) || (dep_mtime != recorded_mtime)) {
+      std::cout << "Model cache is stale(" << dep << " is modified).\n";
+      return false;
+    }
+  }
+
+  Graph g;
+  ReadSymbols(&r, &g.symbols);
+  ReadSlots(&r, &g.inputs);
+  ReadSlots(&r, &g.outputs);
+
+  // type(4) + id(4) + depth(4) + name length(4) + 2 slot counts(8)
+  const uint32_t num_nodes = r.count(24);
+  g.nodes.resize(num_nodes);
+  for (auto &node : g.nodes) {
+    const int32_t type = r.i32();
+    if ((type < 0) || (type > int32_t(LAYER_UNKNOWN))) {
+      node.type = LAYER_UNKNOWN;
+    } else {
+      node.type = LayerType(type);
+    }
+    node.id = r.i32();
+    node.depth = r.i32();
+    node.name = r.string();
+    ReadSlots(&r, &node.inputs);
+    ReadSlots(&r, &node.outputs);
+  }
+
+  // name length(4) + dtype(4) + rank(4) + num_items(8) + has_data(1) +
+  // offset(8)
+  const uint32_t num_tensors = r.count(29);
+  g.tensors.resize(num_tensors);
+  for (auto &tensor : g.tensors) {
+    tensor.name = r.string();
+    const int32_t dtype = r.i32();
+    const uint32_t rank = r.count(4);
+    for (uint32_t k = 0; k < rank; k++) {
+      tensor.shape.push_back(r.i32());
+    }
+    tensor.num_items = size_t(r.u64());
+    const bool has_data = (r.u8() != 0);
+    const uint64_t offset = r.u64();
+    if (!r.valid()) {
+      break;
+    }
+
+    if ((dtype < 0) || (dtype > int32_t(DTYPE_INT32)) ||
+        (tensor.shape.size() < 2) ||
+        !IsValidTensorSize(tensor.shape, tensor.num_items, DataType(dtype),
+                           has_data)) {
+      std::cerr << "Invalid tensor `" << tensor.name
+                << "` in model cache : " << cache_filename << std::endl;
+      return false;
+    }
+    tensor.dtype = DataType(dtype);
+
+    if (!has_data) {
+      tensor.loaded = false;
+      continue;
+    }
+
+    if ((offset > size) || (size - offset < tensor.byte_size())) {
+      std::cerr << "Model cache is truncated : " << cache_filename
+                << std::endl;
+      return false;
+    }
+
+    tensor.source_filename = cache_filename;
+    tensor.source_offset = offset;
+    tensor.mapping = mapping;
+    tensor.mapped_data = data + size_t(offset);
+    tensor.loaded = true;
+  }
+
+  if (!r.valid() || !ValidateSlotIds(g)) {
+    std::cerr << "Failed to parse model cache : " << cache_filename
+              << std::endl;
+    return false;
+  }
+
+  (*graph) = std::move(g);
+
+  std::cout << "Loaded model cache : " << cache_filename << "\n";
+
+  return true;
+}
+
+}  // namespace nnview
@@ -0,0 +1,47 @@
+#ifndef NNVIEW_IO_MODEL_CACHE_H_
+#define NNVIEW_IO_MODEL_CACHE_H_
+
+#include <string>
+
+#include "datatypes.h"
+#include "io/weights-loader.hh"
+
+//
+// Packed single-file cache of a loaded model.
+//
+// Loading a chainer-trt model parses JSON and opens dozens of weight/tensor
+// files. The cache stores the whole `Graph`(nodes, slots, shapes) and all
+// tensor payloads in one file, so reopening the model only maps the cache.
+//
+// format is:
+//
+// header(64 bytes) : magic("NNVCACHE"), version, index size
+// index            : dependency files(path, size, mtime), symbols, inputs,
+//                    outputs, nodes and tensors(name, dtype, shape, payload
+//                    offset)
+// payloads         : tensor payloads. Each payload is 64-byte aligned.
+//
+// The cache is written in the host byte order and is not meant to be shared
+// between machines.
+//
+namespace nnview {
+
+// Cache filename for the model file. e.g. `models/mnist/model.json.nnvcache`
+std::string get_model_cache_filename(const std::string &model_filename);
+
+// Write `graph` loaded from `model_filename` to `cache_filename`.
+// Tensors which are not loaded yet are read with `load_tensor_payload`.
+// The size and mtime of the model file and all weight/tensor files are
+// recorded to detect stale cache.
+bool write_model_cache(const std::string &cache_filename,
+                       const std::string &model_filename, const Graph &graph,
+                       const WeightsLoadOption &option = WeightsLoadOption());
+
+// Load `graph` from the cache. Tensors refer to the payloads in the mapped
+// cache file. Returns false without printing an error when the cache does not
+// exist or is stale(any recorded file has been modified).
+bool load_model_cache(const std::string &cache_filename, Graph *graph);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_MODEL_CACHE_H_
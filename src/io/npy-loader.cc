@@ -0,0 +1,449 @@
+#include "io/npy-loader.hh"
+#include "io/archive.hh"
+#include "parallel.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace nnview {
+
+namespace {
+
+// magic(6) + major(1) + minor(1) + header_len(2 or 4)
+constexpr size_t kNpyPreambleSize = 12;
+
+struct NpyHeader {
+  std::string descr;
+  DataType dtype = DTYPE_FLOAT32;
+  bool fortran_order = false;
+  std::vector<int> shape;
+  size_t num_items = 1;
+  size_t header_size = 0;  // Byte offset of the array data.
+};
+
+inline uint16_t ReadU16(const uint8_t *p) {
+  return uint16_t(p[0] | (p[1] << 8));
+}
+
+inline uint32_t ReadU32(const uint8_t *p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+         (uint32_t(p[3]) << 24);
+}
+
+}  // namespace
+
+// Get the total size of NPY header(= offset to the array data) from the
+// preamble. `len` must be at least `kNpyPreambleSize`.
+static bool GetNpyHeaderSize(const uint8_t *p, size_t len, size_t *header_size,
+                             std::string *err) {
+  if ((len < kNpyPreambleSize) || (memcmp(p, "\x93NUMPY", 6) != 0)) {
+    (*err) = "Not a NPY data(magic number mismatch).";
+    return false;
+  }
+
+  const uint8_t major = p[6];
+  if (major == 1) {
+    (*header_size) = 10 + size_t(ReadU16(p + 8));
+  } else if ((major == 2) || (major == 3)) {
+    (*header_size) = 12 + size_t(ReadU32(p + 8));
+  } else {
+    (*err) = "Unsupported NPY version " + std::to_string(int(major)) + ".";
+    return false;
+  }
+
+  if ((*header_size) < kNpyPreambleSize) {
+    (*err) = "Invalid NPY header length.";
+    return false;
+  }
+
+  return true;
+}
+
+// Find the value of `key` in the python dict literal.
+// Returns the position just after ':'.
+static size_t FindDictValue(const std::string &dict, const std::string &key) {
+  size_t pos = dict.find("'" + key + "'");
+  if (pos == std::string::npos) {
+    pos = dict.find("\"" + key + "\"");
+    if (pos == std::string::npos) {
+      return std::string::npos;
+    }
+  }
+
+  pos = dict.find(':', pos + key.size() + 2);
+  if (pos == std::string::npos) {
+    return std::string::npos;
+  }
+
+  pos++;
+  while ((pos < dict.size()) && (dict[pos] == ' ')) {
+    pos++;
+  }
+
+  return pos;
+}
+
+// Parse whole NPY header. e.g.
+// {'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }
+static bool ParseNpyHeader(const uint8_t *p, size_t len, NpyHeader *header,
+                           std::string *err) {
+  size_t header_size = 0;
+  if (!GetNpyHeaderSize(p, len, &header_size, err)) {
+    return false;
+  }
+
+  if (len < header_size) {
+    (*err) = "NPY header is truncated.";
+    return false;
+  }
+
+  const size_t dict_offset = (p[6] == 1) ? 10 : 12;
+  const std::string dict(reinterpret_cast<const char *>(p + dict_offset),
+                         header_size - dict_offset);
+
+  size_t pos = FindDictValue(dict, "descr");
+  if ((pos == std::string::npos) || (pos >= dict.size())) {
+    (*err) = "`descr` not found in NPY header.";
+    return false;
+  }
+  {
+    const char quote = dict[pos];
+    size_t end = dict.find(quote, pos + 1);
+    if (((quote != '\'') && (quote != '"')) || (end == std::string::npos)) {
+      (*err) = "Unsupported `descr` in NPY header : " + dict;
+      return false;
+    }
+    header->descr = dict.substr(pos + 1, end - pos - 1);
+  }
+
+  pos = FindDictValue(dict, "fortran_order");
+  if (pos == std::string::npos) {
+    (*err) = "`fortran_order` not found in NPY header.";
+    return false;
+  }
+  header->fortran_order = (dict.compare(pos, 4, "True") == 0);
+
+  pos = FindDictValue(dict, "shape");
+  if ((pos == std::string::npos) || (pos >= dict.size()) ||
+      (dict[pos] != '(')) {
+    (*err) = "`shape` not found in NPY header.";
+    return false;
+  }
+
+  header->shape.clear();
+  header->num_items = 1;
+
+  const char *s = dict.c_str() + pos + 1;
+  for (;;) {
+    while ((*s == ' ') || (*s == ',')) {
+      s++;
+    }
+    if (*s == ')') {
+      break;
+    }
+
+    char *end = nullptr;
+    long long d = std::strtoll(s, &end, 10);
+    if (end == s) {
+      (*err) = "Failed to parse `shape` in NPY header : " + dict;
+      return false;
+    }
+    if ((d <= 0) || (d > INT_MAX)) {
+      (*err) = "Unsupported dimension " + std::to_string(d) +
+               " in NPY shape.";
+      return false;
+    }
+    const uint64_t max_items = std::numeric_limits<uint64_t>::max();
+    if (uint64_t(header->num_items) > max_items / uint64_t(d)) {
+      (*err) = "NPY shape is too large.";
+      return false;
+    }
+    header->shape.push_back(int(d));
+    header->num_items *= size_t(d);
+    s = end;
+  }
+
+  // Scalar or 1D array. Force create 2D tensor as done in `load_weights`.
+  while (header->shape.size() < 2) {
+    header->shape.push_back(1);
+  }
+
+  header->header_size = header_size;
+
+  return true;
+}
+
+static bool ValidateNpyHeader(NpyHeader *header, std::string *err) {
+  // '<' = little-endian, '|' = not applicable(1 byte types),
+  // '=' = native(assume little-endian host)
+  const std::string &descr = header->descr;
+  const char order = descr.empty() ? '\0' : descr[0];
+  const std::string type = descr.empty() ? "" : descr.substr(1);
+
+  bool ok = (order == '<') || (order == '=') || (order == '|');
+  if (ok) {
+    if (type.compare("f4") == 0) {
+      header->dtype = DTYPE_FLOAT32;
+    } else if (type.compare("f2") == 0) {
+      header->dtype = DTYPE_FLOAT16;
+    } else if (type.compare("f8") == 0) {
+      header->dtype = DTYPE_FLOAT64;
+    } else if (type.compare("i1") == 0) {
+      header->dtype = DTYPE_INT8;
+    } else if (type.compare("u1") == 0) {
+      header->dtype = DTYPE_UINT8;
+    } else if (type.compare("i4") == 0) {
+      header->dtype = DTYPE_INT32;
+    } else {
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    (*err) = "Unsupported NPY dtype `" + descr +
+             "`. Supported dtypes are little-endian f4, f2, f8, i1, u1 and "
+             "i4.";
+    return false;
+  }
+
+  if (header->fortran_order) {
+    (*err) = "Fortran order NPY array is not supported.";
+    return false;
+  }
+
+  // Total byte size must fit in both int64(file offset) and size_t(memory).
+  const uint64_t max_bytes =
+      std::min(uint64_t(std::numeric_limits<int64_t>::max()),
+               uint64_t(std::numeric_limits<size_t>::max()));
+  if (uint64_t(header->num_items) > max_bytes / get_dtype_size(header->dtype)) {
+    (*err) = "NPY array is too large.";
+    return false;
+  }
+
+  return true;
+}
+
+bool load_npy(const std::string &filename, Tensor *tensor,
+              const WeightsLoadOption &option) {
+  std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+  if (!ifs) {
+    std::cerr << "Failed to open file : " << filename << std::endl;
+    return false;
+  }
+
+  uint8_t preamble[kNpyPreambleSize];
+  ifs.read(reinterpret_cast<char *>(preamble), sizeof(preamble));
+
+  std::string err;
+  size_t header_size = 0;
+  if (!GetNpyHeaderSize(preamble, size_t(ifs.gcount()), &header_size, &err)) {
+    std::cerr << err << " filename : " << filename << std::endl;
+    return false;
+  }
+
+  // Do not trust the header length before allocating for it.
+  ifs.clear();
+  ifs.seekg(0, std::ios::end);
+  const uint64_t file_size = uint64_t(ifs.tellg());
+  if (header_size > file_size) {
+    std::cerr << "NPY header is truncated. filename : " << filename
+              << std::endl;
+    return false;
+  }
+
+  std::vector<uint8_t> buf(header_size);
+  ifs.seekg(0);
+  ifs.read(reinterpret_cast<char *>(buf.data()), std::streamsize(header_size));
+  if (!ifs) {
+    std::cerr << "Failed to read NPY header : " << filename << std::endl;
+    return false;
+  }
+  ifs.close();
+
+  NpyHeader header;
+  if (!ParseNpyHeader(buf.data(), buf.size(), &header, &err) ||
+      !ValidateNpyHeader(&header, &err)) {
+    std::cerr << err << " filename : " << filename << std::endl;
+    return false;
+  }
+
+  // `ValidateNpyHeader` bounds the byte size, so the product does not wrap.
+  const uint64_t payload_size =
+      uint64_t(header.num_items) * get_dtype_size(header.dtype);
+  if ((header.header_size > file_size) ||
+      (payload_size > file_size - header.header_size)) {
+    std::cerr << "NPY payload is truncated. filename : " << filename
+              << std::endl;
+    return false;
+  }
+
+  tensor->shape = header.shape;
+  tensor->name = filename;
+  tensor->dtype = header.dtype;
+  tensor->num_items = header.num_items;
+  tensor->source_filename = filename;
+  tensor->source_offset = uint64_t(header.header_size);
+
+  tensor->data.clear();
+  tensor->mapping.reset();
+  tensor->shared_data.reset();
+  tensor->mapped_data = nullptr;
+  tensor->loaded = false;
+
+  if (option.header_only) {
+    return true;
+  }
+
+  // The payload is a raw array, so the generic path works as is.
+  return load_tensor_payload(tensor, option);
+}
+
+static bool LoadNpyMember(const Archive &archive,
+                          const ArchiveMember &member, Tensor *tensor,
+                          std::string *err) {
+  NpyHeader header;
+
+  const uint8_t *data = archive.data(member);
+  if (data) {
+    // Stored. Zero-copy view into the mapped archive.
+    if (!ParseNpyHeader(data, size_t(member.size), &header, err) ||
+        !ValidateNpyHeader(&header, err)) {
+      return false;
+    }
+  } else {
+    // Inflate the preamble first to know the length of NPY header, then the
+    // whole header.
+    uint8_t preamble[kNpyPreambleSize];
+    size_t header_size = 0;
+    if (!archive.read(member, 0, sizeof(preamble), preamble, err) ||
+        !GetNpyHeaderSize(preamble, sizeof(preamble), &header_size, err)) {
+      return false;
+    }
+    if (header_size > member.size) {
+      (*err) = "NPY header is truncated.";
+      return false;
+    }
+
+    std::vector<uint8_t> header_buf(header_size);
+    if (!archive.read(member, 0, header_size, header_buf.data(), err) ||
+        !ParseNpyHeader(header_buf.data(), header_buf.size(), &header, err) ||
+        !ValidateNpyHeader(&header, err)) {
+      return false;
+    }
+  }
+
+  // `ValidateNpyHeader` bounds the byte size, so the product does not wrap.
+  const size_t payload_size = header.num_items * get_dtype_size(header.dtype);
+  if ((header.header_size > member.size) ||
+      (payload_size > member.size - header.header_size)) {
+    (*err) = "NPY payload is truncated.";
+    return false;
+  }
+
+  tensor->shape = header.shape;
+  tensor->name = member.name;
+  tensor->dtype = header.dtype;
+  tensor->num_items = header.num_items;
+  // Only a payload mapped in place can be read again from the archive.
+  // Inflated(or copied) payloads have no location.
+  tensor->source_filename.clear();
+  tensor->source_offset = 0;
+
+  tensor->data.clear();
+  tensor->mapping.reset();
+  tensor->shared_data.reset();
+  tensor->mapped_data = nullptr;
+
+  if (data && archive.mapping()) {
+    tensor->source_filename = archive.filename();
+    tensor->source_offset = member.offset + header.header_size;
+    tensor->mapped_data = data + header.header_size;
+    tensor->mapping = archive.mapping();
+  } else if (data) {
+    tensor->data.assign(data + header.header_size,
+                        data + header.header_size + payload_size);
+  } else {
+    // Inflate the payload directly into `Tensor::data`.
+    tensor->data.resize(payload_size);
+    if (!archive.read(member, header.header_size, payload_size,
+                      tensor->data.data(), err)) {
+      tensor->data.clear();
+      return false;
+    }
+  }
+  tensor->loaded = true;
+
+  return true;
+}
+
+bool load_npy_from_archive(const Archive &archive, const ArchiveMember &member,
+                           Tensor *tensor) {
+  std::string err;
+  if (!LoadNpyMember(archive, member, tensor, &err)) {
+    std::cerr << err << " member : " << member.name << " in "
+              << archive.filename() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool load_npz(const std::string &filename, std::vector<Tensor> *tensors,
+              const WeightsLoadOption &option, int num_threads) {
+  // Stored members are always served from the mapping, so `use_mmap` and
+  // `header_only` options do not matter here. Deflated members are always
+  // decoded eagerly.
+  (void)option;
+
+  std::shared_ptr<Archive> archive = Archive::open(filename);
+  if (!archive) {
+    return false;
+  }
+
+  const std::vector<ArchiveMember> &entries = archive->members();
+
+  std::vector<Tensor> loaded(entries.size());
+  std::vector<std::string> errors(entries.size());
+  std::atomic<bool> failed(false);
+
+  parallel_for(entries.size(), num_threads, [&](size_t i) {
+    if (failed) {
+      return;
+    }
+
+    if (!LoadNpyMember(*archive, entries[i], &loaded[i], &errors[i])) {
+      failed = true;
+      return;
+    }
+
+    std::string name = entries[i].name;
+    if ((name.size() > 4) &&
+        (name.compare(name.size() - 4, 4, ".npy") == 0)) {
+      name.resize(name.size() - 4);
+    }
+    loaded[i].name = name;
+  });
+
+  if (failed) {
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (!errors[i].empty()) {
+        std::cerr << "Failed to load `" << entries[i].name << "` in "
+                  << filename << " : " << errors[i] << std::endl;
+      }
+    }
+    return false;
+  }
+
+  for (auto &tensor : loaded) {
+    tensors->push_back(std::move(tensor));
+  }
+
+  return true;
+}
+
+}  // namespace nnview
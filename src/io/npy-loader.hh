@@ -0,0 +1,49 @@
+#ifndef NNVIEW_IO_NPY_LOADER_H_
+#define NNVIEW_IO_NPY_LOADER_H_
+
+#include <string>
+#include <vector>
+
+#include "datatypes.h"
+#include "io/weights-loader.hh"
+
+//
+// Loader for numpy's NPY and NPZ format.
+//
+// NPY : magic(\x93NUMPY), version, header length, header(python dict literal)
+//       followed by the raw array data.
+//       The payload is read or memory-mapped(`WeightsLoadOption::use_mmap`)
+//       in place, in the same way as `load_weights`.
+//
+// NPZ : zip archive of NPY files(see io/archive.hh). Stored(uncompressed)
+//       members are exposed as a view into the memory-mapped archive.
+//       Deflated members are inflated straight into `Tensor::data`(requires
+//       zlib).
+//
+// Supported dtypes are little-endian float32, float16, float64, int8, uint8
+// and int32 in C order.
+//
+namespace nnview {
+
+class Archive;
+struct ArchiveMember;
+
+bool load_npy(const std::string &filename, Tensor *tensor,
+              const WeightsLoadOption &option = WeightsLoadOption());
+
+// Load all arrays in the NPZ file. Tensor name is the member name without
+// `.npy` extension. Members are decoded in parallel with `num_threads`
+// threads(<= 0 : use all hardware threads).
+bool load_npz(const std::string &filename, std::vector<Tensor> *tensors,
+              const WeightsLoadOption &option = WeightsLoadOption(),
+              int num_threads = 0);
+
+// Load a NPY file stored in a tar/zip archive. Stored members of a mapped
+// archive are used in place, others are copied(inflated) to `Tensor::data`.
+// `Tensor::name` is the member path.
+bool load_npy_from_archive(const Archive &archive, const ArchiveMember &member,
+                           Tensor *tensor);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_NPY_LOADER_H_
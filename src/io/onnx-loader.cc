@@ -0,0 +1,679 @@
+#include "io/onnx-loader.hh"
+#include "io/graph-loader.hh"
+#include "io/mapped-file.hh"
+#include "io/path-util.hh"
+
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+namespace nnview {
+
+namespace {
+
+// Field numbers in onnx.proto
+enum {
+  kModelGraph = 7,
+
+  kGraphNode = 1,
+  kGraphInitializer = 5,
+  kGraphInput = 11,
+  kGraphOutput = 12,
+  kGraphValueInfo = 13,
+
+  kNodeInput = 1,
+  kNodeOutput = 2,
+  kNodeName = 3,
+  kNodeOpType = 4,
+
+  kTensorDims = 1,
+  kTensorDataType = 2,
+  kTensorFloatData = 4,
+  kTensorName = 8,
+  kTensorRawData = 9,
+  kTensorExternalData = 13,
+  kTensorDataLocation = 14,
+
+  kStringStringKey = 1,
+  kStringStringValue = 2,
+
+  kValueInfoName = 1,
+  kValueInfoType = 2,
+  kTypeTensorType = 1,
+  kTypeTensorShape = 2,
+  kTensorShapeDim = 1,
+  kDimensionValue = 1,
+};
+
+enum {
+  kWireVarint = 0,
+  kWireFixed64 = 1,
+  kWireLengthDelimited = 2,
+  kWireFixed32 = 5,
+};
+
+// TensorProto.DataType
+constexpr int32_t kDataTypeFloat = 1;
+constexpr int32_t kDataTypeUint8 = 2;
+constexpr int32_t kDataTypeInt8 = 3;
+constexpr int32_t kDataTypeInt32 = 6;
+constexpr int32_t kDataTypeFloat16 = 10;
+constexpr int32_t kDataTypeDouble = 11;
+constexpr int32_t kDataTypeBfloat16 = 16;
+
+constexpr int32_t kDataLocationExternal = 1;
+
+//
+// Minimal protobuf wire format reader.
+//
+class ProtoReader {
+ public:
+  ProtoReader(const uint8_t *begin, const uint8_t *end)
+      : _p(begin), _end(end) {}
+
+  bool valid() const { return _valid; }
+  bool eof() const { return _p >= _end; }
+
+  // Read the next field key. Returns false at the end of the message or on
+  // error.
+  bool next(uint32_t *field, uint32_t *wire_type) {
+    if (!_valid || (_p >= _end)) {
+      return false;
+    }
+    uint64_t key = 0;
+    if (!varint(&key)) {
+      return false;
+    }
+    (*field) = uint32_t(key >> 3);
+    (*wire_type) = uint32_t(key & 0x7);
+    return true;
+  }
+
+  bool varint(uint64_t *v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (_p >= _end) {
+        break;
+      }
+      const uint8_t b = *_p++;
+      result |= uint64_t(b & 0x7f) << shift;
+      if ((b & 0x80) == 0) {
+        (*v) = result;
+        return true;
+      }
+    }
+    _valid = false;
+    return false;
+  }
+
+  bool bytes(const uint8_t **p, size_t *len) {
+    uint64_t n = 0;
+    if (!varint(&n)) {
+      return false;
+    }
+    if (n > uint64_t(_end - _p)) {
+      _valid = false;
+      return false;
+    }
+    (*p) = _p;
+    (*len) = size_t(n);
+    _p += n;
+    return true;
+  }
+
+  std::string string() {
+    const uint8_t *p = nullptr;
+    size_t len = 0;
+    if (!bytes(&p, &len)) {
+      return std::string();
+    }
+    return std::string(reinterpret_cast<const char *>(p), len);
+  }
+
+  bool skip(uint32_t wire_type) {
+    uint64_t v;
+    const uint8_t *p;
+    size_t len;
+    switch (wire_type) {
+      case kWireVarint:
+        return varint(&v);
+      case kWireFixed64:
+        return advance(8);
+      case kWireLengthDelimited:
+        return bytes(&p, &len);
+      case kWireFixed32:
+        return advance(4);
+      default:
+        // Groups are deprecated and not used in ONNX.
+        _valid = false;
+        return false;
+    }
+  }
+
+ private:
+  bool advance(size_t n) {
+    if (n > size_t(_end - _p)) {
+      _valid = false;
+      return false;
+    }
+    _p += n;
+    return true;
+  }
+
+  const uint8_t *_p;
+  const uint8_t *_end;
+  bool _valid = true;
+};
+
+struct OnnxTensor {
+  std::string name;
+  std::vector<int64_t> dims;
+  int32_t data_type = 0;
+  int32_t data_location = 0;
+
+  // Embedded data(raw_data or packed float_data). Points into the mapping.
+  const uint8_t *data = nullptr;
+  size_t data_size = 0;
+  uint32_t data_field = 0;
+
+  // External data
+  std::string location;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+};
+
+struct OnnxNode {
+  std::string name;
+  std::string op_type;
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+};
+
+struct OnnxValueInfo {
+  std::string name;
+  std::vector<int64_t> dims;
+};
+
+struct OnnxGraph {
+  std::vector<OnnxNode> nodes;
+  std::vector<OnnxTensor> initializers;
+  std::vector<OnnxValueInfo> inputs;
+  std::vector<OnnxValueInfo> outputs;
+  std::vector<OnnxValueInfo> value_infos;
+};
+
+}  // namespace
+
+static bool GetDataType(int32_t data_type, DataType *dtype) {
+  switch (data_type) {
+    case kDataTypeFloat:
+      (*dtype) = DTYPE_FLOAT32;
+      return true;
+    case kDataTypeUint8:
+      (*dtype) = DTYPE_UINT8;
+      return true;
+    case kDataTypeInt8:
+      (*dtype) = DTYPE_INT8;
+      return true;
+    case kDataTypeInt32:
+      (*dtype) = DTYPE_INT32;
+      return true;
+    case kDataTypeFloat16:
+      (*dtype) = DTYPE_FLOAT16;
+      return true;
+    case kDataTypeDouble:
+      (*dtype) = DTYPE_FLOAT64;
+      return true;
+    case kDataTypeBfloat16:
+      (*dtype) = DTYPE_BFLOAT16;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool ParseTensorProto(const uint8_t *begin, const uint8_t *end,
+                             OnnxTensor *tensor) {
+  ProtoReader r(begin, end);
+  uint32_t field, wire;
+  while (r.next(&field, &wire)) {
+    if ((field == kTensorDims) && (wire == kWireVarint)) {
+      uint64_t v = 0;
+      r.varint(&v);
+      tensor->dims.push_back(int64_t(v));
+    } else if ((field == kTensorDims) && (wire == kWireLengthDelimited)) {
+      // packed
+      const uint8_t *p;
+      size_t len;
+      if (r.bytes(&p, &len)) {
+        ProtoReader packed(p, p + len);
+        uint64_t v = 0;
+        while (!packed.eof() && packed.varint(&v)) {
+          tensor->dims.push_back(int64_t(v));
+        }
+      }
+    } else if ((field == kTensorDataType) && (wire == kWireVarint)) {
+      uint64_t v = 0;
+      r.varint(&v);
+      tensor->data_type = int32_t(v);
+    } else if ((field == kTensorName) && (wire == kWireLengthDelimited)) {
+      tensor->name = r.string();
+    } else if (((field == kTensorRawData) || (field == kTensorFloatData)) &&
+               (wire == kWireLengthDelimited)) {
+      // `float_data` is packed by default in proto3, so its content is a
+      // plain little-endian float array as well as `raw_data`.
+      r.bytes(&tensor->data, &tensor->data_size);
+      tensor->data_field = field;
+    } else if ((field == kTensorExternalData) &&
+               (wire == kWireLengthDelimited)) {
+      const uint8_t *p;
+      size_t len;
+      if (r.bytes(&p, &len)) {
+        ProtoReader entry(p, p + len);
+        std::string key, value;
+        uint32_t f, w;
+        while (entry.next(&f, &w)) {
+          if ((f == kStringStringKey) && (w == kWireLengthDelimited)) {
+            key = entry.string();
+          } else if ((f == kStringStringValue) &&
+                     (w == kWireLengthDelimited)) {
+            value = entry.string();
+          } else {
+            entry.skip(w);
+          }
+        }
+        if (key.compare("location") == 0) {
+          tensor->location = value;
+        } else if (key.compare("offset") == 0) {
+          tensor->offset = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key.compare("length") == 0) {
+          tensor->length = std::strtoull(value.c_str(), nullptr, 10);
+        }
+      }
+    } else if ((field == kTensorDataLocation) && (wire == kWireVarint)) {
+      uint64_t v = 0;
+      r.varint(&v);
+      tensor->data_location = int32_t(v);
+    } else {
+      r.skip(wire);
+    }
+  }
+
+  return r.valid();
+}
+
+static bool ParseValueInfoProto(const uint8_t *begin, const uint8_t *end,
+                                OnnxValueInfo *info) {
+  ProtoReader r(begin, end);
+  uint32_t field, wire;
+  while (r.next(&field, &wire)) {
+    if ((field == kValueInfoName) && (wire == kWireLengthDelimited)) {
+      info->name = r.string();
+    } else if ((field == kValueInfoType) && (wire == kWireLengthDelimited)) {
+      // TypeProto.tensor_type.shape.dim[].dim_value
+      const uint8_t *p;
+      size_t len;
+      if (!r.bytes(&p, &len)) {
+        break;
+      }
+      ProtoReader type(p, p + len);
+      while (type.next(&field, &wire)) {
+        if ((field != kTypeTensorType) || (wire != kWireLengthDelimited) ||
+            !type.bytes(&p, &len)) {
+          type.skip(wire);
+          continue;
+        }
+        ProtoReader tensor_type(p, p + len);
+        while (tensor_type.next(&field, &wire)) {
+          if ((field != kTypeTensorShape) || (wire != kWireLengthDelimited) ||
+              !tensor_type.bytes(&p, &len)) {
+            tensor_type.skip(wire);
+            continue;
+          }
+          ProtoReader shape(p, p + len);
+          while (shape.next(&field, &wire)) {
+            if ((field != kTensorShapeDim) || (wire != kWireLengthDelimited) ||
+                !shape.bytes(&p, &len)) {
+              shape.skip(wire);
+              continue;
+            }
+            // Symbolic dimension(dim_param) is treated as unknown(-1).
+            int64_t dim_value = -1;
+            ProtoReader dim(p, p + len);
+            while (dim.next(&field, &wire)) {
+              uint64_t v = 0;
+              if ((field == kDimensionValue) && (wire == kWireVarint) &&
+                  dim.varint(&v)) {
+                dim_value = int64_t(v);
+              } else {
+                dim.skip(wire);
+              }
+            }
+            info->dims.push_back(dim_value);
+          }
+        }
+      }
+    } else {
+      r.skip(wire);
+    }
+  }
+
+  return r.valid();
+}
+
+static bool ParseNodeProto(const uint8_t *begin, const uint8_t *end,
+                           OnnxNode *node) {
+  ProtoReader r(begin, end);
+  uint32_t field, wire;
+  while (r.next(&field, &wire)) {
+    if (wire != kWireLengthDelimited) {
+      r.skip(wire);
+    } else if (field == kNodeInput) {
+      node->inputs.push_back(r.string());
+    } else if (field == kNodeOutput) {
+      node->outputs.push_back(r.string());
+    } else if (field == kNodeName) {
+      node->name = r.string();
+    } else if (field == kNodeOpType) {
+      node->op_type = r.string();
+    } else {
+      r.skip(wire);
+    }
+  }
+
+  return r.valid();
+}
+
+static bool ParseGraphProto(const uint8_t *begin, const uint8_t *end,
+                            OnnxGraph *graph) {
+  ProtoReader r(begin, end);
+  uint32_t field, wire;
+  while (r.next(&field, &wire)) {
+    const uint8_t *p;
+    size_t len;
+    if ((wire != kWireLengthDelimited) || ((field != kGraphNode) &&
+                                           (field != kGraphInitializer) &&
+                                           (field != kGraphInput) &&
+                                           (field != kGraphOutput) &&
+                                           (field != kGraphValueInfo))) {
+      r.skip(wire);
+      continue;
+    }
+
+    if (!r.bytes(&p, &len)) {
+      break;
+    }
+
+    bool ok = true;
+    if (field == kGraphNode) {
+      graph->nodes.emplace_back();
+      ok = ParseNodeProto(p, p + len, &graph->nodes.back());
+    } else if (field == kGraphInitializer) {
+      graph->initializers.emplace_back();
+      ok = ParseTensorProto(p, p + len, &graph->initializers.back());
+    } else if (field == kGraphInput) {
+      graph->inputs.emplace_back();
+      ok = ParseValueInfoProto(p, p + len, &graph->inputs.back());
+    } else if (field == kGraphOutput) {
+      graph->outputs.emplace_back();
+      ok = ParseValueInfoProto(p, p + len, &graph->outputs.back());
+    } else {
+      graph->value_infos.emplace_back();
+      ok = ParseValueInfoProto(p, p + len, &graph->value_infos.back());
+    }
+
+    if (!ok) {
+      return false;
+    }
+  }
+
+  return r.valid();
+}
+
+// Returns false when the number of items overflows. `num_items` is 0 then.
+static bool SetShape(const std::vector<int64_t> &dims, Tensor *tensor) {
+  tensor->shape.clear();
+  tensor->num_items = 1;
+  bool ok = true;
+  for (int64_t d : dims) {
+    // Unknown dimension is shown as 1.
+    const int dim = (d <= 0) ? 1 : ((d > INT_MAX) ? INT_MAX : int(d));
+    tensor->shape.push_back(dim);
+    if (uint64_t(tensor->num_items) >
+        std::numeric_limits<uint64_t>::max() / uint64_t(dim)) {
+      ok = false;
+    }
+    tensor->num_items *= size_t(dim);
+  }
+  if (!ok) {
+    tensor->num_items = 0;
+  }
+
+  // Force create 2D tensor as done in `load_weights`.
+  while (tensor->shape.size() < 2) {
+    tensor->shape.push_back(1);
+  }
+
+  return ok;
+}
+
+static std::string GetInputSlotName(const std::string &op_type, size_t i) {
+  if ((op_type.compare("Conv") == 0) || (op_type.compare("Gemm") == 0) ||
+      (op_type.compare("ConvTranspose") == 0)) {
+    // input, weights, bias
+    if (i == 1) {
+      return "W";
+    } else if (i == 2) {
+      return "b";
+    }
+  }
+
+  return (i == 0) ? "input" : ("input" + std::to_string(i));
+}
+
+bool load_onnx_graph(const std::string &filename, Graph *graph) {
+  if (graph == nullptr) {
+    std::cerr << "`graph` is nullptr\n";
+    return false;
+  }
+
+  std::shared_ptr<MappedFile> mapping = MappedFile::open(filename);
+  if (!mapping) {
+    return false;
+  }
+
+  const uint8_t *data = mapping->data();
+  const uint8_t *data_end = data + mapping->size();
+
+  OnnxGraph onnx;
+  {
+    bool found = false;
+    ProtoReader r(data, data_end);
+    uint32_t field, wire;
+    while (r.next(&field, &wire)) {
+      const uint8_t *p;
+      size_t len;
+      if ((field == kModelGraph) && (wire == kWireLengthDelimited) &&
+          r.bytes(&p, &len)) {
+        if (!ParseGraphProto(p, p + len, &onnx)) {
+          break;
+        }
+        found = true;
+      } else {
+        r.skip(wire);
+      }
+    }
+
+    if (!r.valid() || !found) {
+      std::cerr << "Failed to parse ONNX model : " << filename << std::endl;
+      return false;
+    }
+  }
+
+  graph->inputs.clear();
+  graph->outputs.clear();
+  graph->nodes.clear();
+  graph->tensors.clear();
+  graph->symbols.clear();
+
+  const std::string base_dir = GetBaseDir(filename);
+
+  SymbolTable &symbols = graph->symbols;
+  const Symbol input_sym = symbols.intern("input");
+  const Symbol output_sym = symbols.intern("output");
+
+  // <symbol, tensor id>. -1 = not a tensor name.
+  std::vector<int> tensor_ids;
+
+  auto get_tensor_id = [&](const std::string &name) -> int {
+    const Symbol sym = symbols.intern(name);
+    if (sym >= tensor_ids.size()) {
+      tensor_ids.resize(symbols.size(), -1);
+    }
+    if (tensor_ids[sym] >= 0) {
+      return tensor_ids[sym];
+    }
+
+    Tensor tensor;
+    tensor.name = name;
+    tensor.shape = {1, 1};
+    tensor.num_items = 1;
+    // Activations have no data.
+    tensor.loaded = false;
+
+    const int id = int(graph->tensors.size());
+    graph->tensors.push_back(std::move(tensor));
+    tensor_ids[sym] = id;
+    return id;
+  };
+
+  size_t num_external = 0;
+  for (const auto &init : onnx.initializers) {
+    Tensor &tensor = graph->tensors[size_t(get_tensor_id(init.name))];
+    if (!SetShape(init.dims, &tensor)) {
+      std::cerr << "Shape of initializer `" << init.name
+                << "` is too large.\n";
+      continue;
+    }
+
+    if (!GetDataType(init.data_type, &tensor.dtype) ||
+        (tensor.num_items == 0) ||
+        (tensor.num_items > std::numeric_limits<size_t>::max() /
+                                get_dtype_size(tensor.dtype))) {
+      continue;
+    }
+
+    const size_t num_bytes = tensor.byte_size();
+
+    if (init.data_location == kDataLocationExternal) {
+      if (init.location.empty() ||
+          ((init.length > 0) && (init.length != num_bytes))) {
+        std::cerr << "Invalid external data for initializer `" << init.name
+                  << "`\n";
+        continue;
+      }
+      // Read on demand by `load_tensor_payload`.
+      tensor.source_filename = JoinPath(base_dir, init.location);
+      tensor.source_offset = init.offset;
+      num_external++;
+    } else if (init.data && (init.data_size == num_bytes) &&
+               ((init.data_field == kTensorRawData) ||
+                (init.data_type == kDataTypeFloat))) {
+      // Other typed fields(`int32_data`, `double_data`, ...) are varint
+      // encoded or wider than the element type, so only `raw_data` and
+      // packed `float_data` can be viewed in place.
+      tensor.source_filename = filename;
+      tensor.source_offset = uint64_t(init.data - data);
+      tensor.mapping = mapping;
+      tensor.mapped_data = init.data;
+      tensor.loaded = true;
+    }
+  }
+
+  const size_t num_initializer_tensors = graph->tensors.size();
+
+  // Initializers keep the shape of their data. A differing(or symbolic)
+  // shape in `value_info` or outputs would not match the payload.
+  for (const auto &info : onnx.value_infos) {
+    int id = get_tensor_id(info.name);
+    if ((size_t(id) >= num_initializer_tensors) && !info.dims.empty()) {
+      SetShape(info.dims, &graph->tensors[size_t(id)]);
+    }
+  }
+
+  // `input` node for each graph input. Older models also list initializers as
+  // graph inputs, so skip them.
+  for (const auto &info : onnx.inputs) {
+    const int id = get_tensor_id(info.name);
+    if (size_t(id) < num_initializer_tensors) {
+      continue;
+    }
+    SetShape(info.dims, &graph->tensors[size_t(id)]);
+
+    Node node;
+    node.type = LAYER_INPUT;
+    node.name = info.name;
+    node.id = int(graph->nodes.size());
+    node.outputs.push_back(Slot(symbols.intern(info.name), output_sym, id));
+    graph->nodes.push_back(node);
+
+    graph->inputs.push_back(Slot(symbols.intern(info.name), input_sym, id));
+  }
+
+  for (const auto &info : onnx.outputs) {
+    const int id = get_tensor_id(info.name);
+    if ((size_t(id) >= num_initializer_tensors) && !info.dims.empty()) {
+      SetShape(info.dims, &graph->tensors[size_t(id)]);
+    }
+    graph->outputs.push_back(Slot(symbols.intern(info.name), output_sym, id));
+  }
+
+  for (size_t i = 0; i < onnx.nodes.size(); i++) {
+    const OnnxNode &onnx_node = onnx.nodes[i];
+
+    Node node;
+    node.name = onnx_node.name.empty()
+                    ? (onnx_node.op_type + "-" + std::to_string(i))
+                    : onnx_node.name;
+    node.id = int(graph->nodes.size());
+    if ((onnx_node.op_type.compare("Gemm") == 0) ||
+        (onnx_node.op_type.compare("MatMul") == 0)) {
+      node.type = LAYER_LINEAR_FUNCTION;
+    } else if (onnx_node.op_type.compare("Relu") == 0) {
+      node.type = LAYER_RELU;
+    }
+
+    for (size_t k = 0; k < onnx_node.inputs.size(); k++) {
+      const std::string &name = onnx_node.inputs[k];
+      // Empty name = omitted optional input.
+      if (name.empty()) {
+        continue;
+      }
+      const int id = get_tensor_id(name);
+      node.inputs.push_back(
+          Slot(symbols.intern(name),
+               symbols.intern(GetInputSlotName(onnx_node.op_type, k)), id));
+    }
+
+    for (const auto &name : onnx_node.outputs) {
+      if (name.empty()) {
+        continue;
+      }
+      const int id = get_tensor_id(name);
+      node.outputs.push_back(Slot(symbols.intern(name), output_sym, id));
+    }
+
+    graph->nodes.push_back(node);
+  }
+
+  compute_node_depth(graph);
+
+  std::cout << "ONNX model : " << graph->nodes.size() << " nodes, "
+            << graph->tensors.size() << " tensors(" << num_external
+            << " in external data)\n";
+
+  return true;
+}
+
+}  // namespace nnview
@@ -0,0 +1,28 @@
+#ifndef NNVIEW_IO_ONNX_LOADER_H_
+#define NNVIEW_IO_ONNX_LOADER_H_
+
+#include <string>
+
+#include "datatypes.h"
+
+//
+// Loader for ONNX model(.onnx, protobuf format).
+//
+// The protobuf wire format is decoded in place on the memory-mapped file. No
+// protobuf library or generated code is required.
+//
+// - Each NodeProto becomes a `Node`.
+// - Initializers embedded in the model(`raw_data` or packed `float_data`) are
+//   exposed as `Tensor` views into the mapped file in their native dtype
+//   (float32, float16, bfloat16, float64, int8, uint8 or int32).
+// - Initializers stored in external data files are not read at load time.
+//   Only their location is recorded and the payload is read by
+//   `load_tensor_payload` when the tensor is selected in the GUI.
+//
+namespace nnview {
+
+bool load_onnx_graph(const std::string &filename, Graph *graph);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_ONNX_LOADER_H_
@@ -0,0 +1,53 @@
+#ifndef NNVIEW_IO_PATH_UTIL_H_
+#define NNVIEW_IO_PATH_UTIL_H_
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+namespace nnview {
+
+inline std::string JoinPath(const std::string &dir,
+                            const std::string &filename) {
+  if (dir.empty()) {
+    return filename;
+  } else {
+    char lastChar = *dir.rbegin();
+    if (lastChar != '/') {
+      return dir + std::string("/") + filename;
+    } else {
+      return dir + filename;
+    }
+  }
+}
+
+inline std::string GetBaseDir(const std::string &filepath) {
+  if (filepath.find_last_of("/\\") != std::string::npos)
+    return filepath.substr(0, filepath.find_last_of("/\\"));
+  return "";
+}
+
+// Returns lower-cased extension including '.'(e.g. ".npy")
+inline std::string GetFileExtension(const std::string &filepath) {
+  size_t pos = filepath.find_last_of(".");
+  if ((pos == std::string::npos) ||
+      ((filepath.find_last_of("/\\") != std::string::npos) &&
+       (pos < filepath.find_last_of("/\\")))) {
+    return "";
+  }
+  std::string ext = filepath.substr(pos);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](char c) { return char(std::tolower(c)); });
+  return ext;
+}
+
+inline std::string GetBaseName(const std::string &filepath) {
+  size_t pos = filepath.find_last_of("/\\");
+  std::string basename =
+      (pos == std::string::npos) ? filepath : filepath.substr(pos + 1);
+  return basename.substr(0, basename.find_last_of("."));
+}
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_PATH_UTIL_H_
@@ -0,0 +1,205 @@
+#include "io/safetensors-loader.hh"
+#include "io/mapped-file.hh"
+
+#include "json11.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+using namespace json11;
+
+namespace nnview {
+
+namespace {
+
+struct SafetensorsEntry {
+  std::string name;
+  std::string dtype;
+  std::vector<int> shape;
+  size_t num_items = 1;
+  uint64_t begin = 0;  // relative to the start of the data section.
+  uint64_t end = 0;
+};
+
+}  // namespace
+
+static bool GetDataType(const std::string &name, DataType *dtype) {
+  static const struct {
+    const char *name;
+    DataType dtype;
+  } kDataTypes[] = {
+      {"F32", DTYPE_FLOAT32}, {"F16", DTYPE_FLOAT16}, {"BF16", DTYPE_BFLOAT16},
+      {"F64", DTYPE_FLOAT64}, {"I8", DTYPE_INT8},     {"U8", DTYPE_UINT8},
+      {"I32", DTYPE_INT32},
+  };
+
+  for (const auto &t : kDataTypes) {
+    if (name.compare(t.name) == 0) {
+      (*dtype) = t.dtype;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Whether `value` is an integer in [0, max]. Casting other doubles(negative,
+// fractional or too large) to an integer type truncates or is undefined.
+static bool IsIndex(const Json &value, double max) {
+  const double v = value.number_value();
+  return value.is_number() && (v >= 0.0) && (v <= max) && (std::floor(v) == v);
+}
+
+// Build the index of tensors from the JSON header.
+static bool ParseSafetensorsHeader(const Json &header,
+                                   std::vector<SafetensorsEntry> *entries,
+                                   std::string *err) {
+  if (!header.is_object()) {
+    (*err) = "safetensors header is not a JSON object.";
+    return false;
+  }
+
+  for (const auto &item : header.object_items()) {
+    if (item.first.compare("__metadata__") == 0) {
+      continue;
+    }
+
+    const Json &j = item.second;
+
+    SafetensorsEntry entry;
+    entry.name = item.first;
+    entry.dtype = j["dtype"].string_value();
+
+    const Json::array &offsets = j["data_offsets"].array_items();
+    // NOTE: json11 stores numbers as double, which is exact up to 2^53.
+    const double kMaxOffset = 9007199254740992.0;  // 2^53
+    if ((offsets.size() != 2) || !IsIndex(offsets[0], kMaxOffset) ||
+        !IsIndex(offsets[1], kMaxOffset)) {
+      (*err) = "Invalid `data_offsets` for tensor `" + entry.name + "`.";
+      return false;
+    }
+    entry.begin = uint64_t(offsets[0].number_value());
+    entry.end = uint64_t(offsets[1].number_value());
+
+    for (const auto &d : j["shape"].array_items()) {
+      const double dim = d.number_value();
+      if (!IsIndex(d, double(INT_MAX))) {
+        (*err) = "Invalid `shape` for tensor `" + entry.name + "`.";
+        return false;
+      }
+      const uint64_t max_items = std::numeric_limits<uint64_t>::max();
+      if ((dim > 0.0) &&
+          (uint64_t(entry.num_items) > max_items / uint64_t(dim))) {
+        (*err) = "`shape` of tensor `" + entry.name + "` is too large.";
+        return false;
+      }
+      entry.shape.push_back(int(dim));
+      entry.num_items *= size_t(dim);
+    }
+
+    entries->push_back(entry);
+  }
+
+  // Keep the order of tensors in the file.
+  std::sort(entries->begin(), entries->end(),
+            [](const SafetensorsEntry &a, const SafetensorsEntry &b) {
+              return a.begin < b.begin;
+            });
+
+  return true;
+}
+
+bool load_safetensors(const std::string &filename,
+                      std::vector<Tensor> *tensors) {
+  std::shared_ptr<MappedFile> mapping = MappedFile::open(filename);
+  if (!mapping) {
+    return false;
+  }
+
+  const uint8_t *data = mapping->data();
+  const size_t size = mapping->size();
+
+  if (size < 8) {
+    std::cerr << "File is too small for safetensors : " << filename
+              << std::endl;
+    return false;
+  }
+
+  uint64_t header_size = 0;
+  for (int i = 7; i >= 0; i--) {
+    header_size = (header_size << 8) | data[i];
+  }
+
+  if (header_size > size - 8) {
+    std::cerr << "Invalid safetensors header size " << header_size
+              << ". filename : " << filename << std::endl;
+    return false;
+  }
+
+  std::string err;
+  Json header = Json::parse(
+      std::string(reinterpret_cast<const char *>(data + 8), header_size),
+      err);
+  if (!err.empty()) {
+    std::cerr << "JSON parse error in safetensors header. filename: "
+              << filename << " err: " << err << std::endl;
+    return false;
+  }
+
+  std::vector<SafetensorsEntry> entries;
+  if (!ParseSafetensorsHeader(header, &entries, &err)) {
+    std::cerr << err << " filename : " << filename << std::endl;
+    return false;
+  }
+
+  const size_t data_offset = size_t(8 + header_size);
+  const size_t data_size = size - data_offset;
+
+  for (const auto &entry : entries) {
+    DataType dtype;
+    if (!GetDataType(entry.dtype, &dtype)) {
+      std::cerr << "Skip tensor `" << entry.name << "` : dtype "
+                << entry.dtype << " is not supported.\n";
+      continue;
+    }
+
+    if (entry.num_items == 0) {
+      std::cerr << "Skip empty tensor `" << entry.name << "`\n";
+      continue;
+    }
+
+    // Compare the item count first so that the byte size does not wrap.
+    const size_t dtype_size = get_dtype_size(dtype);
+    if ((entry.begin > entry.end) || (entry.end > data_size) ||
+        (entry.num_items > (entry.end - entry.begin) / dtype_size) ||
+        ((entry.end - entry.begin) != entry.num_items * dtype_size)) {
+      std::cerr << "Invalid data_offsets for tensor `" << entry.name
+                << "`. filename : " << filename << std::endl;
+      return false;
+    }
+
+    Tensor tensor;
+    tensor.name = entry.name;
+    tensor.dtype = dtype;
+    tensor.shape = entry.shape;
+    // Force create 2D tensor as done in `load_weights`.
+    while (tensor.shape.size() < 2) {
+      tensor.shape.push_back(1);
+    }
+    tensor.num_items = entry.num_items;
+    tensor.source_filename = filename;
+    tensor.source_offset = data_offset + entry.begin;
+    tensor.mapping = mapping;
+    tensor.mapped_data = data + data_offset + entry.begin;
+    tensor.loaded = true;
+
+    tensors->push_back(std::move(tensor));
+  }
+
+  return true;
+}
+
+}  // namespace nnview
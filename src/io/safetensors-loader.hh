@@ -0,0 +1,30 @@
+#ifndef NNVIEW_IO_SAFETENSORS_LOADER_H_
+#define NNVIEW_IO_SAFETENSORS_LOADER_H_
+
+#include <string>
+#include <vector>
+
+#include "datatypes.h"
+
+//
+// Loader for safetensors format(https://github.com/huggingface/safetensors)
+//
+// format is:
+//
+// header_size(uint64 LE)
+// JSON header : {"name": {"dtype": "F32", "shape": [..], "data_offsets": [begin, end]}, ...}
+// <<binary>>
+//
+// The file is memory-mapped once and every tensor is a view into the
+// shared mapping, so opening the file only costs parsing the JSON header.
+// F32, F16, BF16, F64, I8, U8 and I32 tensors are kept in their native dtype.
+// Tensors with other dtypes(e.g. I64, BOOL) are skipped with a message.
+//
+namespace nnview {
+
+bool load_safetensors(const std::string &filename,
+                      std::vector<Tensor> *tensors);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_SAFETENSORS_LOADER_H_
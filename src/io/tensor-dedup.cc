@@ -0,0 +1,79 @@
+#include "io/tensor-dedup.hh"
+#include "hash.hh"
+#include "parallel.hh"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace nnview {
+
+// Move the payload of `tensor` into an immutable shared block.
+static void MakeShared(Tensor *tensor) {
+  if (tensor->shared_data) {
+    return;
+  }
+  tensor->shared_data =
+      std::make_shared<const std::vector<uint8_t>>(std::move(tensor->data));
+  tensor->data = std::vector<uint8_t>();
+  tensor->mapped_data = tensor->shared_data->data();
+}
+
+DedupStats deduplicate_tensors(std::vector<Tensor> *tensors,
+                               int num_threads) {
+  DedupStats stats;
+
+  const size_t n = tensors->size();
+
+  // 0 = not a candidate.
+  std::vector<char> candidate(n, 0);
+  std::vector<uint64_t> hashes(n, 0);
+  parallel_for(n, num_threads, [&](size_t i) {
+    const Tensor &tensor = (*tensors)[i];
+    if (tensor.loaded && !tensor.data.empty()) {
+      hashes[i] = hash64(tensor.data.data(), tensor.data.size());
+      candidate[i] = 1;
+    }
+  });
+
+  // hash -> tensors having distinct payloads with the hash.
+  std::unordered_map<uint64_t, std::vector<size_t>> owners;
+
+  for (size_t i = 0; i < n; i++) {
+    if (!candidate[i]) {
+      continue;
+    }
+
+    Tensor &tensor = (*tensors)[i];
+    std::vector<size_t> &bucket = owners[hashes[i]];
+
+    Tensor *owner = nullptr;
+    for (const size_t j : bucket) {
+      const Tensor &other = (*tensors)[j];
+      // The hash is not cryptographic, so compare the content.
+      if ((other.byte_size() == tensor.byte_size()) &&
+          (memcmp(other.raw_data(), tensor.data.data(), tensor.data.size()) ==
+           0)) {
+        owner = &(*tensors)[j];
+        break;
+      }
+    }
+
+    if (!owner) {
+      bucket.push_back(i);
+      continue;
+    }
+
+    MakeShared(owner);
+
+    stats.bytes_saved += tensor.data.size();
+    stats.num_tensors++;
+
+    tensor.data = std::vector<uint8_t>();
+    tensor.shared_data = owner->shared_data;
+    tensor.mapped_data = owner->mapped_data;
+  }
+
+  return stats;
+}
+
+}  // namespace nnview
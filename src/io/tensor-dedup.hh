@@ -0,0 +1,32 @@
+#ifndef NNVIEW_IO_TENSOR_DEDUP_H_
+#define NNVIEW_IO_TENSOR_DEDUP_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "datatypes.h"
+
+//
+// Content based deduplication of tensor payloads.
+//
+// Exported model directories often contain the same payload under several
+// names(e.g. tied embeddings, repeated output dumps). Payloads read into
+// `Tensor::data` are fingerprinted with `hash64` and tensors having
+// byte-identical payloads share one immutable block(`Tensor::shared_data`).
+//
+// Memory-mapped and not yet loaded tensors are left as is.
+//
+namespace nnview {
+
+struct DedupStats {
+  size_t num_tensors = 0;  // The number of tensors which share a block.
+  size_t bytes_saved = 0;
+};
+
+// Hashing runs on `num_threads` threads(<= 0 : use all hardware threads).
+DedupStats deduplicate_tensors(std::vector<Tensor> *tensors,
+                               int num_threads = 0);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_TENSOR_DEDUP_H_
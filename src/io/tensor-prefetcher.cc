@@ -0,0 +1,207 @@
+#include "io/tensor-prefetcher.hh"
+
+#include <iostream>
+
+namespace nnview {
+
+TensorPrefetcher::~TensorPrefetcher() { stop(); }
+
+void TensorPrefetcher::start(const Graph &graph, size_t budget_bytes,
+                             int max_hops, const WeightsLoadOption &option) {
+  stop();
+
+  _option = option;
+  // Payloads are read one by one, so batched io_uring reads buy nothing here.
+  _option.use_io_uring = false;
+  _option.header_only = false;
+
+  _budget_bytes = budget_bytes;
+  _max_hops = max_hops;
+
+  _tensor_to_nodes.assign(graph.tensors.size(), std::vector<size_t>());
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    const Node &node = graph.nodes[i];
+    for (const auto *slots : {&node.inputs, &node.outputs}) {
+      for (const Slot &slot : *slots) {
+        if ((slot.id >= 0) && (size_t(slot.id) < _tensor_to_nodes.size())) {
+          _tensor_to_nodes[size_t(slot.id)].push_back(i);
+        }
+      }
+    }
+  }
+
+  _planned.clear();
+  _prefetched.clear();
+
+  _stop = false;
+  _worker = std::thread([this]() { run(); });
+}
+
+void TensorPrefetcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+    _queue.clear();
+  }
+  _cond.notify_all();
+  if (_worker.joinable()) {
+    _worker.join();
+  }
+}
+
+std::vector<size_t> TensorPrefetcher::request(const Graph &graph,
+                                              size_t tensor_idx) {
+  std::vector<size_t> evicted;
+  if ((tensor_idx >= graph.tensors.size()) ||
+      (graph.tensors.size() != _tensor_to_nodes.size())) {
+    return evicted;
+  }
+
+  // The selected tensor is owned by the caller from now on.
+  _prefetched.erase(tensor_idx);
+
+  // Breadth-first walk over tensor -> node -> tensor connections, so that
+  // `neighbours` is sorted by the number of hops.
+  std::vector<size_t> neighbours;
+  {
+    std::vector<bool> visited_tensor(graph.tensors.size(), false);
+    std::vector<bool> visited_node(graph.nodes.size(), false);
+    std::vector<size_t> frontier(1, tensor_idx);
+    visited_tensor[tensor_idx] = true;
+
+    for (int hop = 0; (hop < _max_hops) && !frontier.empty(); hop++) {
+      std::vector<size_t> next;
+      for (const size_t t : frontier) {
+        for (const size_t n : _tensor_to_nodes[t]) {
+          if (visited_node[n]) {
+            continue;
+          }
+          visited_node[n] = true;
+
+          const Node &node = graph.nodes[n];
+          for (const auto *slots : {&node.inputs, &node.outputs}) {
+            for (const Slot &slot : *slots) {
+              if ((slot.id < 0) || (size_t(slot.id) >= graph.tensors.size()) ||
+                  visited_tensor[size_t(slot.id)]) {
+                continue;
+              }
+              visited_tensor[size_t(slot.id)] = true;
+              next.push_back(size_t(slot.id));
+            }
+          }
+        }
+      }
+      neighbours.insert(neighbours.end(), next.begin(), next.end());
+      frontier.swap(next);
+    }
+  }
+
+  // Take the nearest tensors which fit in the budget. Tensors loaded by the
+  // caller(eagerly or by selecting them) are not ours to count or evict.
+  std::set<size_t> planned;
+  std::deque<std::pair<size_t, Tensor>> jobs;
+  size_t planned_bytes = 0;
+  for (const size_t t : neighbours) {
+    const Tensor &tensor = graph.tensors[t];
+    if (tensor.loaded && !_prefetched.count(t)) {
+      continue;
+    }
+    if (!tensor.loaded && tensor.source_filename.empty()) {
+      continue;
+    }
+    const size_t bytes = tensor.byte_size();
+    if (planned_bytes + bytes > _budget_bytes) {
+      continue;
+    }
+    planned_bytes += bytes;
+    planned.insert(t);
+    if (!tensor.loaded) {
+      // Header only, so the copy is cheap.
+      jobs.emplace_back(t, tensor);
+    }
+  }
+
+  for (auto it = _prefetched.begin(); it != _prefetched.end();) {
+    if (planned.count(it->first)) {
+      ++it;
+    } else {
+      evicted.push_back(it->first);
+      it = _prefetched.erase(it);
+    }
+  }
+  _planned.swap(planned);
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Loads in flight are finished and delivered(or dropped in `fetch`).
+    _queue.clear();
+    for (auto &job : jobs) {
+      if (!_inflight.count(job.first)) {
+        _queue.push_back(std::move(job));
+      }
+    }
+  }
+  _cond.notify_one();
+
+  return evicted;
+}
+
+std::vector<std::pair<size_t, Tensor>> TensorPrefetcher::fetch(
+    const Graph &graph) {
+  std::vector<std::pair<size_t, Tensor>> loaded;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    loaded.swap(_loaded);
+  }
+
+  std::vector<std::pair<size_t, Tensor>> fetched;
+  for (auto &item : loaded) {
+    const size_t idx = item.first;
+    if ((idx >= graph.tensors.size()) || graph.tensors[idx].loaded ||
+        !_planned.count(idx)) {
+      continue;
+    }
+    _prefetched[idx] = item.second.byte_size();
+    fetched.push_back(std::move(item));
+  }
+
+  return fetched;
+}
+
+size_t TensorPrefetcher::prefetched_bytes() const {
+  size_t bytes = 0;
+  for (const auto &item : _prefetched) {
+    bytes += item.second;
+  }
+  return bytes;
+}
+
+void TensorPrefetcher::run() {
+  for (;;) {
+    std::pair<size_t, Tensor> job;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _cond.wait(lock, [this]() { return _stop || !_queue.empty(); });
+      if (_stop) {
+        break;
+      }
+      job = std::move(_queue.front());
+      _queue.pop_front();
+      _inflight.insert(job.first);
+    }
+
+    const bool ret = load_tensor_payload(&job.second, _option);
+    if (!ret) {
+      std::cerr << "Failed to prefetch tensor data : "
+                << job.second.source_filename << "\n";
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _inflight.erase(job.first);
+    if (ret) {
+      _loaded.push_back(std::move(job));
+    }
+  }
+}
+
+}  // namespace nnview
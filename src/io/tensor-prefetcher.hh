@@ -0,0 +1,94 @@
+#ifndef NNVIEW_IO_TENSOR_PREFETCHER_H_
+#define NNVIEW_IO_TENSOR_PREFETCHER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "datatypes.h"
+#include "io/weights-loader.hh"
+
+//
+// Load the payloads of lazily loaded tensors near the selected tensor in the
+// background.
+//
+// When browsing a graph the next selection is nearly always a neighbour of the
+// current one. `request` walks the `Slot` connections of `Graph::nodes` from
+// the selected tensor(tensor -> node -> tensor is one hop) and queues the
+// unloaded tensors within `max_hops`, nearest first, while their total size
+// fits in the memory budget. A worker thread loads them into copies of the
+// tensors, which are handed to the owner of the graph through `fetch`, so the
+// graph itself is only touched by the thread calling `request` and
+// `fetch`(the GUI thread).
+//
+// Tensors installed from `fetch` are tracked as prefetched until they are
+// selected. `request` returns the prefetched tensors which fell out of the
+// neighbourhood or the budget so that the owner can drop their payloads.
+//
+namespace nnview {
+
+class TensorPrefetcher {
+ public:
+  TensorPrefetcher() {}
+  ~TensorPrefetcher();
+
+  TensorPrefetcher(const TensorPrefetcher &) = delete;
+  TensorPrefetcher &operator=(const TensorPrefetcher &) = delete;
+
+  // Start the worker thread. `budget_bytes` bounds the total payload size of
+  // prefetched tensors.
+  void start(const Graph &graph, size_t budget_bytes, int max_hops = 2,
+             const WeightsLoadOption &option = WeightsLoadOption());
+
+  void stop();
+
+  // Plan prefetching around `tensor_idx`(the selected tensor). Pending loads
+  // of the previous plan are cancelled.
+  // Returns the indices of prefetched tensors to evict.
+  std::vector<size_t> request(const Graph &graph, size_t tensor_idx);
+
+  // Take the tensors loaded since the last call. Tensors loaded in the
+  // meantime by the owner(`graph.tensors[i].loaded`) are dropped.
+  // item = <index to `Graph::tensors`, tensor with its payload>
+  std::vector<std::pair<size_t, Tensor>> fetch(const Graph &graph);
+
+  // Total payload size of prefetched tensors in bytes.
+  size_t prefetched_bytes() const;
+
+ private:
+  void run();
+
+  WeightsLoadOption _option;
+  size_t _budget_bytes = 0;
+  int _max_hops = 2;
+
+  // Tensor -> nodes having the tensor in their inputs or outputs.
+  std::vector<std::vector<size_t>> _tensor_to_nodes;
+
+  // Tensors selected by the last `request`.
+  std::set<size_t> _planned;
+
+  // Prefetched tensors installed to the graph and not selected yet.
+  // <tensor index, payload size>
+  std::map<size_t, size_t> _prefetched;
+
+  std::thread _worker;
+  std::atomic<bool> _stop{false};
+
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  std::deque<std::pair<size_t, Tensor>> _queue;    // Guarded by `_mutex`.
+  std::set<size_t> _inflight;                      // Guarded by `_mutex`.
+  std::vector<std::pair<size_t, Tensor>> _loaded;  // Guarded by `_mutex`.
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_TENSOR_PREFETCHER_H_
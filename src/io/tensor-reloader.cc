@@ -0,0 +1,133 @@
+#include "io/tensor-reloader.hh"
+#include "io/npy-loader.hh"
+#include "io/path-util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace nnview {
+
+namespace {
+
+// Timeout of a wait, which bounds the latency of `stop`.
+constexpr int kWaitTimeoutMs = 250;
+
+// Writers often rewrite several files in a row. Collect changes for this long
+// after the first one before reloading.
+constexpr int kSettleTimeMs = 100;
+
+}  // namespace
+
+static bool IsWatchable(const std::string &filename) {
+  const std::string ext = GetFileExtension(filename);
+  return (ext.compare(".weights") == 0) || (ext.compare(".tensor") == 0) ||
+         (ext.compare(".npy") == 0);
+}
+
+TensorReloader::~TensorReloader() { stop(); }
+
+bool TensorReloader::start(const Graph &graph,
+                           const WeightsLoadOption &option) {
+  stop();
+
+  _option = option;
+  // Loading a file being replaced through io_uring buys nothing here, and a
+  // mapping of it breaks(SIGBUS) when the writer truncates it.
+  _option.use_io_uring = false;
+  _option.use_mmap = false;
+  _option.progress = nullptr;
+
+  _file_to_tensors.clear();
+  _tensor_names.clear();
+  for (size_t i = 0; i < graph.tensors.size(); i++) {
+    const Tensor &tensor = graph.tensors[i];
+    _tensor_names.push_back(tensor.name);
+    if (IsWatchable(tensor.source_filename)) {
+      _file_to_tensors[tensor.source_filename].push_back(i);
+    }
+  }
+
+  std::vector<std::string> filenames;
+  for (const auto &item : _file_to_tensors) {
+    filenames.push_back(item.first);
+  }
+  if (filenames.empty() || !_watcher.watch(filenames)) {
+    std::cerr << "No weight/tensor file to watch.\n";
+    return false;
+  }
+
+  std::cout << "Watching " << filenames.size() << " weight/tensor files.\n";
+
+  _stop = false;
+  _worker = std::thread([this]() { run(); });
+
+  return true;
+}
+
+void TensorReloader::stop() {
+  _stop = true;
+  if (_worker.joinable()) {
+    _worker.join();
+  }
+}
+
+std::vector<std::pair<size_t, Tensor>> TensorReloader::fetch() {
+  std::vector<std::pair<size_t, Tensor>> reloaded;
+  std::lock_guard<std::mutex> lock(_mutex);
+  reloaded.swap(_reloaded);
+  return reloaded;
+}
+
+void TensorReloader::run() {
+  while (!_stop) {
+    std::vector<std::string> changed = _watcher.wait(kWaitTimeoutMs);
+    if (changed.empty()) {
+      continue;
+    }
+
+    const auto settle_end = std::chrono::steady_clock::now() +
+                            std::chrono::milliseconds(kSettleTimeMs);
+    while (!_stop && (std::chrono::steady_clock::now() < settle_end)) {
+      std::vector<std::string> more = _watcher.wait(kSettleTimeMs);
+      changed.insert(changed.end(), more.begin(), more.end());
+    }
+
+    // `wait` returns each file once, but the settle loop may add it again.
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    for (const auto &filename : changed) {
+      if (_stop) {
+        break;
+      }
+
+      auto it = _file_to_tensors.find(filename);
+      if (it == _file_to_tensors.end()) {
+        continue;
+      }
+
+      for (const size_t idx : it->second) {
+        Tensor tensor;
+        const bool ret =
+            (GetFileExtension(filename).compare(".npy") == 0)
+                ? load_npy(filename, &tensor, _option)
+                : load_weights(filename, &tensor, _option);
+        if (!ret) {
+          // Keep the current tensor. The next rewrite triggers another
+          // reload.
+          std::cerr << "Failed to reload : " << filename << "\n";
+          continue;
+        }
+        tensor.name = _tensor_names[idx];
+
+        std::cout << "Reloaded tensor : " << tensor.name << "\n";
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _reloaded.emplace_back(idx, std::move(tensor));
+      }
+    }
+  }
+}
+
+}  // namespace nnview
@@ -0,0 +1,66 @@
+#ifndef NNVIEW_IO_TENSOR_RELOADER_H_
+#define NNVIEW_IO_TENSOR_RELOADER_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "datatypes.h"
+#include "io/file-watcher.hh"
+#include "io/weights-loader.hh"
+
+//
+// Reload tensors in the background when their .weights/.tensor/.npy files are
+// rewritten(e.g. by a running training job).
+//
+// A worker thread waits for changes with `FileWatcher` and loads only the
+// tensors whose source file changed. Reloaded tensors are handed to the owner
+// of the graph through `fetch`, so the graph itself is only touched by the
+// thread calling `fetch`(the GUI thread).
+//
+namespace nnview {
+
+class TensorReloader {
+ public:
+  TensorReloader() {}
+  ~TensorReloader();
+
+  TensorReloader(const TensorReloader &) = delete;
+  TensorReloader &operator=(const TensorReloader &) = delete;
+
+  // Start watching the source files of `graph.tensors`. Tensors loaded from
+  // container files(archives, NPZ, safetensors, ...) are not watched.
+  // Returns false when there is no file to watch. Reloads never map files.
+  // Load `graph` without `use_mmap` too, since a writer truncates the file
+  // under the mapping.
+  bool start(const Graph &graph,
+             const WeightsLoadOption &option = WeightsLoadOption());
+
+  void stop();
+
+  // Take the tensors reloaded since the last call.
+  // item = <index to `Graph::tensors`, reloaded tensor>
+  std::vector<std::pair<size_t, Tensor>> fetch();
+
+ private:
+  void run();
+
+  WeightsLoadOption _option;
+  FileWatcher _watcher;
+  std::map<std::string, std::vector<size_t>> _file_to_tensors;
+  std::vector<std::string> _tensor_names;
+
+  std::thread _worker;
+  std::atomic<bool> _stop{false};
+
+  std::mutex _mutex;
+  std::vector<std::pair<size_t, Tensor>> _reloaded;  // Guarded by `_mutex`.
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_TENSOR_RELOADER_H_
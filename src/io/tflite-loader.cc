@@ -0,0 +1,605 @@
+#include "io/tflite-loader.hh"
+#include "io/graph-loader.hh"
+#include "io/mapped-file.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace nnview {
+
+namespace {
+
+// Field index in tflite schema(schema.fbs)
+enum {
+  kModelOperatorCodes = 1,
+  kModelSubgraphs = 2,
+  kModelBuffers = 4,
+
+  kOperatorCodeDeprecatedBuiltinCode = 0,
+  kOperatorCodeCustomCode = 1,
+  kOperatorCodeBuiltinCode = 3,
+
+  kSubGraphTensors = 0,
+  kSubGraphInputs = 1,
+  kSubGraphOutputs = 2,
+  kSubGraphOperators = 3,
+
+  kTensorShape = 0,
+  kTensorType = 1,
+  kTensorBuffer = 2,
+  kTensorName = 3,
+
+  kOperatorOpcodeIndex = 0,
+  kOperatorInputs = 1,
+  kOperatorOutputs = 2,
+
+  kBufferData = 0,
+  kBufferOffset = 1,
+  kBufferSize = 2,
+};
+
+// TensorType enum in tflite schema.
+constexpr int8_t kTensorTypeFloat32 = 0;
+constexpr int8_t kTensorTypeFloat16 = 1;
+constexpr int8_t kTensorTypeInt32 = 2;
+constexpr int8_t kTensorTypeUint8 = 3;
+constexpr int8_t kTensorTypeInt8 = 9;
+constexpr int8_t kTensorTypeFloat64 = 10;
+
+constexpr int32_t kBuiltinConv2D = 3;
+constexpr int32_t kBuiltinDepthwiseConv2D = 4;
+constexpr int32_t kBuiltinFullyConnected = 9;
+constexpr int32_t kBuiltinRelu = 19;
+constexpr int32_t kBuiltinCustom = 32;
+
+// BuiltinOperator enum in tflite schema.
+const char *kBuiltinOperatorNames[] = {
+    "ADD",
+    "AVERAGE_POOL_2D",
+    "CONCATENATION",
+    "CONV_2D",
+    "DEPTHWISE_CONV_2D",
+    "DEPTH_TO_SPACE",
+    "DEQUANTIZE",
+    "EMBEDDING_LOOKUP",
+    "FLOOR",
+    "FULLY_CONNECTED",
+    "HASHTABLE_LOOKUP",
+    "L2_NORMALIZATION",
+    "L2_POOL_2D",
+    "LOCAL_RESPONSE_NORMALIZATION",
+    "LOGISTIC",
+    "LSH_PROJECTION",
+    "LSTM",
+    "MAX_POOL_2D",
+    "MUL",
+    "RELU",
+    "RELU_N1_TO_1",
+    "RELU6",
+    "RESHAPE",
+    "RESIZE_BILINEAR",
+    "RNN",
+    "SOFTMAX",
+    "SPACE_TO_DEPTH",
+    "SVDF",
+    "TANH",
+    "CONCAT_EMBEDDINGS",
+    "SKIP_GRAM",
+    "CALL",
+    "CUSTOM",
+    "EMBEDDING_LOOKUP_SPARSE",
+    "PAD",
+    "UNIDIRECTIONAL_SEQUENCE_RNN",
+    "GATHER",
+    "BATCH_TO_SPACE_ND",
+    "SPACE_TO_BATCH_ND",
+    "TRANSPOSE",
+    "MEAN",
+    "SUB",
+    "DIV",
+    "SQUEEZE",
+    "UNIDIRECTIONAL_SEQUENCE_LSTM",
+    "STRIDED_SLICE",
+    "BIDIRECTIONAL_SEQUENCE_RNN",
+    "EXP",
+    "TOPK_V2",
+    "SPLIT",
+    "LOG_SOFTMAX",
+    "DELEGATE",
+    "BIDIRECTIONAL_SEQUENCE_LSTM",
+    "CAST",
+    "PRELU",
+    "MAXIMUM",
+    "ARG_MAX",
+    "MINIMUM",
+    "LESS",
+    "NEG",
+    "PADV2",
+    "GREATER",
+    "GREATER_EQUAL",
+    "LESS_EQUAL",
+    "SELECT",
+    "SLICE",
+    "SIN",
+    "TRANSPOSE_CONV",
+    "SPARSE_TO_DENSE",
+    "TILE",
+    "EXPAND_DIMS",
+    "EQUAL",
+    "NOT_EQUAL",
+    "LOG",
+    "SUM",
+    "SQRT",
+    "RSQRT",
+    "SHAPE",
+    "POW",
+    "ARG_MIN",
+    "FAKE_QUANT",
+    "REDUCE_PROD",
+    "REDUCE_MAX",
+    "PACK",
+    "LOGICAL_OR",
+    "ONE_HOT",
+    "LOGICAL_AND",
+    "LOGICAL_NOT",
+    "UNPACK",
+    "REDUCE_MIN",
+    "FLOOR_DIV",
+    "REDUCE_ANY",
+    "SQUARE",
+    "ZEROS_LIKE",
+    "FILL",
+    "FLOOR_MOD",
+    "RANGE",
+    "RESIZE_NEAREST_NEIGHBOR",
+    "LEAKY_RELU",
+    "SQUARED_DIFFERENCE",
+    "MIRROR_PAD",
+    "ABS",
+    "SPLIT_V",
+    "UNIQUE",
+    "CEIL",
+    "REVERSE_V2",
+    "ADD_N",
+    "GATHER_ND",
+    "COS",
+    "WHERE",
+    "RANK",
+    "ELU",
+    "REVERSE_SEQUENCE",
+    "MATRIX_DIAG",
+    "QUANTIZE",
+    "MATRIX_SET_DIAG",
+    "ROUND",
+    "HARD_SWISH",
+    "IF",
+    "WHILE",
+    "NON_MAX_SUPPRESSION_V4",
+    "NON_MAX_SUPPRESSION_V5",
+    "SCATTER_ND",
+    "SELECT_V2",
+    "DENSIFY",
+    "SEGMENT_SUM",
+    "BATCH_MATMUL",
+};
+
+//
+// Minimal bounds-checked flatbuffer reader.
+// Offset 0 is used as "absent", since the root offset lives there and no
+// table/vector/string can start at 0.
+//
+class FlatBufferReader {
+ public:
+  FlatBufferReader(const uint8_t *data, size_t size)
+      : _data(data), _size(size) {}
+
+  bool valid() const { return _valid; }
+
+  size_t root() { return deref(0); }
+
+  template <typename T>
+  T scalar(size_t table, int field, T default_value) {
+    const size_t pos = field_pos(table, field);
+    if ((pos == 0) || !check(pos, sizeof(T))) {
+      return default_value;
+    }
+    return read<T>(pos);
+  }
+
+  // Table, vector or string referenced by the field. 0 if absent.
+  size_t ref(size_t table, int field) {
+    const size_t pos = field_pos(table, field);
+    if (pos == 0) {
+      return 0;
+    }
+    return deref(pos);
+  }
+
+  size_t vector_length(size_t vec) {
+    if ((vec == 0) || !check(vec, 4)) {
+      return 0;
+    }
+    const size_t len = read<uint32_t>(vec);
+    if (!check(vec + 4, len)) {
+      return 0;
+    }
+    return len;
+  }
+
+  // Position of the first element.
+  size_t vector_data(size_t vec) { return vec + 4; }
+
+  size_t table_at(size_t vec, size_t i) { return deref(vec + 4 + 4 * i); }
+
+  template <typename T>
+  T vector_scalar(size_t vec, size_t i) {
+    const size_t pos = vec + 4 + sizeof(T) * i;
+    if (!check(pos, sizeof(T))) {
+      return T(0);
+    }
+    return read<T>(pos);
+  }
+
+  std::string string_at(size_t str) {
+    if ((str == 0) || !check(str, 4)) {
+      return std::string();
+    }
+    const size_t len = read<uint32_t>(str);
+    if (!check(str + 4, len)) {
+      return std::string();
+    }
+    return std::string(reinterpret_cast<const char *>(_data + str + 4), len);
+  }
+
+  bool check(size_t pos, size_t len) {
+    if ((pos > _size) || (len > _size - pos)) {
+      _valid = false;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  // NOTE: Assume little-endian host.
+  template <typename T>
+  T read(size_t pos) const {
+    T v;
+    memcpy(&v, _data + pos, sizeof(T));
+    return v;
+  }
+
+  size_t deref(size_t pos) {
+    if (!check(pos, 4)) {
+      return 0;
+    }
+    const size_t target = pos + read<uint32_t>(pos);
+    if (!check(target, 4)) {
+      return 0;
+    }
+    return target;
+  }
+
+  size_t field_pos(size_t table, int field) {
+    if ((table == 0) || !check(table, 4)) {
+      return 0;
+    }
+
+    const int64_t vtable = int64_t(table) - int64_t(read<int32_t>(table));
+    if ((vtable < 0) || !check(size_t(vtable), 4)) {
+      return 0;
+    }
+
+    const size_t vtable_size = read<uint16_t>(size_t(vtable));
+    const size_t idx = 4 + 2 * size_t(field);
+    if ((idx + 2 > vtable_size) || !check(size_t(vtable) + idx, 2)) {
+      return 0;
+    }
+
+    const size_t offset = read<uint16_t>(size_t(vtable) + idx);
+    if (offset == 0) {
+      return 0;
+    }
+
+    return table + offset;
+  }
+
+  const uint8_t *_data = nullptr;
+  size_t _size = 0;
+  bool _valid = true;
+};
+
+}  // namespace
+
+static bool GetDataType(int8_t type, DataType *dtype) {
+  switch (type) {
+    case kTensorTypeFloat32:
+      (*dtype) = DTYPE_FLOAT32;
+      return true;
+    case kTensorTypeFloat16:
+      (*dtype) = DTYPE_FLOAT16;
+      return true;
+    case kTensorTypeInt32:
+      (*dtype) = DTYPE_INT32;
+      return true;
+    case kTensorTypeUint8:
+      (*dtype) = DTYPE_UINT8;
+      return true;
+    case kTensorTypeInt8:
+      (*dtype) = DTYPE_INT8;
+      return true;
+    case kTensorTypeFloat64:
+      (*dtype) = DTYPE_FLOAT64;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static int32_t GetOperatorCode(FlatBufferReader &fb, size_t opcode) {
+  // `builtin_code` was added when the number of operators exceeded 127.
+  // Older models only have `deprecated_builtin_code`.
+  const int32_t deprecated_code = fb.scalar<int8_t>(
+      opcode, kOperatorCodeDeprecatedBuiltinCode, int8_t(0));
+  return std::max(deprecated_code, fb.scalar<int32_t>(
+                                       opcode, kOperatorCodeBuiltinCode,
+                                       int32_t(0)));
+}
+
+static std::string GetOperatorName(FlatBufferReader &fb, size_t opcode) {
+  const int32_t code = GetOperatorCode(fb, opcode);
+
+  if (code == kBuiltinCustom) {
+    std::string name = fb.string_at(fb.ref(opcode, kOperatorCodeCustomCode));
+    return name.empty() ? "CUSTOM" : name;
+  }
+
+  const int32_t num_names =
+      int32_t(sizeof(kBuiltinOperatorNames) / sizeof(kBuiltinOperatorNames[0]));
+  if ((code >= 0) && (code < num_names)) {
+    return kBuiltinOperatorNames[code];
+  }
+
+  return "BUILTIN_" + std::to_string(code);
+}
+
+static std::string GetInputSlotName(int32_t code, size_t i) {
+  if ((code == kBuiltinConv2D) || (code == kBuiltinDepthwiseConv2D) ||
+      (code == kBuiltinFullyConnected)) {
+    // input, weights, bias
+    if (i == 1) {
+      return "W";
+    } else if (i == 2) {
+      return "b";
+    }
+  }
+
+  return (i == 0) ? "input" : ("input" + std::to_string(i));
+}
+
+bool load_tflite_graph(const std::string &filename, Graph *graph) {
+  if (graph == nullptr) {
+    std::cerr << "`graph` is nullptr\n";
+    return false;
+  }
+
+  std::shared_ptr<MappedFile> mapping = MappedFile::open(filename);
+  if (!mapping) {
+    return false;
+  }
+
+  const uint8_t *data = mapping->data();
+  const size_t size = mapping->size();
+
+  if ((size < 8) || (memcmp(data + 4, "TFL3", 4) != 0)) {
+    std::cerr << "Not a TFLite model(file identifier mismatch) : " << filename
+              << std::endl;
+    return false;
+  }
+
+  FlatBufferReader fb(data, size);
+
+  const size_t model = fb.root();
+  const size_t opcodes = fb.ref(model, kModelOperatorCodes);
+  const size_t subgraphs = fb.ref(model, kModelSubgraphs);
+  const size_t buffers = fb.ref(model, kModelBuffers);
+
+  if (fb.vector_length(subgraphs) == 0) {
+    std::cerr << "No subgraph in TFLite model : " << filename << std::endl;
+    return false;
+  }
+
+  if (fb.vector_length(subgraphs) > 1) {
+    std::cout << "TFLite model has " << fb.vector_length(subgraphs)
+              << " subgraphs. Only the first one is loaded.\n";
+  }
+
+  const size_t subgraph = fb.table_at(subgraphs, 0);
+  const size_t tensors = fb.ref(subgraph, kSubGraphTensors);
+  const size_t inputs = fb.ref(subgraph, kSubGraphInputs);
+  const size_t outputs = fb.ref(subgraph, kSubGraphOutputs);
+  const size_t operators = fb.ref(subgraph, kSubGraphOperators);
+
+  graph->inputs.clear();
+  graph->outputs.clear();
+  graph->nodes.clear();
+  graph->tensors.clear();
+  graph->symbols.clear();
+
+  SymbolTable &symbols = graph->symbols;
+  const Symbol input_sym = symbols.intern("input");
+  const Symbol output_sym = symbols.intern("output");
+
+  // Tensors. Tensor id = index in the subgraph.
+  const size_t num_tensors = fb.vector_length(tensors);
+  const size_t num_buffers = fb.vector_length(buffers);
+  for (size_t i = 0; i < num_tensors; i++) {
+    const size_t t = fb.table_at(tensors, i);
+
+    Tensor tensor;
+    tensor.name = fb.string_at(fb.ref(t, kTensorName));
+    if (tensor.name.empty()) {
+      tensor.name = "tensor_" + std::to_string(i);
+    }
+
+    const size_t shape = fb.ref(t, kTensorShape);
+    const size_t rank = fb.vector_length(shape);
+    tensor.num_items = 1;
+    for (size_t r = 0; r < rank; r++) {
+      // Unknown(dynamic) dimension is -1.
+      const int32_t d = std::max(1, fb.vector_scalar<int32_t>(shape, r));
+      const uint64_t max_items = std::numeric_limits<uint64_t>::max();
+      if (uint64_t(tensor.num_items) > max_items / uint64_t(d)) {
+        std::cerr << "Shape of tensor `" << tensor.name
+                  << "` is too large. filename : " << filename << std::endl;
+        return false;
+      }
+      tensor.shape.push_back(int(d));
+      tensor.num_items *= size_t(d);
+    }
+    // Force create 2D tensor as done in `load_weights`.
+    while (tensor.shape.size() < 2) {
+      tensor.shape.push_back(1);
+    }
+
+    // Activation tensors have no data.
+    tensor.loaded = false;
+
+    const int8_t type = fb.scalar<int8_t>(t, kTensorType, kTensorTypeFloat32);
+    const uint32_t buffer_idx = fb.scalar<uint32_t>(t, kTensorBuffer, 0);
+
+    // Buffer 0 is an empty sentinel buffer.
+    if (GetDataType(type, &tensor.dtype) && (buffer_idx > 0) &&
+        (buffer_idx < num_buffers)) {
+      const size_t buffer = fb.table_at(buffers, buffer_idx);
+      const size_t buffer_data = fb.ref(buffer, kBufferData);
+
+      size_t data_offset = 0;
+      size_t data_size = fb.vector_length(buffer_data);
+      if (data_size > 0) {
+        data_offset = fb.vector_data(buffer_data);
+      } else {
+        // Model larger than 2GB stores buffers outside of the flatbuffer.
+        // `offset` is relative to the beginning of the file.
+        const uint64_t offset =
+            fb.scalar<uint64_t>(buffer, kBufferOffset, uint64_t(0));
+        if (offset > 1) {
+          data_offset = size_t(offset);
+          data_size =
+              size_t(fb.scalar<uint64_t>(buffer, kBufferSize, uint64_t(0)));
+        }
+      }
+
+      // NOTE: Quantization parameters(scale, zero_point) are not applied.
+      // int8/uint8 tensors are shown with their raw integer values.
+      // Compare the item count first so that the byte size does not wrap.
+      if ((data_size > 0) &&
+          (tensor.num_items <= data_size / get_dtype_size(tensor.dtype)) &&
+          (data_size == tensor.byte_size()) &&
+          fb.check(data_offset, data_size)) {
+        tensor.source_filename = filename;
+        tensor.source_offset = data_offset;
+        tensor.mapping = mapping;
+        tensor.mapped_data = data + data_offset;
+        tensor.loaded = true;
+      }
+    }
+
+    graph->tensors.push_back(std::move(tensor));
+  }
+
+  // `input` node for each graph input.
+  for (size_t i = 0; i < fb.vector_length(inputs); i++) {
+    const int32_t tensor_id = fb.vector_scalar<int32_t>(inputs, i);
+    if ((tensor_id < 0) || (size_t(tensor_id) >= num_tensors)) {
+      continue;
+    }
+    const std::string &name = graph->tensors[size_t(tensor_id)].name;
+    const Symbol sym = symbols.intern(name);
+
+    Node node;
+    node.type = LAYER_INPUT;
+    node.name = name;
+    node.id = int(graph->nodes.size());
+    node.outputs.push_back(Slot(sym, output_sym, tensor_id));
+    graph->nodes.push_back(node);
+
+    graph->inputs.push_back(Slot(sym, input_sym, tensor_id));
+  }
+
+  for (size_t i = 0; i < fb.vector_length(outputs); i++) {
+    const int32_t tensor_id = fb.vector_scalar<int32_t>(outputs, i);
+    if ((tensor_id < 0) || (size_t(tensor_id) >= num_tensors)) {
+      continue;
+    }
+    graph->outputs.push_back(
+        Slot(symbols.intern(graph->tensors[size_t(tensor_id)].name),
+             output_sym, tensor_id));
+  }
+
+  // Operators are stored in execution order.
+  const size_t num_opcodes = fb.vector_length(opcodes);
+  for (size_t i = 0; i < fb.vector_length(operators); i++) {
+    const size_t op = fb.table_at(operators, i);
+    const uint32_t opcode_idx =
+        fb.scalar<uint32_t>(op, kOperatorOpcodeIndex, 0);
+
+    std::string op_name = "UNKNOWN";
+    int32_t code = -1;
+    if (opcode_idx < num_opcodes) {
+      const size_t opcode = fb.table_at(opcodes, opcode_idx);
+      op_name = GetOperatorName(fb, opcode);
+      code = GetOperatorCode(fb, opcode);
+    }
+
+    Node node;
+    node.name = op_name + "-" + std::to_string(i);
+    node.id = int(graph->nodes.size());
+    if (code == kBuiltinFullyConnected) {
+      node.type = LAYER_LINEAR_FUNCTION;
+    } else if (code == kBuiltinRelu) {
+      node.type = LAYER_RELU;
+    }
+
+    const size_t op_inputs = fb.ref(op, kOperatorInputs);
+    for (size_t k = 0; k < fb.vector_length(op_inputs); k++) {
+      // -1 = omitted optional input.
+      const int32_t tensor_id = fb.vector_scalar<int32_t>(op_inputs, k);
+      if ((tensor_id < 0) || (size_t(tensor_id) >= num_tensors)) {
+        continue;
+      }
+      node.inputs.push_back(
+          Slot(symbols.intern(graph->tensors[size_t(tensor_id)].name),
+               symbols.intern(GetInputSlotName(code, k)), tensor_id));
+    }
+
+    const size_t op_outputs = fb.ref(op, kOperatorOutputs);
+    for (size_t k = 0; k < fb.vector_length(op_outputs); k++) {
+      const int32_t tensor_id = fb.vector_scalar<int32_t>(op_outputs, k);
+      if ((tensor_id < 0) || (size_t(tensor_id) >= num_tensors)) {
+        continue;
+      }
+      node.outputs.push_back(
+          Slot(symbols.intern(graph->tensors[size_t(tensor_id)].name),
+               output_sym, tensor_id));
+    }
+
+    graph->nodes.push_back(node);
+  }
+
+  if (!fb.valid()) {
+    std::cerr << "TFLite model is corrupted(out of range access) : "
+              << filename << std::endl;
+    return false;
+  }
+
+  compute_node_depth(graph);
+
+  std::cout << "TFLite model : " << graph->nodes.size() << " nodes, "
+            << graph->tensors.size() << " tensors\n";
+
+  return true;
+}
+
+}  // namespace nnview
@@ -0,0 +1,23 @@
+#ifndef NNVIEW_IO_TFLITE_LOADER_H_
+#define NNVIEW_IO_TFLITE_LOADER_H_
+
+#include <string>
+
+#include "datatypes.h"
+
+//
+// Loader for TensorFlow Lite model(.tflite, Flatbuffers format).
+//
+// The flatbuffer is walked in place on the memory-mapped file. No flatbuffers
+// library or generated code is required.
+// Operators in the first subgraph become `Node`s, and constant float32
+// buffers(weights) are exposed as `Tensor` views into the mapped file.
+// Other tensors(activations, quantized weights) only have shape information.
+//
+namespace nnview {
+
+bool load_tflite_graph(const std::string &filename, Graph *graph);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_TFLITE_LOADER_H_
@@ -0,0 +1,521 @@
+#include "io/uring-reader.hh"
+
+#if defined(NNVIEW_WITH_IO_URING)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace nnview {
+
+#if defined(NNVIEW_WITH_IO_URING)
+
+namespace {
+
+// Maximum size of a single read. Also the size of a bounce buffer for
+// O_DIRECT reads.
+constexpr size_t kChunkSize = 8 * 1024 * 1024;
+constexpr uint64_t kDirectAlignment = 4096;
+
+inline uint64_t AlignDown(uint64_t x) { return x & ~(kDirectAlignment - 1); }
+inline uint64_t AlignUp(uint64_t x) {
+  return (x + kDirectAlignment - 1) & ~(kDirectAlignment - 1);
+}
+
+template <typename T>
+inline T *RingPtr(void *base, uint32_t offset) {
+  return static_cast<T *>(
+      static_cast<void *>(static_cast<uint8_t *>(base) + offset));
+}
+
+//
+// Minimal io_uring wrapper on top of raw system calls.
+//
+class Uring {
+ public:
+  Uring() {}
+  ~Uring() { close(); }
+
+  Uring(const Uring &) = delete;
+  Uring &operator=(const Uring &) = delete;
+
+  bool init(unsigned entries) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    const long fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) {
+      return false;
+    }
+    _fd = int(fd);
+
+    _sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+    }
+
+    _sq_ring = mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    if (_sq_ring == MAP_FAILED) {
+      _sq_ring = nullptr;
+      return false;
+    }
+
+    if (single_mmap) {
+      _cq_ring = _sq_ring;
+    } else {
+      _cq_ring = mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+      if (_cq_ring == MAP_FAILED) {
+        _cq_ring = nullptr;
+        return false;
+      }
+    }
+
+    _sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+    _sqes = static_cast<io_uring_sqe *>(sqes);
+
+    _sq_head = RingPtr<unsigned>(_sq_ring, p.sq_off.head);
+    _sq_tail = RingPtr<unsigned>(_sq_ring, p.sq_off.tail);
+    _sq_mask = *RingPtr<unsigned>(_sq_ring, p.sq_off.ring_mask);
+    _sq_entries = *RingPtr<unsigned>(_sq_ring, p.sq_off.ring_entries);
+    _sq_array = RingPtr<unsigned>(_sq_ring, p.sq_off.array);
+    _sq_local_tail = *_sq_tail;
+
+    _cq_head = RingPtr<unsigned>(_cq_ring, p.cq_off.head);
+    _cq_tail = RingPtr<unsigned>(_cq_ring, p.cq_off.tail);
+    _cq_mask = *RingPtr<unsigned>(_cq_ring, p.cq_off.ring_mask);
+    _cqes = RingPtr<io_uring_cqe>(_cq_ring, p.cq_off.cqes);
+
+    return true;
+  }
+
+  // Returns nullptr when the submission queue is full.
+  io_uring_sqe *get_sqe() {
+    const unsigned head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+    if (_sq_local_tail - head >= _sq_entries) {
+      return nullptr;
+    }
+
+    const unsigned idx = _sq_local_tail & _sq_mask;
+    _sq_array[idx] = idx;
+    _sq_local_tail++;
+    _num_pending++;
+
+    io_uring_sqe *sqe = &_sqes[idx];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    return sqe;
+  }
+
+  // Submit pending entries and wait for at least `wait_nr` completions.
+  bool submit_and_wait(unsigned wait_nr) {
+    __atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+
+    for (;;) {
+      const long ret =
+          syscall(__NR_io_uring_enter, _fd, _num_pending, wait_nr,
+                  (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      _num_pending -= std::min(_num_pending, unsigned(ret));
+      _num_submitted += unsigned(ret);
+      return true;
+    }
+  }
+
+  // Wait until all submitted entries complete and discard their completions.
+  // Entries not submitted yet are never consumed by the kernel. Returns false
+  // when waiting fails.
+  bool drain() {
+    io_uring_cqe cqe;
+    for (;;) {
+      while (pop_cqe(&cqe)) {
+      }
+      if (_num_submitted == 0) {
+        return true;
+      }
+      const long ret = syscall(__NR_io_uring_enter, _fd, 0u, 1u,
+                               IORING_ENTER_GETEVENTS, nullptr, 0);
+      if ((ret < 0) && (errno != EINTR)) {
+        return false;
+      }
+    }
+  }
+
+  // Pop a completion. Returns false when no completion is available.
+  bool pop_cqe(io_uring_cqe *cqe) {
+    const unsigned head = *_cq_head;
+    if (head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+      return false;
+    }
+    (*cqe) = _cqes[head & _cq_mask];
+    __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+    _num_submitted -= std::min(_num_submitted, 1u);
+    return true;
+  }
+
+ private:
+  void close() {
+    if (_sqes) {
+      munmap(_sqes, _sqes_size);
+    }
+    if (_cq_ring && (_cq_ring != _sq_ring)) {
+      munmap(_cq_ring, _cq_ring_size);
+    }
+    if (_sq_ring) {
+      munmap(_sq_ring, _sq_ring_size);
+    }
+    if (_fd >= 0) {
+      ::close(_fd);
+    }
+  }
+
+  int _fd = -1;
+
+  void *_sq_ring = nullptr;
+  size_t _sq_ring_size = 0;
+  void *_cq_ring = nullptr;
+  size_t _cq_ring_size = 0;
+  io_uring_sqe *_sqes = nullptr;
+  size_t _sqes_size = 0;
+
+  unsigned *_sq_head = nullptr;
+  unsigned *_sq_tail = nullptr;
+  unsigned *_sq_array = nullptr;
+  unsigned _sq_mask = 0;
+  unsigned _sq_entries = 0;
+  unsigned _sq_local_tail = 0;
+  unsigned _num_pending = 0;
+  unsigned _num_submitted = 0;  // Submitted and not completed yet.
+
+  unsigned *_cq_head = nullptr;
+  unsigned *_cq_tail = nullptr;
+  unsigned _cq_mask = 0;
+  io_uring_cqe *_cqes = nullptr;
+};
+
+struct FileState {
+  int fd = -1;
+  bool direct = false;
+  bool failed = false;
+  bool finished = false;
+  uint64_t next_offset = 0;  // Offset of the next chunk to be issued.
+  size_t num_remaining = 0;  // Bytes not issued yet.
+  size_t num_inflight = 0;
+};
+
+// A read in flight.
+struct ReadSlot {
+  size_t request = 0;
+  uint64_t offset = 0;  // File offset of `dst`
+  size_t length = 0;
+  uint8_t *dst = nullptr;
+  size_t lead = 0;  // Offset of `offset` from the aligned read offset.
+  iovec iov;
+};
+
+struct FreeDeleter {
+  void operator()(void *p) const { free(p); }
+};
+
+}  // namespace
+
+static bool OpenFile(FileReadRequest *request, const FileReadOption &option,
+                     FileState *state) {
+  int fd = -1;
+  if (option.direct_io) {
+    fd = open(request->filename.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    state->direct = (fd >= 0);
+  }
+  if (fd < 0) {
+    // Some file systems(e.g. tmpfs) do not support O_DIRECT.
+    fd = open(request->filename.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  if (fd < 0) {
+    std::cerr << "Failed to open file : " << request->filename << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    std::cerr << "Failed to stat file : " << request->filename << std::endl;
+    close(fd);
+    return false;
+  }
+
+  state->fd = fd;
+  request->file_size = uint64_t(st.st_size);
+  return true;
+}
+
+static void PrepareRead(const FileState &state, ReadSlot *slot,
+                        uint8_t *bounce, io_uring_sqe *sqe,
+                        uint64_t user_data) {
+  uint64_t read_offset = slot->offset;
+  size_t read_length = slot->length;
+  if (state.direct) {
+    // O_DIRECT requires aligned offset, length and buffer.
+    read_offset = AlignDown(slot->offset);
+    slot->lead = size_t(slot->offset - read_offset);
+    read_length = size_t(AlignUp(slot->lead + slot->length));
+    slot->iov.iov_base = bounce;
+  } else {
+    slot->lead = 0;
+    slot->iov.iov_base = slot->dst;
+  }
+  slot->iov.iov_len = read_length;
+
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = state.fd;
+  sqe->addr = uint64_t(reinterpret_cast<uintptr_t>(&slot->iov));
+  sqe->len = 1;
+  sqe->off = read_offset;
+  sqe->user_data = user_data;
+}
+
+bool is_uring_reader_available() {
+  static const bool available = []() {
+    Uring ring;
+    return ring.init(2);
+  }();
+  return available;
+}
+
+bool read_files_with_uring(std::vector<FileReadRequest> *requests,
+                           const FileReadOption &option) {
+  const unsigned queue_depth = std::max(1u, option.queue_depth);
+
+  Uring ring;
+  if (!ring.init(queue_depth)) {
+    return false;
+  }
+
+  std::vector<FileState> states(requests->size());
+  for (size_t i = 0; i < requests->size(); i++) {
+    FileReadRequest &request = (*requests)[i];
+    request.ok = false;
+    request.bytes_read = 0;
+    states[i].next_offset = request.offset;
+    states[i].num_remaining = request.size;
+  }
+
+  std::vector<ReadSlot> slots(queue_depth);
+  std::vector<std::unique_ptr<uint8_t, FreeDeleter>> bounce_buffers(
+      queue_depth);
+  std::vector<size_t> free_slots;
+  for (size_t i = 0; i < queue_depth; i++) {
+    free_slots.push_back(queue_depth - 1 - i);
+  }
+  // Slots whose read was short and must be issued again.
+  std::vector<size_t> retry_slots;
+
+  auto finish_if_done = [&](size_t r) {
+    FileState &state = states[r];
+    FileReadRequest &request = (*requests)[r];
+    if (state.finished || (state.num_inflight > 0) ||
+        ((state.num_remaining > 0) && !state.failed)) {
+      return;
+    }
+    state.finished = true;
+    if (state.fd >= 0) {
+      close(state.fd);
+      state.fd = -1;
+    }
+    request.ok = !state.failed && (request.allow_short_read ||
+                                   (request.bytes_read == request.size));
+    if (!request.ok && !state.failed) {
+      std::cerr << "Failed to read [" << request.size << "] bytes. only ["
+                << request.bytes_read
+                << "] could be read. filename : " << request.filename
+                << std::endl;
+    }
+  };
+
+  size_t next_request = 0;
+  size_t num_inflight = 0;
+  bool ring_failed = false;
+
+  for (;;) {
+    // Issue reads.
+    while (!retry_slots.empty() || !free_slots.empty()) {
+      size_t s;
+      if (!retry_slots.empty()) {
+        s = retry_slots.back();
+        retry_slots.pop_back();
+      } else {
+        while ((next_request < requests->size()) &&
+               ((states[next_request].num_remaining == 0) ||
+                states[next_request].failed)) {
+          finish_if_done(next_request);
+          next_request++;
+        }
+        if (next_request >= requests->size()) {
+          break;
+        }
+
+        FileReadRequest &request = (*requests)[next_request];
+        FileState &state = states[next_request];
+        if ((state.fd < 0) && !OpenFile(&request, option, &state)) {
+          state.failed = true;
+          continue;
+        }
+
+        s = free_slots.back();
+        free_slots.pop_back();
+
+        // Split at `kChunkSize` boundaries of the file offset, so that reads
+        // other than the first and the last one are aligned.
+        ReadSlot &slot = slots[s];
+        slot.request = next_request;
+        slot.offset = state.next_offset;
+        slot.length = std::min(
+            state.num_remaining,
+            size_t(kChunkSize - (state.next_offset % kChunkSize)));
+        slot.dst = request.dst + (state.next_offset - request.offset);
+
+        state.next_offset += slot.length;
+        state.num_remaining -= slot.length;
+        state.num_inflight++;
+        num_inflight++;
+      }
+
+      ReadSlot &slot = slots[s];
+      const FileState &state = states[slot.request];
+      if (state.direct && !bounce_buffers[s]) {
+        void *p = nullptr;
+        if (posix_memalign(&p, kDirectAlignment,
+                           kChunkSize + 2 * kDirectAlignment) != 0) {
+          std::cerr << "Failed to allocate aligned buffer.\n";
+          ring_failed = true;
+          break;
+        }
+        bounce_buffers[s].reset(static_cast<uint8_t *>(p));
+      }
+
+      io_uring_sqe *sqe = ring.get_sqe();
+      if (!sqe) {
+        // Should not happen since the number of slots equals to the queue
+        // depth.
+        retry_slots.push_back(s);
+        break;
+      }
+      PrepareRead(state, &slot, bounce_buffers[s].get(), sqe, uint64_t(s));
+    }
+
+    if (ring_failed || (num_inflight == 0)) {
+      break;
+    }
+
+    if (!ring.submit_and_wait(1)) {
+      std::cerr << "io_uring_enter failed : " << strerror(errno) << std::endl;
+      ring_failed = true;
+      break;
+    }
+
+    // Reap completions.
+    io_uring_cqe cqe;
+    while (ring.pop_cqe(&cqe)) {
+      const size_t s = size_t(cqe.user_data);
+      ReadSlot &slot = slots[s];
+      FileReadRequest &request = (*requests)[slot.request];
+      FileState &state = states[slot.request];
+
+      if ((cqe.res == -EAGAIN) || (cqe.res == -EINTR)) {
+        retry_slots.push_back(s);
+        continue;
+      }
+
+      bool done = true;
+      if (cqe.res < 0) {
+        std::cerr << "Failed to read file : " << request.filename << " ("
+                  << strerror(-cqe.res) << ")" << std::endl;
+        state.failed = true;
+      } else {
+        const size_t n = size_t(cqe.res);
+        size_t got;
+        if (state.direct) {
+          got = (n > slot.lead) ? std::min(slot.length, n - slot.lead) : 0;
+          memcpy(slot.dst, bounce_buffers[s].get() + slot.lead, got);
+        } else {
+          got = std::min(slot.length, n);
+        }
+        request.bytes_read += got;
+
+        if ((got > 0) && (got < slot.length) && !state.direct) {
+          // Short read. Read the rest.
+          slot.offset += got;
+          slot.dst += got;
+          slot.length -= got;
+          retry_slots.push_back(s);
+          done = false;
+        } else if (got < slot.length) {
+          // Reached the end of the file. Stop issuing further reads.
+          state.num_remaining = 0;
+        }
+      }
+
+      if (done) {
+        state.num_inflight--;
+        num_inflight--;
+        free_slots.push_back(s);
+        finish_if_done(slot.request);
+      }
+    }
+  }
+
+  if (ring_failed) {
+    // Reads in flight still write into `slots`, the bounce buffers and the
+    // destination of requests. Wait for them before releasing anything.
+    if (!ring.drain()) {
+      std::cerr << "Failed to wait for io_uring reads in flight : "
+                << strerror(errno) << std::endl;
+      std::abort();
+    }
+    for (size_t i = 0; i < requests->size(); i++) {
+      if (states[i].fd >= 0) {
+        close(states[i].fd);
+      }
+      (*requests)[i].ok = false;
+    }
+    return false;
+  }
+
+  return true;
+}
+
+#else
+
+bool is_uring_reader_available() { return false; }
+
+bool read_files_with_uring(std::vector<FileReadRequest> *requests,
+                           const FileReadOption &option) {
+  (void)requests;
+  (void)option;
+  return false;
+}
+
+#endif
+
+}  // namespace nnview
@@ -0,0 +1,62 @@
+#ifndef NNVIEW_IO_URING_READER_H_
+#define NNVIEW_IO_URING_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// Batched file reader based on Linux io_uring.
+//
+// Reads of many files are submitted to one io_uring instance and completed
+// asynchronously, so the device queue is kept busy instead of issuing one
+// blocking read at a time. io_uring is driven with raw system calls, so
+// liburing is not required.
+//
+// Only available on Linux built with `NNVIEW_WITH_IO_URING`. When the kernel
+// does not support io_uring(or it is disabled by seccomp), the caller must
+// fall back to the regular reader. See `is_uring_reader_available`.
+//
+namespace nnview {
+
+struct FileReadRequest {
+  // Input
+  std::string filename;
+  uint64_t offset = 0;
+  size_t size = 0;
+  uint8_t *dst = nullptr;  // Must have `size` bytes.
+
+  // Accept reading less than `size` bytes when the end of the file is
+  // reached.
+  bool allow_short_read = false;
+
+  // Output
+  bool ok = false;
+  size_t bytes_read = 0;
+  uint64_t file_size = 0;
+};
+
+struct FileReadOption {
+  // Open files with O_DIRECT to bypass the page cache. Reads are issued on
+  // 4 KiB aligned offsets into aligned bounce buffers. Falls back to buffered
+  // reads for the file system which does not support O_DIRECT.
+  bool direct_io = false;
+
+  // The number of reads in flight.
+  unsigned queue_depth = 32;
+};
+
+// Returns true when io_uring can be used in this process.
+bool is_uring_reader_available();
+
+// Read all requests. Returns false when io_uring is not available or the ring
+// fails(no request is complete and the caller must fall back to the regular
+// reader). Otherwise returns true and the result of each request is stored
+// in `FileReadRequest::ok`.
+bool read_files_with_uring(std::vector<FileReadRequest> *requests,
+                           const FileReadOption &option = FileReadOption());
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_URING_READER_H_
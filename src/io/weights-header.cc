@@ -0,0 +1,228 @@
+#include "io/weights-header.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace nnview {
+
+namespace {
+
+inline bool IsSpace(uint8_t c) { return (c == ' ') || (c == '\t'); }
+inline bool IsDigit(uint8_t c) { return (c >= '0') && (c <= '9'); }
+inline bool IsAlpha(uint8_t c) { return (c >= 'a') && (c <= 'z'); }
+
+}  // namespace
+
+WeightsHeaderStatus parse_weights_header(const uint8_t *buf, size_t len,
+                                         WeightsHeader *header) {
+  const uint8_t *p = buf;
+  const uint8_t *end = buf + len;
+
+  auto fail = [&](WeightsHeaderStatus status) {
+    header->error_offset = size_t(p - buf);
+    return status;
+  };
+
+  // 1st line : datasize
+  while ((p < end) && IsSpace(*p)) {
+    p++;
+  }
+  int datasize = 0;
+  const uint8_t *digits = p;
+  while ((p < end) && IsDigit(*p) && (p - digits < 3)) {
+    datasize = datasize * 10 + int(*p - '0');
+    p++;
+  }
+  const uint8_t *digits_end = p;
+  while ((p < end) && IsSpace(*p)) {
+    p++;
+  }
+
+  // Optional layout of the sparse variant.
+  header->layout = WEIGHTS_LAYOUT_DENSE;
+  if ((digits_end != digits) && (p < end) && IsAlpha(*p)) {
+    const uint8_t *word = p;
+    while ((p < end) && IsAlpha(*p)) {
+      p++;
+    }
+    if (p == end) {
+      return fail(WEIGHTS_HEADER_INCOMPLETE);
+    }
+    const size_t n = size_t(p - word);
+    if ((n == 3) && (memcmp(word, "csr", 3) == 0)) {
+      header->layout = WEIGHTS_LAYOUT_CSR;
+    } else if ((n == 3) && (memcmp(word, "coo", 3) == 0)) {
+      header->layout = WEIGHTS_LAYOUT_COO;
+    } else {
+      p = word;
+      return fail(WEIGHTS_HEADER_INVALID_LAYOUT);
+    }
+  }
+
+  while ((p < end) && (IsSpace(*p) || (*p == '\r'))) {
+    p++;
+  }
+  if (p == end) {
+    return fail(WEIGHTS_HEADER_INCOMPLETE);
+  }
+  if ((digits_end == digits) || (*p != '\n')) {
+    return fail(WEIGHTS_HEADER_INVALID_DATASIZE);
+  }
+  p++;
+
+  // chainer-trt only records the size of an element, so assume the floating
+  // point type for 2/4/8 bytes and int8(TensorRT INT8 mode) for 1 byte.
+  if (datasize == 4) {
+    header->dtype = DTYPE_FLOAT32;
+  } else if (datasize == 2) {
+    header->dtype = DTYPE_FLOAT16;
+  } else if (datasize == 1) {
+    header->dtype = DTYPE_INT8;
+  } else if (datasize == 8) {
+    header->dtype = DTYPE_FLOAT64;
+  } else {
+    p = digits;
+    return fail(WEIGHTS_HEADER_INVALID_DATASIZE);
+  }
+
+  // 2nd line : shape
+  // Total byte size must fit in both int64(file offset) and size_t(memory).
+  const uint64_t max_bytes =
+      std::min(uint64_t(std::numeric_limits<int64_t>::max()),
+               uint64_t(std::numeric_limits<size_t>::max()));
+  const uint64_t max_items = max_bytes / get_dtype_size(header->dtype);
+  const uint64_t max_dim = uint64_t(std::numeric_limits<int>::max());
+
+  uint64_t num_items = 1;
+  header->rank = 0;
+  for (;;) {
+    while ((p < end) && (IsSpace(*p) || (*p == ',') || (*p == '\r'))) {
+      p++;
+    }
+    if (p == end) {
+      return fail(WEIGHTS_HEADER_INCOMPLETE);
+    }
+    if (*p == '\n') {
+      p++;
+      break;
+    }
+    if (!IsDigit(*p)) {
+      return fail(WEIGHTS_HEADER_INVALID_DIMENSION);
+    }
+
+    const uint8_t *begin = p;
+    uint64_t d = 0;
+    while ((p < end) && IsDigit(*p)) {
+      d = d * 10 + uint64_t(*p - '0');
+      if (d > max_dim) {
+        p = begin;
+        return fail(WEIGHTS_HEADER_INVALID_DIMENSION);
+      }
+      p++;
+    }
+    if (d == 0) {
+      p = begin;
+      return fail(WEIGHTS_HEADER_INVALID_DIMENSION);
+    }
+    if (header->rank >= kMaxWeightsRank) {
+      p = begin;
+      return fail(WEIGHTS_HEADER_TOO_MANY_DIMENSIONS);
+    }
+    if (num_items > max_items / d) {
+      p = begin;
+      return fail(WEIGHTS_HEADER_TOO_LARGE);
+    }
+
+    header->shape[header->rank++] = int(d);
+    num_items *= d;
+  }
+
+  if (header->rank == 0) {
+    return fail(WEIGHTS_HEADER_EMPTY_SHAPE);
+  }
+
+  // 3rd line of the sparse variant : nnz
+  header->nnz = 0;
+  if (header->layout != WEIGHTS_LAYOUT_DENSE) {
+    while ((p < end) && IsSpace(*p)) {
+      p++;
+    }
+    const uint8_t *begin = p;
+    uint64_t nnz = 0;
+    while ((p < end) && IsDigit(*p)) {
+      nnz = nnz * 10 + uint64_t(*p - '0');
+      if (nnz > num_items) {
+        p = begin;
+        return fail(WEIGHTS_HEADER_INVALID_NNZ);
+      }
+      p++;
+    }
+    const uint8_t *nnz_end = p;
+    while ((p < end) && (IsSpace(*p) || (*p == '\r'))) {
+      p++;
+    }
+    if (p == end) {
+      return fail(WEIGHTS_HEADER_INCOMPLETE);
+    }
+    if ((nnz_end == begin) || (*p != '\n')) {
+      return fail(WEIGHTS_HEADER_INVALID_NNZ);
+    }
+    p++;
+
+    // Indices(8 bytes per nonzero at most) and values must fit as well.
+    const uint64_t entry_size = 8 + get_dtype_size(header->dtype);
+    if (nnz > (max_bytes - 8 * (uint64_t(header->shape[0]) + 1)) /
+                  entry_size) {
+      p = begin;
+      return fail(WEIGHTS_HEADER_TOO_LARGE);
+    }
+    header->nnz = size_t(nnz);
+  }
+
+  header->num_items = size_t(num_items);
+  header->header_size = size_t(p - buf);
+  header->error_offset = 0;
+
+  return WEIGHTS_HEADER_OK;
+}
+
+const char *get_weights_header_status_string(WeightsHeaderStatus status) {
+  switch (status) {
+    case WEIGHTS_HEADER_OK:
+      return "OK";
+    case WEIGHTS_HEADER_INCOMPLETE:
+      return "Header is incomplete";
+    case WEIGHTS_HEADER_INVALID_DATASIZE:
+      return "Data size must be 1, 2, 4 or 8";
+    case WEIGHTS_HEADER_INVALID_LAYOUT:
+      return "Layout must be csr or coo";
+    case WEIGHTS_HEADER_INVALID_NNZ:
+      return "Invalid number of nonzeros";
+    case WEIGHTS_HEADER_INVALID_DIMENSION:
+      return "Invalid dimension in shape";
+    case WEIGHTS_HEADER_EMPTY_SHAPE:
+      return "Shape is empty";
+    case WEIGHTS_HEADER_TOO_MANY_DIMENSIONS:
+      return "Too many dimensions in shape";
+    case WEIGHTS_HEADER_TOO_LARGE:
+      return "Tensor is too large";
+  }
+  return "Unknown error";
+}
+
+uint64_t get_weights_payload_size(const WeightsHeader &header) {
+  const uint64_t element_size = get_dtype_size(header.dtype);
+  const uint64_t nnz = header.nnz;
+  switch (header.layout) {
+    case WEIGHTS_LAYOUT_DENSE:
+      break;
+    case WEIGHTS_LAYOUT_CSR:
+      return 8 * (uint64_t(header.shape[0]) + 1) + (4 + element_size) * nnz;
+    case WEIGHTS_LAYOUT_COO:
+      return (8 + element_size) * nnz;
+  }
+  return uint64_t(header.num_items) * element_size;
+}
+
+}  // namespace nnview
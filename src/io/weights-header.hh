@@ -0,0 +1,76 @@
+#ifndef NNVIEW_IO_WEIGHTS_HEADER_H_
+#define NNVIEW_IO_WEIGHTS_HEADER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "datatypes.h"
+
+//
+// Allocation-free parser of the text header of .weights/.tensor files
+// generated by chainer-trt.
+//
+// datasize\n
+// size0,size1,...\n
+//
+// Sparse variant(for pruned weights):
+//
+// datasize csr|coo\n
+// size0,size1,...\n
+// nnz\n
+//
+// The tensor is viewed as a matrix of size0 rows and size1 x ... columns.
+// The payload of `csr` is row pointers((rows + 1) x uint64), column indices
+// (nnz x uint32) and values(nnz x datasize). The payload of `coo` is row
+// indices(nnz x uint32), column indices(nnz x uint32) and values(nnz x
+// datasize). All little-endian. See sparse-storage.hh.
+//
+// The parser works on any buffer holding the beginning of the file(a mapped
+// file or a small stack buffer). Dimensions may be separated by ',' and/or
+// spaces. CR before LF is accepted.
+//
+namespace nnview {
+
+constexpr int kMaxWeightsRank = 32;
+
+enum WeightsLayout {
+  WEIGHTS_LAYOUT_DENSE,
+  WEIGHTS_LAYOUT_CSR,
+  WEIGHTS_LAYOUT_COO,
+};
+
+struct WeightsHeader {
+  DataType dtype = DTYPE_FLOAT32;
+  WeightsLayout layout = WEIGHTS_LAYOUT_DENSE;
+  int rank = 0;
+  int shape[kMaxWeightsRank];
+  size_t num_items = 0;     // Product of `shape`
+  size_t nnz = 0;           // Number of nonzeros. Sparse layouts only.
+  size_t header_size = 0;   // Byte offset of the payload.
+  size_t error_offset = 0;  // Byte offset where parsing failed.
+};
+
+enum WeightsHeaderStatus {
+  WEIGHTS_HEADER_OK,
+  WEIGHTS_HEADER_INCOMPLETE,  // Buffer ends before the last line feed.
+  WEIGHTS_HEADER_INVALID_DATASIZE,
+  WEIGHTS_HEADER_INVALID_LAYOUT,
+  WEIGHTS_HEADER_INVALID_NNZ,
+  WEIGHTS_HEADER_INVALID_DIMENSION,
+  WEIGHTS_HEADER_EMPTY_SHAPE,
+  WEIGHTS_HEADER_TOO_MANY_DIMENSIONS,
+  WEIGHTS_HEADER_TOO_LARGE,  // Byte size overflows int64 or size_t.
+};
+
+// Parse the header at the beginning of `buf`.
+WeightsHeaderStatus parse_weights_header(const uint8_t *buf, size_t len,
+                                         WeightsHeader *header);
+
+const char *get_weights_header_status_string(WeightsHeaderStatus status);
+
+// Byte size of the payload following the header.
+uint64_t get_weights_payload_size(const WeightsHeader &header);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_WEIGHTS_HEADER_H_
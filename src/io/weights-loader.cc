@@ -1,79 +1,511 @@
 #include "io/weights-loader.hh"
+#include "io/archive.hh"
+#include "io/mapped-file.hh"
+#include "io/uring-reader.hh"
+#include "io/weights-header.hh"
+#include "sparse-storage.hh"
 
-#include <cassert>
+#include <algorithm>
+#include <cstddef>
 #include <fstream>
 #include <iostream>
 
 namespace nnview {
 
-bool load_weights(const std::string &filename, Tensor *tensor) {
+namespace {
+
+// Read the payload in chunks of this size. Reads after the first one start at
+// a file offset aligned to `kReadAlignment`.
+constexpr uint64_t kReadChunkSize = 64ull * 1024ull * 1024ull;
+constexpr uint64_t kReadAlignment = 4096;
+
+// Bytes read from the beginning of each file to parse the header. The header
+// consists of two short text lines.
+constexpr size_t kHeaderReadSize = 4096;
+
+// Print progress when no callback is given and the payload is larger than
+// this.
+constexpr uint64_t kReportProgressSize = 1024ull * 1024ull * 1024ull;
+
+}  // namespace
+
+static bool ParseHeader(const std::string &filename, const uint8_t *buf,
+                        size_t len, WeightsHeader *header) {
+  const WeightsHeaderStatus status = parse_weights_header(buf, len, header);
+  if (status != WEIGHTS_HEADER_OK) {
+    std::cerr << "Failed to parse header : "
+              << get_weights_header_status_string(status) << " at byte "
+              << header->error_offset << ". filename : " << filename
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Set up `tensor` from the parsed header. The payload is not read.
+static bool SetupTensor(const std::string &filename,
+                        const WeightsHeader &header, uint64_t file_size,
+                        Tensor *tensor) {
+  const uint64_t payload_size = get_weights_payload_size(header);
+  if ((header.header_size > file_size) ||
+      (file_size - header.header_size < payload_size)) {
+    std::cerr << "Payload is truncated. Expected [" << payload_size
+              << "] bytes but file has only ["
+              << ((header.header_size > file_size)
+                      ? 0
+                      : file_size - header.header_size)
+              << "] bytes. filename : " << filename << std::endl;
+    return false;
+  }
+
+  tensor->shape.assign(header.shape, header.shape + header.rank);
+  if (tensor->shape.size() == 1) {
+    // force create 2D tensor
+    tensor->shape.push_back(1);
+  }
+  tensor->name = filename;
+  tensor->dtype = header.dtype;
+  tensor->num_items = header.num_items;
+  tensor->source_filename = filename;
+  tensor->source_offset = header.header_size;
+
+  tensor->data.clear();
+  tensor->mapping.reset();
+  tensor->shared_data.reset();
+  tensor->sparse.reset();
+  tensor->mapped_data = nullptr;
+  tensor->loaded = false;
+
+  return true;
+}
+
+// Build the sparse storage from the payload of the sparse variant. Sparse
+// tensors are always loaded at once(also with `header_only`) since their size
+// scales with the number of nonzeros.
+static bool DecodeSparse(const std::string &filename,
+                         const WeightsHeader &header, const uint8_t *payload,
+                         Tensor *tensor) {
+  const size_t element_size = get_dtype_size(header.dtype);
+  const size_t rows = size_t(header.shape[0]);
+  const size_t cols = header.num_items / rows;
+  const size_t nnz = header.nnz;
+
+  std::string err;
+  if (header.layout == WEIGHTS_LAYOUT_CSR) {
+    const uint8_t *col_indices = payload + 8 * (rows + 1);
+    tensor->sparse = SparseStorage::from_csr(
+        rows, cols, nnz, payload, col_indices, col_indices + 4 * nnz,
+        element_size, &err);
+  } else {
+    const uint8_t *col_indices = payload + 4 * nnz;
+    tensor->sparse = SparseStorage::from_coo(
+        rows, cols, nnz, payload, col_indices, col_indices + 4 * nnz,
+        element_size, &err);
+  }
+  if (!tensor->sparse) {
+    std::cerr << err << " filename : " << filename << std::endl;
+    return false;
+  }
+
+  tensor->loaded = true;
+
+  return true;
+}
+
+// Read the payload of the sparse variant from `ifs` positioned at the
+// beginning of the payload.
+static bool ReadSparsePayload(const std::string &filename, std::ifstream &ifs,
+                              const WeightsHeader &header, Tensor *tensor) {
+  std::vector<uint8_t> payload(size_t(get_weights_payload_size(header)));
+  ifs.read(reinterpret_cast<char *>(payload.data()),
+           std::streamsize(payload.size()));
+  if (!ifs) {
+    std::cerr << "Failed to read sparse payload : " << filename << std::endl;
+    return false;
+  }
+  return DecodeSparse(filename, header, payload.data(), tensor);
+}
+
+static bool MapPayload(const std::shared_ptr<MappedFile> &mapping,
+                       Tensor *tensor) {
+  const uint64_t payload_offset = tensor->source_offset;
+  const size_t payload_size = tensor->byte_size();
+
+  if ((mapping->size() < payload_offset) ||
+      (mapping->size() - payload_offset < payload_size)) {
+    std::cerr << "Failed to map [" << std::to_string(payload_size)
+              << "] bytes. file size is only [" << mapping->size()
+              << "] bytes.\n";
+    return false;
+  }
+
+  // NOTE: The payload follows the text header, so `mapped_data` may not be
+  // aligned to the element size.
+  tensor->data.clear();
+  tensor->mapped_data = mapping->data() + size_t(payload_offset);
+  tensor->mapping = mapping;
+  tensor->loaded = true;
+
+  return true;
+}
+
+// Read the payload at `Tensor::source_offset` of the file opened as `ifs`.
+static bool ReadPayload(std::ifstream &ifs, Tensor *tensor,
+                        const WeightsLoadOption &option) {
+  const uint64_t payload_offset = tensor->source_offset;
+  const size_t payload_size = tensor->byte_size();
+
+  // Check the size of the file before allocating for the payload, as
+  // `MapPayload` does. Headers(or external data references) may declare more
+  // data than the file has.
+  ifs.clear();
+  ifs.seekg(0, std::ios::end);
+  const std::streamoff end = ifs.tellg();
+  if (!ifs || (end < 0) || (uint64_t(end) < payload_offset) ||
+      (uint64_t(end) - payload_offset < payload_size)) {
+    std::cerr << "Failed to read [" << std::to_string(payload_size)
+              << "] bytes at offset [" << payload_offset
+              << "]. file size is only [" << (end < 0 ? 0 : end)
+              << "] bytes.\n";
+    return false;
+  }
+  ifs.seekg(std::streamoff(payload_offset));
+
+  tensor->mapping.reset();
+  tensor->mapped_data = nullptr;
+  tensor->data.resize(payload_size);
+
+  const bool report_progress =
+      !option.progress && (payload_size >= kReportProgressSize);
+  int last_percent = 0;
+
+  // Read in chunks so that a single `read` never sees a byte count which
+  // overflows `std::streamsize` on any platform, and so that progress can be
+  // reported for multi-GB tensors.
+  uint8_t *dst = tensor->data.data();
+  uint64_t bytes_read = 0;
+  while (bytes_read < payload_size) {
+    // Make the following reads start at an aligned file offset.
+    const uint64_t file_offset = payload_offset + bytes_read;
+    uint64_t chunk_size = kReadChunkSize - (file_offset % kReadAlignment);
+    chunk_size = std::min(chunk_size, uint64_t(payload_size) - bytes_read);
+
+    ifs.read(reinterpret_cast<char *>(dst + bytes_read),
+             std::streamsize(chunk_size));
+    if (!ifs) {
+      std::cerr << "Failed to read [" << std::to_string(payload_size)
+                << "] bytes. only [" << bytes_read + uint64_t(ifs.gcount())
+                << "] could be read.\n";
+      tensor->data.clear();
+      return false;
+    }
+
+    bytes_read += chunk_size;
+
+    if (option.progress) {
+      option.progress(*tensor, bytes_read, payload_size);
+    } else if (report_progress) {
+      const int percent = int((100 * bytes_read) / payload_size);
+      if (percent / 10 > last_percent / 10) {
+        std::cout << "Loading " << tensor->name << " : " << percent << "%\n";
+        last_percent = percent;
+      }
+    }
+  }
+
+  tensor->loaded = true;
+
+  return true;
+}
+
+bool load_weights(const std::string &filename, Tensor *tensor,
+                  const WeightsLoadOption &option) {
+  WeightsHeader header;
+
+  if (option.use_mmap) {
+    std::shared_ptr<MappedFile> mapping = MappedFile::open(filename);
+    if (!mapping) {
+      return false;
+    }
+
+    if (!ParseHeader(filename, mapping->data(), mapping->size(), &header) ||
+        !SetupTensor(filename, header, mapping->size(), tensor)) {
+      return false;
+    }
+
+    if (header.layout != WEIGHTS_LAYOUT_DENSE) {
+      return DecodeSparse(filename, header,
+                          mapping->data() + header.header_size, tensor);
+    }
+
+    if (option.header_only) {
+      // Payload will be mapped later by `load_tensor_payload`.
+      return true;
+    }
+
+    return MapPayload(mapping, tensor);
+  }
+
   std::ifstream ifs(filename, std::ios::in | std::ios::binary);
   if (!ifs) {
     std::cerr << "Failed to open file : " << filename << std::endl;
     return false;
   }
 
-  std::string datasize_line;
-  std::getline(ifs, datasize_line);
+  // Read the beginning of the file at once. For small tensor dumps this is
+  // the whole file.
+  uint8_t buf[kHeaderReadSize];
+  ifs.read(reinterpret_cast<char *>(buf), sizeof(buf));
+  const size_t len = size_t(ifs.gcount());
 
-  int datasize = std::stoi(datasize_line);
-  if (datasize != 4) {
-    std::cerr << "Data size must be 4, but got " << datasize_line << std::endl;
+  if (!ParseHeader(filename, buf, len, &header)) {
     return false;
   }
 
-  std::cout << "datasize " << datasize << "\n";
+  uint64_t file_size = len;
+  if (len == sizeof(buf)) {
+    ifs.clear();
+    ifs.seekg(0, std::ios::end);
+    file_size = uint64_t(ifs.tellg());
+  }
 
-  std::string shape_line;
-  std::getline(ifs, shape_line);
+  if (!SetupTensor(filename, header, file_size, tensor)) {
+    return false;
+  }
 
-  // Up to 5D tensor
-  int d[5];
-  int n = sscanf(shape_line.c_str(), "%d,%d,%d,%d,%d", &d[0], &d[1], &d[2],
-                 &d[3], &d[4]);
+  if (header.layout != WEIGHTS_LAYOUT_DENSE) {
+    if (header.header_size + get_weights_payload_size(header) <= len) {
+      return DecodeSparse(filename, header, buf + header.header_size, tensor);
+    }
+    ifs.clear();
+    ifs.seekg(std::streamoff(header.header_size));
+    return ReadSparsePayload(filename, ifs, header, tensor);
+  }
 
-  size_t num_items = 1;
-  std::vector<int> shape;
-  for (int i = 0; i < n; i++) {
-    assert(d[i] > 0);
-    shape.push_back(d[i]);
-    num_items *= size_t(d[i]);
+  if (option.header_only) {
+    // Payload will be read later by `load_tensor_payload`.
+    return true;
   }
 
-  std::cout << "dim : " << shape.size() << std::endl;
-  for (size_t i = 0; i < shape.size(); i++) {
-    std::cout << "  [" << i << "] = " << shape[i] << std::endl;
+  const size_t payload_size = tensor->byte_size();
+  if (header.header_size + payload_size <= len) {
+    // The payload is already in the buffer.
+    tensor->data.assign(buf + header.header_size,
+                        buf + header.header_size + payload_size);
+    tensor->loaded = true;
+    return true;
   }
 
-  if (shape.size() == 0) {
-    std::cerr << "Failed to parse shape information: " << shape_line
-              << std::endl;
+  ifs.clear();
+  ifs.seekg(std::streamoff(header.header_size));
+
+  return ReadPayload(ifs, tensor, option);
+}
+
+bool load_weights_batch(const std::vector<std::string> &filenames,
+                        std::vector<Tensor> *tensors,
+                        const WeightsLoadOption &option) {
+  tensors->resize(filenames.size());
+
+  FileReadOption read_option;
+  read_option.direct_io = option.direct_io;
+
+  // 1. Read headers of all files.
+  std::vector<std::vector<uint8_t>> headers(filenames.size());
+  std::vector<FileReadRequest> requests(filenames.size());
+  for (size_t i = 0; i < filenames.size(); i++) {
+    headers[i].resize(kHeaderReadSize);
+    requests[i].filename = filenames[i];
+    requests[i].size = kHeaderReadSize;
+    requests[i].dst = headers[i].data();
+    requests[i].allow_short_read = true;
+  }
+
+  if (!read_files_with_uring(&requests, read_option)) {
+    std::cerr << "Failed to read files with io_uring.\n";
     return false;
   }
 
-  if (shape.size() == 1) {
-    // force create 2D tensor
-    shape.push_back(1);
+  for (size_t i = 0; i < filenames.size(); i++) {
+    if (!requests[i].ok) {
+      return false;
+    }
+
+    WeightsHeader header;
+    if (!ParseHeader(filenames[i], headers[i].data(), requests[i].bytes_read,
+                     &header) ||
+        !SetupTensor(filenames[i], header, requests[i].file_size,
+                     &(*tensors)[i])) {
+      return false;
+    }
+
+    // Small files are read entirely in the header batch.
+    Tensor &tensor = (*tensors)[i];
+    if (header.layout != WEIGHTS_LAYOUT_DENSE) {
+      const bool ret =
+          (header.header_size + get_weights_payload_size(header) <=
+           requests[i].bytes_read)
+              ? DecodeSparse(filenames[i], header,
+                             headers[i].data() + header.header_size, &tensor)
+              : load_weights(filenames[i], &tensor, option);
+      if (!ret) {
+        return false;
+      }
+      continue;
+    }
+    if (!option.header_only &&
+        (header.header_size + tensor.byte_size() <= requests[i].bytes_read)) {
+      tensor.data.assign(
+          headers[i].begin() + std::ptrdiff_t(header.header_size),
+          headers[i].begin() +
+              std::ptrdiff_t(header.header_size + tensor.byte_size()));
+      tensor.loaded = true;
+    }
   }
 
-  std::cout << "num_items: " << num_items << "\n";
+  if (option.header_only) {
+    // Payload will be read later by `load_tensor_payload`.
+    return true;
+  }
 
-  tensor->data.resize(num_items);
+  // 2. Read payloads of all files.
+  std::vector<size_t> ids;
+  requests.clear();
+  for (size_t i = 0; i < filenames.size(); i++) {
+    Tensor &tensor = (*tensors)[i];
+    if (tensor.loaded) {
+      continue;
+    }
+    tensor.data.resize(tensor.byte_size());
 
-  tensor->shape = shape;
-  tensor->name = filename;
+    FileReadRequest request;
+    request.filename = filenames[i];
+    request.offset = tensor.source_offset;
+    request.size = tensor.data.size();
+    request.dst = tensor.data.data();
+    requests.push_back(request);
+    ids.push_back(i);
+  }
 
-  ifs.read(reinterpret_cast<char *>(tensor->data.data()),
-           int64_t(num_items) * datasize);
+  if (!requests.empty() && !read_files_with_uring(&requests, read_option)) {
+    std::cerr << "Failed to read files with io_uring.\n";
+    return false;
+  }
 
-  if (!ifs) {
-    std::cerr << "Failed to read ["
-              << std::to_string(int64_t(num_items) * datasize)
-              << "] bytes. only [" << ifs.gcount() << "] could be read.\n";
+  for (size_t k = 0; k < requests.size(); k++) {
+    Tensor &tensor = (*tensors)[ids[k]];
+    if (!requests[k].ok) {
+      tensor.data.clear();
+      return false;
+    }
+    tensor.loaded = true;
+  }
+
+  if (option.progress) {
+    for (const auto &tensor : *tensors) {
+      option.progress(tensor, tensor.byte_size(), tensor.byte_size());
+    }
+  }
+
+  return true;
+}
+
+bool load_weights_from_archive(const Archive &archive,
+                               const ArchiveMember &member, Tensor *tensor) {
+  const std::string name = archive.filename() + ":" + member.name;
+
+  // Parse the header in place for stored members. Otherwise inflate the
+  // beginning of the member.
+  const uint8_t *data = archive.data(member);
+  uint8_t buf[kHeaderReadSize];
+  const uint8_t *header_data = data;
+  const size_t len = size_t(std::min(uint64_t(sizeof(buf)), member.size));
+  if (!data) {
+    std::string err;
+    if (!archive.read(member, 0, len, buf, &err)) {
+      std::cerr << err << " member : " << name << std::endl;
+      return false;
+    }
+    header_data = buf;
+  }
+
+  WeightsHeader header;
+  if (!ParseHeader(name, header_data, data ? size_t(member.size) : len,
+                   &header) ||
+      !SetupTensor(name, header, member.size, tensor)) {
     return false;
   }
+  tensor->name = member.name;
+  // Only a payload mapped in place can be read again from the archive.
+  // Inflated(or copied) payloads have no location.
+  tensor->source_filename.clear();
+  tensor->source_offset = 0;
+
+  if (header.layout != WEIGHTS_LAYOUT_DENSE) {
+    if (data) {
+      return DecodeSparse(name, header, data + header.header_size, tensor);
+    }
+    std::vector<uint8_t> payload(size_t(get_weights_payload_size(header)));
+    std::string err;
+    if (!archive.read(member, header.header_size, payload.size(),
+                      payload.data(), &err)) {
+      std::cerr << err << " member : " << name << std::endl;
+      return false;
+    }
+    return DecodeSparse(name, header, payload.data(), tensor);
+  }
+
+  const size_t payload_size = tensor->byte_size();
+  if (data && archive.mapping()) {
+    tensor->source_filename = archive.filename();
+    tensor->source_offset = member.offset + header.header_size;
+    tensor->mapped_data = data + header.header_size;
+    tensor->mapping = archive.mapping();
+  } else if (data) {
+    tensor->data.assign(data + header.header_size,
+                        data + header.header_size + payload_size);
+  } else {
+    tensor->data.resize(payload_size);
+    std::string err;
+    if (!archive.read(member, header.header_size, payload_size,
+                      tensor->data.data(), &err)) {
+      std::cerr << err << " member : " << name << std::endl;
+      tensor->data.clear();
+      return false;
+    }
+  }
+  tensor->loaded = true;
 
   return true;
 }
 
+bool load_tensor_payload(Tensor *tensor, const WeightsLoadOption &option) {
+  if (tensor->loaded) {
+    return true;
+  }
+
+  const std::string &filename = tensor->source_filename;
+  if (filename.empty()) {
+    std::cerr << "Tensor `" << tensor->name << "` has no data.\n";
+    return false;
+  }
+  if (option.use_mmap) {
+    std::shared_ptr<MappedFile> mapping = MappedFile::open(filename);
+    if (!mapping) {
+      return false;
+    }
+    return MapPayload(mapping, tensor);
+  }
+
+  std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+  if (!ifs) {
+    std::cerr << "Failed to open file : " << filename << std::endl;
+    return false;
+  }
+
+  ifs.seekg(std::streamoff(tensor->source_offset));
+
+  return ReadPayload(ifs, tensor, option);
+}
+
 }  // namespace nnview
@@ -1,23 +1,82 @@
 #ifndef NNVIEW_IO_WEIGHT_LOADER_H_
 #define NNVIEW_IO_WEIGHT_LOADER_H_
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 
 #include "datatypes.h"
 
 //
 // Simple weights loader for .weights file generated by chainer-trt.
-// Assume datatype is float32
+// datasize 4 = float32, 2 = float16, 1 = int8, 8 = float64
 //
 // format is:
 //
 // datasize\n
-// size0 size1 ...\n
+// size0,size1,...\n
 // <<binary>>
 //
+// Any rank is accepted. The total byte size is validated with 64-bit
+// arithmetic and the payload is read in chunks, so tensors larger than 2 GiB
+// can be loaded.
+//
 namespace nnview {
 
-bool load_weights(const std::string &filename, Tensor *tensor);
+class Archive;
+struct ArchiveMember;
+
+struct WeightsLoadOption {
+  // Memory-map the file and let `Tensor` refer to the payload in place instead
+  // of copying it into `Tensor::data`. Loading cost becomes O(header) and pages
+  // are read from disk when they are touched.
+  bool use_mmap = false;
+
+  // Only parse the header(datasize and shape) and record the location of the
+  // payload. Call `load_tensor_payload` to read the payload later.
+  bool header_only = false;
+
+  // Read the headers and payloads of all files with batched io_uring reads
+  // (`load_weights_batch`, Linux only). Ignored when `use_mmap` is set.
+  bool use_io_uring = false;
+
+  // Open files with O_DIRECT to bypass the page cache. Only used with
+  // `use_io_uring`.
+  bool direct_io = false;
+
+  // Called after each chunk of the payload is read with the number of bytes
+  // read so far and the total payload size. May be called from worker threads
+  // when tensors are loaded in parallel. When not set, progress of large
+  // payloads is printed to stdout.
+  std::function<void(const Tensor &tensor, uint64_t bytes_read,
+                     uint64_t total_bytes)>
+      progress;
+};
+
+bool load_weights(const std::string &filename, Tensor *tensor,
+                  const WeightsLoadOption &option = WeightsLoadOption());
+
+// Load multiple .weights/.tensor files at once. The headers of all files are
+// read in one io_uring batch, and then the payloads of all files in another
+// batch. Returns false when any file fails to load.
+// Call `is_uring_reader_available`(io/uring-reader.hh) before using this
+// function and use `load_weights` instead when it returns false.
+bool load_weights_batch(const std::vector<std::string> &filenames,
+                        std::vector<Tensor> *tensors,
+                        const WeightsLoadOption &option = WeightsLoadOption());
+
+// Load a .weights/.tensor file stored in a tar/zip archive. Stored members of
+// a mapped archive are used in place, others are copied(inflated) to
+// `Tensor::data`. `Tensor::name` is the member path.
+bool load_weights_from_archive(const Archive &archive,
+                               const ArchiveMember &member, Tensor *tensor);
+
+// Read(or map) the payload of a tensor whose header was loaded with
+// `WeightsLoadOption::header_only`. Does nothing when the payload is already
+// loaded.
+bool load_tensor_payload(Tensor *tensor,
+                         const WeightsLoadOption &option = WeightsLoadOption());
 
 }  // namespace nnview
 
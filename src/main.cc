@@ -61,11 +61,18 @@ SOFTWARE.
 #include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "io/weights-loader.hh"
+#include "io/binary-graph.hh"
 #include "io/graph-loader.hh"
+#include "io/manifest.hh"
+#include "io/path-util.hh"
+#include "io/checkpoint-series.hh"
+#include "io/tensor-prefetcher.hh"
+#include "io/tensor-reloader.hh"
 #include "nnview_app.hh"
 #include "roboto_mono_embed.inc.h"
 #include "gui_component.hh"
@@ -466,28 +473,180 @@ static void update_texture(GLuint texid, const nnview::Tensor& tensor) {
 }
 #endif
 
+static void print_usage() {
+  std::cout << "Usage: nnview [options] <file>\n";
+  std::cout << "  <file> : model.json(chainer-trt) or a .tar/.tar.gz/.zip "
+               "archive of it, .onnx, .tflite, .npz, .npy, .safetensors, "
+               ".nnvgraph or .dot\n";
+  std::cout << "         or a directory of snapshots(model.json directories "
+               "or archives) of the same model\n";
+  std::cout << "  --mmap : Memory-map weight/tensor files instead of reading "
+               "them into memory.\n";
+  std::cout << "  --lazy : Read only headers at startup and load tensor data "
+               "when the tensor is selected.\n";
+  std::cout << "  --threads N : The number of threads to load weight/tensor "
+               "files(default: all hardware threads).\n";
+  std::cout << "  --io-uring : Read weight/tensor files with batched io_uring "
+               "reads(Linux only).\n";
+  std::cout << "  --direct-io : Bypass the page cache(O_DIRECT) with "
+               "--io-uring.\n";
+  std::cout << "  --compress : Keep tensor data compressed in memory and "
+               "decompress on demand.\n";
+  std::cout << "  --cache : Write a packed cache next to model.json and use "
+               "it while it is up to date.\n";
+  std::cout << "  --watch : Reload weight/tensor files in the background when "
+               "they are rewritten.\n";
+  std::cout << "  --manifest FILE : Verify the size and CRC32C of weight/tensor "
+               "files against FILE while loading.\n";
+  std::cout << "  --write-manifest FILE : Write a manifest of the weight/tensor "
+               "files of the model to FILE and exit.\n";
+  std::cout << "  --write-graph FILE : Write the graph to FILE in the binary "
+               "graph format(.nnvgraph) and exit.\n";
+  std::cout << "  --prefetch-budget MB : With --lazy, memory for tensors "
+               "prefetched around the selected tensor(default: 256, 0 = "
+               "off).\n";
+}
+
 int main(int argc, char **argv) {
-  // TODO(LTE): Parse args.
-  (void)argc;
-  (void)argv;
+  std::string graph_filename;
+  nnview::GraphLoadOption load_option;
+  bool watch = false;
+  int prefetch_budget_mb = 256;
+  std::string write_manifest_filename;
+  std::string write_graph_filename;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare("--mmap") == 0) {
+      load_option.weights.use_mmap = true;
+    } else if (arg.compare("--lazy") == 0) {
+      load_option.weights.header_only = true;
+    } else if (arg.compare("--io-uring") == 0) {
+      load_option.weights.use_io_uring = true;
+    } else if (arg.compare("--direct-io") == 0) {
+      load_option.weights.direct_io = true;
+    } else if (arg.compare("--compress") == 0) {
+      load_option.compress_tensors = true;
+    } else if (arg.compare("--cache") == 0) {
+      load_option.use_cache = true;
+    } else if (arg.compare("--watch") == 0) {
+      watch = true;
+    } else if ((arg.compare("--manifest") == 0) && ((i + 1) < argc)) {
+      load_option.manifest_filename = argv[++i];
+    } else if ((arg.compare("--write-manifest") == 0) && ((i + 1) < argc)) {
+      write_manifest_filename = argv[++i];
+    } else if ((arg.compare("--write-graph") == 0) && ((i + 1) < argc)) {
+      write_graph_filename = argv[++i];
+    } else if ((arg.compare("--prefetch-budget") == 0) && ((i + 1) < argc)) {
+      prefetch_budget_mb = std::atoi(argv[++i]);
+    } else if ((arg.compare("--threads") == 0) && ((i + 1) < argc)) {
+      load_option.num_threads = std::atoi(argv[++i]);
+    } else if ((arg.compare("-h") == 0) || (arg.compare("--help") == 0)) {
+      print_usage();
+      return EXIT_SUCCESS;
+    } else if ((arg.size() > 1) && (arg[0] == '-')) {
+      std::cerr << "Unknown option : " << arg << "\n";
+      print_usage();
+      return EXIT_FAILURE;
+    } else {
+      graph_filename = arg;
+    }
+  }
 
-  if (argc < 2) {
+  if (graph_filename.empty()) {
     std::cerr << "Need model.json\n";
+    print_usage();
     return EXIT_FAILURE;
   }
 
-  nnview::GUIContext gui_ctx;
+  // A writer truncates a watched file while rewriting it, and reading a
+  // truncated mapping raises SIGBUS. Copy watched tensors instead.
+  if (watch && load_option.weights.use_mmap) {
+    std::cerr << "--mmap is ignored with --watch.\n";
+    load_option.weights.use_mmap = false;
+  }
 
-  std::string graph_filename = argv[1];
+  nnview::GUIContext gui_ctx;
+  gui_ctx._weights_load_option = load_option.weights;
 
-  {
-    bool ret = nnview::load_json_graph(graph_filename, &gui_ctx._graph);
+  nnview::CheckpointSeries series;
+  if (nnview::CheckpointSeries::is_series_path(graph_filename)) {
+    if (!series.load(graph_filename, &gui_ctx._graph, load_option)) {
+      std::cerr << "Failed to read snapshots : " << graph_filename << "\n";
+      return EXIT_FAILURE;
+    }
+    gui_ctx._series = &series;
+  } else {
+    bool ret =
+        nnview::load_graph(graph_filename, &gui_ctx._graph, load_option);
     if (!ret) {
       std::cerr << "Failed to read graph : " << graph_filename << "\n";
       return EXIT_FAILURE;
     }
   }
 
+  if (!write_manifest_filename.empty()) {
+    if (nnview::GetFileExtension(graph_filename).compare(".json") != 0) {
+      std::cerr << "--write-manifest requires a JSON graph file.\n";
+      return EXIT_FAILURE;
+    }
+
+    // Paths in the manifest are relative to the directory of the model.
+    const std::string base_dir = nnview::GetBaseDir(graph_filename);
+    std::vector<nnview::ManifestFile> files;
+    std::set<std::string> listed;
+    for (const auto &tensor : gui_ctx._graph.tensors) {
+      if (tensor.source_filename.empty() ||
+          listed.count(tensor.source_filename)) {
+        continue;
+      }
+      listed.insert(tensor.source_filename);
+
+      nnview::ManifestFile file;
+      file.filepath = tensor.source_filename;
+      file.path = file.filepath;
+      if (!base_dir.empty() &&
+          (file.path.compare(0, base_dir.size() + 1, base_dir + "/") == 0)) {
+        file.path = file.path.substr(base_dir.size() + 1);
+      }
+      file.tensor = &tensor;
+      files.push_back(file);
+    }
+
+    if (!nnview::write_manifest(write_manifest_filename, files,
+                                load_option.num_threads)) {
+      return EXIT_FAILURE;
+    }
+    std::cout << "Wrote manifest of " << files.size()
+              << " files : " << write_manifest_filename << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (!write_graph_filename.empty()) {
+    if (!nnview::write_binary_graph(write_graph_filename, gui_ctx._graph)) {
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  nnview::TensorReloader reloader;
+  if (watch) {
+    if (gui_ctx._series) {
+      std::cerr << "--watch is not supported for checkpoint series.\n";
+    } else if (reloader.start(gui_ctx._graph, load_option.weights)) {
+      gui_ctx._reloader = &reloader;
+    }
+  }
+
+  // Only lazily loaded tensors have something to prefetch.
+  nnview::TensorPrefetcher prefetcher;
+  if (load_option.weights.header_only && (prefetch_budget_mb > 0)) {
+    prefetcher.start(gui_ctx._graph,
+                     size_t(prefetch_budget_mb) * 1024 * 1024,
+                     /* max_hops */ 2, load_option.weights);
+    gui_ctx._prefetcher = &prefetcher;
+  }
+
   GLFWwindow *window = nullptr;
   nnview::app app;
 
@@ -524,6 +683,9 @@ int main(int argc, char **argv) {
     int display_w, display_h;
     gl_new_frame(window, background_color, &display_w, &display_h);
 
+    gui_ctx.update_reloaded_tensors();
+    gui_ctx.update_prefetched_tensors();
+
     gui_ctx.draw_imnodes();
     gui_ctx.draw_tensor();
 
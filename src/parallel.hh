@@ -0,0 +1,60 @@
+#ifndef NNVIEW_PARALLEL_HH_
+#define NNVIEW_PARALLEL_HH_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace nnview {
+
+// Returns the number of worker threads to use.
+// `num_threads` <= 0 means "use all hardware threads".
+inline int get_num_threads(int num_threads) {
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  unsigned int n = std::thread::hardware_concurrency();
+  return (n > 0) ? int(n) : 1;
+}
+
+//
+// Call `func(i)` for i in [0, n) using a pool of worker threads.
+// Work items are handed out one by one through an atomic counter, so
+// unevenly sized items(e.g. weight files of various size) are balanced well.
+// The order of execution is not specified. Store results per index to get
+// deterministic output.
+//
+template <typename Func>
+void parallel_for(size_t n, int num_threads, Func &&func) {
+  const size_t num_workers =
+      std::min(n, size_t(get_num_threads(num_threads)));
+
+  if (num_workers <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      func(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_index(0);
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < num_workers; t++) {
+    workers.emplace_back([&]() {
+      size_t i = 0;
+      while ((i = next_index++) < n) {
+        func(i);
+      }
+    });
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+}  // namespace nnview
+
+#endif  // NNVIEW_PARALLEL_HH_
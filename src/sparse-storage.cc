@@ -0,0 +1,184 @@
+#include "sparse-storage.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace nnview {
+
+namespace {
+
+inline uint64_t Load64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Load32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+}  // namespace
+
+// Sort the columns within each row and reject duplicate entries.
+static bool SortRows(std::vector<uint64_t> *row_ptr,
+                     std::vector<uint32_t> *col_indices,
+                     std::vector<uint8_t> *values, size_t element_size,
+                     std::string *err) {
+  std::vector<size_t> order;
+  std::vector<uint32_t> cols;
+  std::vector<uint8_t> vals;
+
+  for (size_t r = 0; r + 1 < row_ptr->size(); r++) {
+    const size_t begin = size_t((*row_ptr)[r]);
+    const size_t end = size_t((*row_ptr)[r + 1]);
+    uint32_t *c = col_indices->data() + begin;
+    const size_t n = end - begin;
+
+    if (!std::is_sorted(c, c + n)) {
+      order.resize(n);
+      std::iota(order.begin(), order.end(), size_t(0));
+      std::sort(order.begin(), order.end(),
+                [c](size_t a, size_t b) { return c[a] < c[b]; });
+
+      uint8_t *v = values->data() + begin * element_size;
+      cols.assign(c, c + n);
+      vals.assign(v, v + n * element_size);
+      for (size_t k = 0; k < n; k++) {
+        c[k] = cols[order[k]];
+        memcpy(v + k * element_size, vals.data() + order[k] * element_size,
+               element_size);
+      }
+    }
+
+    if (std::adjacent_find(c, c + n) != c + n) {
+      (*err) = "Duplicate entry in row " + std::to_string(r) +
+               " of sparse tensor.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::shared_ptr<SparseStorage> SparseStorage::from_csr(
+    size_t rows, size_t cols, size_t nnz, const uint8_t *row_ptr,
+    const uint8_t *col_indices, const uint8_t *values, size_t element_size,
+    std::string *err) {
+  auto storage = std::make_shared<SparseStorage>();
+  storage->_rows = rows;
+  storage->_cols = cols;
+  storage->_element_size = element_size;
+
+  storage->_row_ptr.resize(rows + 1);
+  uint64_t prev = 0;
+  for (size_t r = 0; r <= rows; r++) {
+    const uint64_t p = Load64(row_ptr + 8 * r);
+    if ((p < prev) || (p > nnz) || ((r == 0) && (p != 0))) {
+      (*err) = "Invalid row pointer at row " + std::to_string(r) +
+               " of CSR tensor.";
+      return nullptr;
+    }
+    storage->_row_ptr[r] = p;
+    prev = p;
+  }
+  if (prev != nnz) {
+    (*err) = "Row pointers do not end at nnz in CSR tensor.";
+    return nullptr;
+  }
+
+  storage->_col_indices.resize(nnz);
+  for (size_t k = 0; k < nnz; k++) {
+    const uint32_t c = Load32(col_indices + 4 * k);
+    if (c >= cols) {
+      (*err) = "Column index out of range in CSR tensor.";
+      return nullptr;
+    }
+    storage->_col_indices[k] = c;
+  }
+
+  storage->_values.assign(values, values + nnz * element_size);
+
+  if (!SortRows(&storage->_row_ptr, &storage->_col_indices,
+                &storage->_values, element_size, err)) {
+    return nullptr;
+  }
+
+  return storage;
+}
+
+std::shared_ptr<SparseStorage> SparseStorage::from_coo(
+    size_t rows, size_t cols, size_t nnz, const uint8_t *row_indices,
+    const uint8_t *col_indices, const uint8_t *values, size_t element_size,
+    std::string *err) {
+  auto storage = std::make_shared<SparseStorage>();
+  storage->_rows = rows;
+  storage->_cols = cols;
+  storage->_element_size = element_size;
+
+  // Count entries per row, then scatter them(counting sort by row).
+  std::vector<uint64_t> &row_ptr = storage->_row_ptr;
+  row_ptr.assign(rows + 1, 0);
+  for (size_t k = 0; k < nnz; k++) {
+    const uint32_t r = Load32(row_indices + 4 * k);
+    const uint32_t c = Load32(col_indices + 4 * k);
+    if ((r >= rows) || (c >= cols)) {
+      (*err) = "Index out of range in COO tensor.";
+      return nullptr;
+    }
+    row_ptr[r + 1]++;
+  }
+  for (size_t r = 0; r < rows; r++) {
+    row_ptr[r + 1] += row_ptr[r];
+  }
+
+  storage->_col_indices.resize(nnz);
+  storage->_values.resize(nnz * element_size);
+  std::vector<uint64_t> next(row_ptr.begin(), row_ptr.end() - 1);
+  for (size_t k = 0; k < nnz; k++) {
+    const uint32_t r = Load32(row_indices + 4 * k);
+    const size_t dst = size_t(next[r]++);
+    storage->_col_indices[dst] = Load32(col_indices + 4 * k);
+    memcpy(&storage->_values[dst * element_size], values + k * element_size,
+           element_size);
+  }
+
+  if (!SortRows(&storage->_row_ptr, &storage->_col_indices,
+                &storage->_values, element_size, err)) {
+    return nullptr;
+  }
+
+  return storage;
+}
+
+size_t SparseStorage::memory_size() const {
+  return _row_ptr.size() * sizeof(uint64_t) +
+         _col_indices.size() * sizeof(uint32_t) + _values.size();
+}
+
+size_t SparseStorage::find(size_t row, size_t col) const {
+  if ((row >= _rows) || (col >= _cols)) {
+    return nnz();
+  }
+  const auto begin = _col_indices.begin() + std::ptrdiff_t(_row_ptr[row]);
+  const auto end = _col_indices.begin() + std::ptrdiff_t(_row_ptr[row + 1]);
+  const auto it = std::lower_bound(begin, end, uint32_t(col));
+  if ((it == end) || (*it != col)) {
+    return nnz();
+  }
+  return size_t(it - _col_indices.begin());
+}
+
+void SparseStorage::to_dense(uint8_t *dst) const {
+  memset(dst, 0, _rows * _cols * _element_size);
+  for (size_t r = 0; r < _rows; r++) {
+    for (size_t k = size_t(_row_ptr[r]); k < size_t(_row_ptr[r + 1]); k++) {
+      memcpy(dst + (r * _cols + _col_indices[k]) * _element_size,
+             &_values[k * _element_size], _element_size);
+    }
+  }
+}
+
+}  // namespace nnview
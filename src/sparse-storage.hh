@@ -0,0 +1,83 @@
+#ifndef NNVIEW_SPARSE_STORAGE_HH_
+#define NNVIEW_SPARSE_STORAGE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+// Sparse(CSR) in-memory storage of a tensor payload.
+//
+// The tensor is viewed as a `rows` x `cols` matrix(rows = shape[0], cols =
+// product of the remaining dimensions). Only nonzero elements are stored:
+//
+//   row_ptr     : rows + 1 offsets into `col_indices` and values
+//   col_indices : column of each nonzero, ascending within a row
+//   values      : nonzero values in the tensor's native element type
+//
+// Memory usage and the cost of the colormap, statistics and value overlay
+// scale with the number of nonzeros instead of rows x cols.
+//
+// Indices and values are read in little-endian byte order.
+//
+namespace nnview {
+
+class SparseStorage {
+ public:
+  SparseStorage() {}
+
+  SparseStorage(const SparseStorage &) = delete;
+  SparseStorage &operator=(const SparseStorage &) = delete;
+
+  // Build from CSR arrays. `row_ptr` holds `rows + 1` uint64 values and
+  // `col_indices` holds `nnz` uint32 values. Columns within a row may be
+  // unsorted. Returns nullptr and sets `err` on invalid input(e.g. duplicate
+  // or out of range indices).
+  static std::shared_ptr<SparseStorage> from_csr(
+      size_t rows, size_t cols, size_t nnz, const uint8_t *row_ptr,
+      const uint8_t *col_indices, const uint8_t *values, size_t element_size,
+      std::string *err);
+
+  // Build from COO arrays. `row_indices` and `col_indices` hold `nnz` uint32
+  // values each, in any order.
+  static std::shared_ptr<SparseStorage> from_coo(
+      size_t rows, size_t cols, size_t nnz, const uint8_t *row_indices,
+      const uint8_t *col_indices, const uint8_t *values, size_t element_size,
+      std::string *err);
+
+  size_t rows() const { return _rows; }
+  size_t cols() const { return _cols; }
+  size_t nnz() const { return _col_indices.size(); }
+  size_t element_size() const { return _element_size; }
+
+  // Bytes used by the index and value arrays.
+  size_t memory_size() const;
+
+  const std::vector<uint64_t> &row_ptr() const { return _row_ptr; }
+  const std::vector<uint32_t> &col_indices() const { return _col_indices; }
+
+  // Value of the `k`-th nonzero. `values()` holds `nnz()` contiguous
+  // elements.
+  const uint8_t *values() const { return _values.data(); }
+
+  // Index of the nonzero at (`row`, `col`), or `nnz()` when the element is
+  // zero.
+  size_t find(size_t row, size_t col) const;
+
+  // Write the dense row-major payload(rows x cols elements) to `dst`.
+  void to_dense(uint8_t *dst) const;
+
+ private:
+  size_t _rows = 0;
+  size_t _cols = 0;
+  size_t _element_size = 1;
+  std::vector<uint64_t> _row_ptr;
+  std::vector<uint32_t> _col_indices;
+  std::vector<uint8_t> _values;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_SPARSE_STORAGE_HH_
@@ -0,0 +1,88 @@
+#include "symbol-table.hh"
+#include "hash.hh"
+
+#include <cstring>
+
+namespace nnview {
+
+namespace {
+
+constexpr size_t kInitialIndexSize = 64;
+
+}  // namespace
+
+size_t SymbolTable::probe(const char *str, size_t len, uint64_t hash) const {
+  const size_t mask = _index.size() - 1;
+  size_t pos = size_t(hash) & mask;
+  for (;;) {
+    const uint32_t slot = _index[pos];
+    if (slot == 0) {
+      return pos;
+    }
+    const Symbol sym = slot - 1;
+    const std::string &s = _strings[sym];
+    if ((_hashes[sym] == hash) && (s.size() == len) &&
+        ((len == 0) || (memcmp(s.data(), str, len) == 0))) {
+      return pos;
+    }
+    pos = (pos + 1) & mask;
+  }
+}
+
+void SymbolTable::grow() {
+  const size_t size =
+      _index.empty() ? kInitialIndexSize : (_index.size() * 2);
+  _index.assign(size, 0);
+
+  const size_t mask = size - 1;
+  for (size_t i = 0; i < _strings.size(); i++) {
+    size_t pos = size_t(_hashes[i]) & mask;
+    while (_index[pos] != 0) {
+      pos = (pos + 1) & mask;
+    }
+    _index[pos] = uint32_t(i + 1);
+  }
+}
+
+Symbol SymbolTable::intern(const char *str, size_t len) {
+  // Keep the load factor below 1/2.
+  if (2 * (_strings.size() + 1) > _index.size()) {
+    grow();
+  }
+
+  const uint64_t hash = hash64(str, len);
+  const size_t pos = probe(str, len, hash);
+  if (_index[pos] != 0) {
+    return _index[pos] - 1;
+  }
+
+  const Symbol sym = Symbol(_strings.size());
+  _strings.emplace_back(str, len);
+  _hashes.push_back(hash);
+  _index[pos] = sym + 1;
+  return sym;
+}
+
+Symbol SymbolTable::intern(const std::string &str) {
+  return intern(str.data(), str.size());
+}
+
+int SymbolTable::find(const char *str, size_t len) const {
+  if (_index.empty()) {
+    return -1;
+  }
+  const size_t pos = probe(str, len, hash64(str, len));
+  return int(_index[pos]) - 1;
+}
+
+int SymbolTable::find(const std::string &str) const {
+  return find(str.data(), str.size());
+}
+
+void SymbolTable::clear() {
+  _strings.clear();
+  _hashes.clear();
+  _index.clear();
+}
+
+}  // namespace nnview
@@ -0,0 +1,56 @@
+#ifndef NNVIEW_SYMBOL_TABLE_HH_
+#define NNVIEW_SYMBOL_TABLE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// Interned strings(symbols) of a graph.
+//
+// Each distinct name(tensor, node and slot names) is stored once and
+// referred to by a `Symbol`, a dense index starting from 0. Loaders resolve
+// links by symbol, e.g. with a `std::vector<int>` indexed by symbol, instead
+// of comparing strings.
+//
+// Lookup uses an open addressing hash table(64-bit hash of the string,
+// linear probing), so interning and finding a name is O(length of the name).
+//
+namespace nnview {
+
+typedef uint32_t Symbol;
+
+class SymbolTable {
+ public:
+  // Returns the symbol of `str`. `str` is added when it is not interned yet.
+  Symbol intern(const std::string &str);
+  Symbol intern(const char *str, size_t len);
+
+  // Returns -1 when `str` is not interned.
+  int find(const std::string &str) const;
+  int find(const char *str, size_t len) const;
+
+  // NOTE: The reference is invalidated by `intern`.
+  const std::string &str(Symbol sym) const { return _strings[sym]; }
+
+  // Symbols are [0, size()).
+  size_t size() const { return _strings.size(); }
+
+  void clear();
+
+ private:
+  // Index to `_index` where `str` is or should be stored.
+  size_t probe(const char *str, size_t len, uint64_t hash) const;
+  void grow();
+
+  std::vector<std::string> _strings;
+  std::vector<uint64_t> _hashes;  // hash of each string
+
+  // Open addressing table. Power of two size. Holds symbol + 1(0 = empty).
+  std::vector<uint32_t> _index;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_SYMBOL_TABLE_HH_
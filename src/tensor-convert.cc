@@ -0,0 +1,231 @@
+#include "tensor-convert.hh"
+#include "compressed-storage.hh"
+#include "sparse-storage.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace nnview {
+
+// Loops below are written so that compilers can auto-vectorize them.
+// `memcpy` is used to load elements from possibly unaligned memory.
+
+static inline float HalfToFloat(uint16_t h) {
+  // Based on "half_to_float_fast5" by Fabian Giesen. Handles denormals,
+  // Inf and NaN.
+  const uint32_t shifted_exp = 0x7c00u << 13;
+  uint32_t o = uint32_t(h & 0x7fffu) << 13;
+  const uint32_t exp = shifted_exp & o;
+  o += uint32_t(127 - 15) << 23;
+
+  if (exp == shifted_exp) {
+    // Inf/NaN
+    o += uint32_t(128 - 16) << 23;
+  } else if (exp == 0) {
+    // Zero/Denormal
+    const uint32_t magic_bits = 113u << 23;
+    float magic;
+    memcpy(&magic, &magic_bits, sizeof(float));
+    o += 1u << 23;
+    float f;
+    memcpy(&f, &o, sizeof(float));
+    f -= magic;
+    memcpy(&o, &f, sizeof(float));
+  }
+
+  o |= uint32_t(h & 0x8000u) << 16;
+
+  float ret;
+  memcpy(&ret, &o, sizeof(float));
+  return ret;
+}
+
+static void HalfToFloatArray(const uint8_t *src, size_t count, float *dst) {
+  size_t i = 0;
+#if defined(__F16C__)
+  for (; i + 8 <= count; i += 8) {
+    __m128i h =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+            static_cast<const void *>(src + 2 * i)));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+#endif
+  for (; i < count; i++) {
+    uint16_t h;
+    memcpy(&h, src + 2 * i, sizeof(uint16_t));
+    dst[i] = HalfToFloat(h);
+  }
+}
+
+static void BFloat16ToFloatArray(const uint8_t *src, size_t count,
+                                 float *dst) {
+  for (size_t i = 0; i < count; i++) {
+    uint16_t h;
+    memcpy(&h, src + 2 * i, sizeof(uint16_t));
+    const uint32_t bits = uint32_t(h) << 16;
+    memcpy(dst + i, &bits, sizeof(float));
+  }
+}
+
+template <typename T>
+static void CastToFloatArray(const uint8_t *src, size_t count, float *dst) {
+  for (size_t i = 0; i < count; i++) {
+    T v;
+    memcpy(&v, src + sizeof(T) * i, sizeof(T));
+    dst[i] = float(v);
+  }
+}
+
+void convert_to_float(DataType dtype, const uint8_t *src, size_t count,
+                      float *dst) {
+  switch (dtype) {
+    case DTYPE_FLOAT32:
+      memcpy(dst, src, count * sizeof(float));
+      break;
+    case DTYPE_FLOAT16:
+      HalfToFloatArray(src, count, dst);
+      break;
+    case DTYPE_BFLOAT16:
+      BFloat16ToFloatArray(src, count, dst);
+      break;
+    case DTYPE_FLOAT64:
+      CastToFloatArray<double>(src, count, dst);
+      break;
+    case DTYPE_INT8:
+      CastToFloatArray<int8_t>(src, count, dst);
+      break;
+    case DTYPE_UINT8:
+      CastToFloatArray<uint8_t>(src, count, dst);
+      break;
+    case DTYPE_INT32:
+      CastToFloatArray<int32_t>(src, count, dst);
+      break;
+  }
+}
+
+void tensor_to_float(const Tensor &tensor, size_t offset, size_t count,
+                     float *dst) {
+  const size_t stride = get_dtype_size(tensor.dtype);
+
+  if (tensor.sparse) {
+    // Zero fill, then scatter the nonzeros of the rows overlapping the range.
+    const SparseStorage &sparse = *tensor.sparse;
+    std::fill(dst, dst + count, 0.0f);
+    if ((count == 0) || (sparse.cols() == 0)) {
+      return;
+    }
+    const size_t cols = sparse.cols();
+    const size_t end = offset + count;
+    const size_t last_row = std::min(sparse.rows(), (end - 1) / cols + 1);
+    for (size_t r = offset / cols; r < last_row; r++) {
+      for (size_t k = size_t(sparse.row_ptr()[r]);
+           k < size_t(sparse.row_ptr()[r + 1]); k++) {
+        const size_t i = r * cols + sparse.col_indices()[k];
+        if ((i >= offset) && (i < end)) {
+          convert_to_float(tensor.dtype, sparse.values() + k * stride, 1,
+                           dst + (i - offset));
+        }
+      }
+    }
+    return;
+  }
+
+  if (tensor.compressed) {
+    // Convert block by block. The block size is a multiple of the element
+    // size, so no element straddles blocks.
+    constexpr size_t kBlockSize = CompressedStorage::kBlockSize;
+    size_t byte_offset = offset * stride;
+    while (count > 0) {
+      const size_t index = byte_offset / kBlockSize;
+      const size_t block_offset = byte_offset % kBlockSize;
+      const size_t n = std::min(count, (kBlockSize - block_offset) / stride);
+
+      auto block = tensor.compressed->block(index);
+      if (block) {
+        convert_to_float(tensor.dtype, block->data() + block_offset, n, dst);
+      } else {
+        std::fill(dst, dst + n, 0.0f);
+      }
+
+      byte_offset += n * stride;
+      dst += n;
+      count -= n;
+    }
+    return;
+  }
+
+  convert_to_float(tensor.dtype, tensor.raw_data() + offset * stride, count,
+                   dst);
+}
+
+float tensor_value(const Tensor &tensor, size_t i) {
+  if (tensor.sparse) {
+    const SparseStorage &sparse = *tensor.sparse;
+    if (sparse.cols() == 0) {
+      return 0.0f;
+    }
+    const size_t k = sparse.find(i / sparse.cols(), i % sparse.cols());
+    if (k == sparse.nnz()) {
+      return 0.0f;
+    }
+    float v;
+    convert_to_float(tensor.dtype, sparse.values() + k * sparse.element_size(),
+                     1, &v);
+    return v;
+  }
+
+  float v;
+  tensor_to_float(tensor, i, 1, &v);
+  return v;
+}
+
+bool tensor_min_max(const Tensor &tensor, float *min_value,
+                    float *max_value) {
+  if (tensor.num_items == 0) {
+    return false;
+  }
+
+  // Convert in chunks to keep the temporary buffer small.
+  constexpr size_t kChunkItems = 4096;
+  float buf[kChunkItems];
+
+  float lo = std::numeric_limits<float>::max();
+  float hi = -std::numeric_limits<float>::max();
+  auto update = [&](size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      lo = std::min(lo, buf[i]);
+      hi = std::max(hi, buf[i]);
+    }
+  };
+
+  if (tensor.sparse) {
+    const SparseStorage &sparse = *tensor.sparse;
+    for (size_t k = 0; k < sparse.nnz(); k += kChunkItems) {
+      const size_t n = std::min(kChunkItems, sparse.nnz() - k);
+      convert_to_float(tensor.dtype,
+                       sparse.values() + k * sparse.element_size(), n, buf);
+      update(n);
+    }
+    if (sparse.nnz() < tensor.num_items) {
+      lo = std::min(lo, 0.0f);
+      hi = std::max(hi, 0.0f);
+    }
+  } else {
+    for (size_t i = 0; i < tensor.num_items; i += kChunkItems) {
+      const size_t n = std::min(kChunkItems, tensor.num_items - i);
+      tensor_to_float(tensor, i, n, buf);
+      update(n);
+    }
+  }
+
+  (*min_value) = lo;
+  (*max_value) = hi;
+  return true;
+}
+
+}  // namespace nnview
@@ -0,0 +1,37 @@
+#ifndef NNVIEW_TENSOR_CONVERT_HH_
+#define NNVIEW_TENSOR_CONVERT_HH_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "datatypes.h"
+
+//
+// Convert tensor payload in its native element type into float on demand.
+// Used for statistics, colormapping and value display in the GUI.
+// Quantization scale/zero point is not applied: integer tensors are shown
+// with their raw values.
+//
+namespace nnview {
+
+// Convert `count` elements of `dtype` at `src` into float.
+// `src` does not need to be aligned.
+void convert_to_float(DataType dtype, const uint8_t *src, size_t count,
+                      float *dst);
+
+// Convert `count` items starting at the `offset`-th item of `tensor`.
+// The tensor payload must be loaded.
+void tensor_to_float(const Tensor &tensor, size_t offset, size_t count,
+                     float *dst);
+
+// Get the `i`-th item of `tensor` as float.
+float tensor_value(const Tensor &tensor, size_t i);
+
+// Min/max of all items of a loaded tensor. For sparse tensors only the
+// nonzeros are visited(zero is included when the tensor has any zero).
+// Returns false for an empty tensor.
+bool tensor_min_max(const Tensor &tensor, float *min_value, float *max_value);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_TENSOR_CONVERT_HH_